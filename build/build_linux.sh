@@ -2,6 +2,16 @@
 
 set -e
 
+# Usage: build/build_linux.sh [debug|release|bench|pgo|assets]
+#   debug    -O0 with hot reload (default)
+#   release  optimized, LTO across the platform executable's units
+#   bench    headless benchmark (out/bench) with the release flags
+#   pgo      release build trained on the benchmark (clang only)
+#   assets   repack the sprite atlases, then the asset pack
+# debug, release and pgo also rebuild the asset pack (out/assets.rpak).
+# MARCH picks the target CPU for optimized builds, e.g. MARCH=native.
+CONFIG=${1:-debug}
+
 # Use clang++ if available, otherwise fall back to g++
 if command -v clang++ &> /dev/null; then
     CXX=clang++
@@ -9,26 +19,142 @@ else
     CXX=g++
 fi
 
-COMPILER_FLAGS="-g -O0 -Wall -Wextra -std=c++23 -fno-exceptions -fno-rtti -Wno-address-of-temporary"
+COMMON_FLAGS="-Wall -Wextra -std=c++23 -fno-exceptions -fno-rtti -Wno-address-of-temporary"
+DEBUG_FLAGS="-g -O0 -DARENA_TRACK_SITES=1 $COMMON_FLAGS"
 INCLUDE_FLAGS="-Iinclude -Isrc"
 
+if [ "$(uname -m)" = "x86_64" ]; then
+    MARCH=${MARCH:-x86-64-v2}
+fi
+RELEASE_FLAGS="-O2 -DARENA_GUARD_PAGES=0 $COMMON_FLAGS ${MARCH:+-march=$MARCH}"
+
+# Clang needs lld for LTO; ThinLTO keeps link times short
+if [ "$CXX" = "clang++" ]; then
+    LTO_FLAGS="-flto=thin -fuse-ld=lld"
+else
+    LTO_FLAGS="-flto=auto"
+fi
+
+PROFDATA=out/pgo/game.profdata
+
+build_game() {
+    echo "Building libgame.so..."
+    touch lock.tmp
+    $CXX $1 $INCLUDE_FLAGS \
+        -shared -fPIC src/game.cpp -o out/libgame.so
+    rm -f lock.tmp
+}
+
+build_main() {
+    echo "Building main..."
+    $CXX $1 $INCLUDE_FLAGS \
+        src/main.linux.cpp \
+        src/renderer.opengl.cpp \
+        src/util/loader.opengl.cpp \
+        -o out/main \
+        -lGL -lX11 -ldl -lpthread
+}
+
+build_bench() {
+    echo "Building $2..."
+    $CXX $1 $INCLUDE_FLAGS \
+        src/main.bench.cpp \
+        src/game.cpp \
+        src/renderer.null.cpp \
+        -o "$2" \
+        -lpthread
+}
+
+# The order of the sprites is the order of the generated region enum
+build_assets() {
+    echo "Building atlas_packer..."
+    $CXX $1 $INCLUDE_FLAGS \
+        src/tools/atlas_packer.cpp \
+        -o out/atlas_packer
+    ./out/atlas_packer ravioli_atlas \
+        assets/ravioli_atlas.bmp \
+        src/generated/ravioli_atlas.h \
+        assets/ravioli/green_happy.bmp \
+        assets/ravioli/cyan_happy.bmp \
+        assets/ravioli/red_angry.bmp \
+        assets/ravioli/blue_sad.bmp
+}
+
+# Runtime textures, mapped by the platform layer at startup. The packer is
+# only rebuilt when its sources change.
+build_pack() {
+    if [ ! out/asset_packer -nt src/tools/asset_packer.cpp ] ||
+        [ ! out/asset_packer -nt src/platform/asset_pack.h ]; then
+        echo "Building asset_packer..."
+        $CXX $RELEASE_FLAGS $INCLUDE_FLAGS \
+            src/tools/asset_packer.cpp \
+            -o out/asset_packer
+    fi
+    ./out/asset_packer out/assets.rpak \
+        assets/ravioli_atlas.bmp
+}
+
 mkdir -p out
 
-echo "Using compiler: $CXX"
-
-echo "Building libgame.so..."
-touch lock.tmp
-$CXX $COMPILER_FLAGS $INCLUDE_FLAGS \
-    -shared -fPIC src/game.cpp -o out/libgame.so
-rm -f lock.tmp
-
-echo "Building main..."
-$CXX $COMPILER_FLAGS $INCLUDE_FLAGS \
-    src/main.linux.cpp \
-    src/renderer.opengl.cpp \
-    src/util/loader.opengl.cpp \
-    -o out/main \
-    -lGL -lX11 -ldl -lpthread
+echo "Using compiler: $CXX ($CONFIG)"
+
+case "$CONFIG" in
+    debug)
+        build_pack
+        build_game "$DEBUG_FLAGS"
+        build_main "$DEBUG_FLAGS"
+        ;;
+
+    release)
+        # The game stays a separate library, so hot reload still works
+        build_pack
+        build_game "$RELEASE_FLAGS"
+        build_main "$RELEASE_FLAGS $LTO_FLAGS"
+        ;;
+
+    bench)
+        build_bench "$RELEASE_FLAGS $LTO_FLAGS" out/bench
+        echo "Run with: ./out/bench [--frames N] [--sprites N] [--instanced] [--compact]"
+        exit 0
+        ;;
+
+    pgo)
+        if [ "$CXX" != "clang++" ]; then
+            echo "PGO needs clang++ and llvm-profdata"
+            exit 1
+        fi
+
+        # Train on every renderer mode. Profiles are matched by function, so
+        # the game code and the shared command and vertex paths the bench
+        # runs carry over to main and libgame.so.
+        rm -rf out/pgo
+        mkdir -p out/pgo
+        build_bench "$RELEASE_FLAGS $LTO_FLAGS -fprofile-instr-generate" \
+            out/pgo/bench
+        for MODE in "" "--compact" "--instanced" "--sprites 65536"; do
+            LLVM_PROFILE_FILE="out/pgo/bench-%p.profraw" \
+                ./out/pgo/bench --frames 2000 $MODE > /dev/null
+        done
+        llvm-profdata merge -output="$PROFDATA" out/pgo/*.profraw
+
+        PGO_FLAGS="-fprofile-instr-use=$PROFDATA -Wno-profile-instr-unprofiled"
+        build_pack
+        build_game "$RELEASE_FLAGS $PGO_FLAGS"
+        build_main "$RELEASE_FLAGS $LTO_FLAGS $PGO_FLAGS"
+        build_bench "$RELEASE_FLAGS $LTO_FLAGS $PGO_FLAGS" out/bench
+        ;;
+
+    assets)
+        build_assets "$RELEASE_FLAGS"
+        build_pack
+        exit 0
+        ;;
+
+    *)
+        echo "Unknown configuration: $CONFIG"
+        exit 1
+        ;;
+esac
 
 echo "Build complete!"
 echo "Run with: ./out/main"
@@ -2,27 +2,139 @@
 
 set -e
 
-COMPILER_FLAGS="-g -O0 -Wall -Wextra -std=c++23 -fno-exceptions -fno-rtti -Wno-address-of-temporary -Wno-deprecated -Wno-c23-extensions"
+# Usage: build/build_osx.sh [debug|release|bench|pgo|assets]
+#   debug    -O0 with hot reload (default)
+#   release  optimized, LTO across the platform executable's units
+#   bench    headless benchmark (out/bench) with the release flags
+#   pgo      release build trained on the benchmark
+#   assets   repack the sprite atlases, then the asset pack
+# debug, release and pgo also rebuild the asset pack (out/assets.rpak).
+# MARCH picks the target CPU for optimized builds, e.g. MARCH=native.
+CONFIG=${1:-debug}
+
+COMMON_FLAGS="-Wall -Wextra -std=c++23 -fno-exceptions -fno-rtti -Wno-address-of-temporary -Wno-deprecated -Wno-c23-extensions"
+DEBUG_FLAGS="-g -O0 -DARENA_TRACK_SITES=1 $COMMON_FLAGS"
 INCLUDE_FLAGS="-Iinclude -Isrc"
 
+RELEASE_FLAGS="-O2 -DARENA_GUARD_PAGES=0 $COMMON_FLAGS ${MARCH:+-march=$MARCH}"
+LTO_FLAGS="-flto=thin"
+
+PROFDATA=out/pgo/game.profdata
+
+build_game() {
+    echo "Building game.dylib..."
+    touch lock.tmp
+    clang++ $1 $INCLUDE_FLAGS \
+        -dynamiclib src/game.cpp -o out/libgame.dylib
+    rm -f lock.tmp
+}
+
+build_main() {
+    echo "Building main..."
+    clang++ -x objective-c++ $1 $INCLUDE_FLAGS \
+        src/main.osx.mm \
+        src/renderer.opengl.cpp \
+        src/util/loader.opengl.cpp \
+        -o out/main \
+        -fobjc-arc \
+        -framework Cocoa \
+        -framework CoreServices \
+        -framework OpenGL \
+        -framework QuartzCore \
+        -ldl
+}
+
+build_bench() {
+    echo "Building $2..."
+    clang++ $1 $INCLUDE_FLAGS \
+        src/main.bench.cpp \
+        src/game.cpp \
+        src/renderer.null.cpp \
+        -o "$2"
+}
+
+# The order of the sprites is the order of the generated region enum
+build_assets() {
+    echo "Building atlas_packer..."
+    clang++ $1 $INCLUDE_FLAGS \
+        src/tools/atlas_packer.cpp \
+        -o out/atlas_packer
+    ./out/atlas_packer ravioli_atlas \
+        assets/ravioli_atlas.bmp \
+        src/generated/ravioli_atlas.h \
+        assets/ravioli/green_happy.bmp \
+        assets/ravioli/cyan_happy.bmp \
+        assets/ravioli/red_angry.bmp \
+        assets/ravioli/blue_sad.bmp
+}
+
+# Runtime textures, mapped by the platform layer at startup. The packer is
+# only rebuilt when its sources change.
+build_pack() {
+    if [ ! out/asset_packer -nt src/tools/asset_packer.cpp ] ||
+        [ ! out/asset_packer -nt src/platform/asset_pack.h ]; then
+        echo "Building asset_packer..."
+        clang++ $RELEASE_FLAGS $INCLUDE_FLAGS \
+            src/tools/asset_packer.cpp \
+            -o out/asset_packer
+    fi
+    ./out/asset_packer out/assets.rpak \
+        assets/ravioli_atlas.bmp
+}
+
 mkdir -p out
 
-echo "Building game.dylib..."
-touch lock.tmp
-clang++ $COMPILER_FLAGS $INCLUDE_FLAGS \
-    -dynamiclib src/game.cpp -o out/libgame.dylib
-rm -f lock.tmp
-
-echo "Building main..."
-clang++ -x objective-c++ $COMPILER_FLAGS $INCLUDE_FLAGS \
-    src/main.osx.mm \
-    src/renderer.opengl.cpp \
-    src/util/loader.opengl.cpp \
-    -o out/main \
-    -fobjc-arc \
-    -framework Cocoa \
-    -framework OpenGL \
-    -framework QuartzCore \
-    -ldl
+case "$CONFIG" in
+    debug)
+        build_pack
+        build_game "$DEBUG_FLAGS"
+        build_main "$DEBUG_FLAGS"
+        ;;
+
+    release)
+        # The game stays a separate library, so hot reload still works
+        build_pack
+        build_game "$RELEASE_FLAGS"
+        build_main "$RELEASE_FLAGS $LTO_FLAGS"
+        ;;
+
+    bench)
+        build_bench "$RELEASE_FLAGS $LTO_FLAGS" out/bench
+        echo "Run with: ./out/bench [--frames N] [--sprites N] [--instanced] [--compact]"
+        exit 0
+        ;;
+
+    pgo)
+        # Train on every renderer mode. Profiles are matched by function, so
+        # the game code and the shared command and vertex paths the bench
+        # runs carry over to main and libgame.dylib.
+        rm -rf out/pgo
+        mkdir -p out/pgo
+        build_bench "$RELEASE_FLAGS $LTO_FLAGS -fprofile-instr-generate" \
+            out/pgo/bench
+        for MODE in "" "--compact" "--instanced" "--sprites 65536"; do
+            LLVM_PROFILE_FILE="out/pgo/bench-%p.profraw" \
+                ./out/pgo/bench --frames 2000 $MODE > /dev/null
+        done
+        xcrun llvm-profdata merge -output="$PROFDATA" out/pgo/*.profraw
+
+        PGO_FLAGS="-fprofile-instr-use=$PROFDATA -Wno-profile-instr-unprofiled"
+        build_pack
+        build_game "$RELEASE_FLAGS $PGO_FLAGS"
+        build_main "$RELEASE_FLAGS $LTO_FLAGS $PGO_FLAGS"
+        build_bench "$RELEASE_FLAGS $LTO_FLAGS $PGO_FLAGS" out/bench
+        ;;
+
+    assets)
+        build_assets "$RELEASE_FLAGS"
+        build_pack
+        exit 0
+        ;;
+
+    *)
+        echo "Unknown configuration: $CONFIG"
+        exit 1
+        ;;
+esac
 
 echo "Build complete!"
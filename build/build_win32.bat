@@ -2,23 +2,78 @@
 
 setlocal
 
-set COMPILER_FLAGS=-g -O0 -Wall -Wextra -std=c++23 -fno-exceptions -fno-rtti -Wno-address-of-temporary
+rem Usage: build\build_win32.bat [debug|release|assets]
+rem   debug    -O0 with hot reload (default)
+rem   release  optimized, LTO across the platform executable's units
+rem   assets   repack the sprite atlases, then the asset pack
+rem debug and release also rebuild the asset pack (out\assets.rpak).
+rem Set MARCH to pick the target CPU for release builds (default x86-64-v2).
+set CONFIG=%1
+if "%CONFIG%"=="" set CONFIG=debug
+
+set COMMON_FLAGS=-Wall -Wextra -std=c++23 -fno-exceptions -fno-rtti -Wno-address-of-temporary
 set INCLUDE_FLAGS=-Iinclude -Isrc
+if "%MARCH%"=="" set MARCH=x86-64-v2
+
+if "%CONFIG%"=="assets" goto assets
+
+if "%CONFIG%"=="debug" (
+    set GAME_FLAGS=-g -O0 -DARENA_TRACK_SITES=1 %COMMON_FLAGS%
+    set MAIN_FLAGS=-g -O0 -DARENA_TRACK_SITES=1 %COMMON_FLAGS%
+) else if "%CONFIG%"=="release" (
+    rem The game stays a separate DLL, so hot reload still works
+    set GAME_FLAGS=-O2 -DARENA_GUARD_PAGES=0 -march=%MARCH% %COMMON_FLAGS%
+    set MAIN_FLAGS=-O2 -DARENA_GUARD_PAGES=0 -march=%MARCH% -flto=thin -fuse-ld=lld %COMMON_FLAGS%
+) else (
+    echo Unknown configuration: %CONFIG%
+    exit /b 1
+)
 
 if not exist out mkdir out
 
+call :pack
+if errorlevel 1 exit /b 1
+
 echo Building game.dll...
 echo lock > lock.tmp
-clang++ %COMPILER_FLAGS% %INCLUDE_FLAGS% -shared src/game.cpp -o out/game.dll
+clang++ %GAME_FLAGS% %INCLUDE_FLAGS% -shared src/game.cpp -o out/game.dll
 del lock.tmp
 
 echo Building main.exe...
-clang++ %COMPILER_FLAGS% %INCLUDE_FLAGS% ^
+clang++ %MAIN_FLAGS% %INCLUDE_FLAGS% ^
     src/main.win32.cpp ^
     src/renderer.opengl.cpp ^
     src/util/loader.opengl.cpp ^
     -o out/main.exe ^
-    -lopengl32 -lgdi32 -luser32
+    -lopengl32 -lgdi32 -luser32 -lwinmm
 
 echo Build complete!
 echo Run with: out\main.exe
+exit /b 0
+
+rem The order of the sprites is the order of the generated region enum
+:assets
+if not exist out mkdir out
+echo Building atlas_packer.exe...
+clang++ -O2 %COMMON_FLAGS% %INCLUDE_FLAGS% src/tools/atlas_packer.cpp -o out/atlas_packer.exe
+if errorlevel 1 exit /b 1
+out\atlas_packer.exe ravioli_atlas ^
+    assets/ravioli_atlas.bmp ^
+    src/generated/ravioli_atlas.h ^
+    assets/ravioli/green_happy.bmp ^
+    assets/ravioli/cyan_happy.bmp ^
+    assets/ravioli/red_angry.bmp ^
+    assets/ravioli/blue_sad.bmp
+if errorlevel 1 exit /b 1
+call :pack
+exit /b %errorlevel%
+
+rem Runtime textures, mapped by the platform layer at startup
+:pack
+if not exist out\asset_packer.exe (
+    echo Building asset_packer.exe...
+    clang++ -O2 %COMMON_FLAGS% %INCLUDE_FLAGS% src/tools/asset_packer.cpp -o out/asset_packer.exe
+    if errorlevel 1 exit /b 1
+)
+out\asset_packer.exe out/assets.rpak assets/ravioli_atlas.bmp
+exit /b %errorlevel%
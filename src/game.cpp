@@ -1,54 +1,426 @@
 #include "game.h"
+#include "generated/ravioli_atlas.h"
 #include "util/bmp_loader.h"
+#include "util/xorshift.h"
+#include <string.h>
 
-// Simple xorshift RNG
-static u32 xorshift32(u32* state) {
-    u32 x = *state;
-    x ^= x << 13;
-    x ^= x >> 17;
-    x ^= x << 5;
-    *state = x;
-    return x;
+// Ravioli variants index the atlas regions directly and are picked with a
+// two-bit mask
+static_assert(
+    RavioliAtlas_Count == 4,
+    "ravioli variants must cover the atlas regions"
+);
+
+// Run a job on the platform queue, or inline if the platform has none
+static void game_add_job(
+    GameMemory* memory,
+    platform_job_callback* callback,
+    void* data
+) {
+    if (memory->add_job) {
+        memory->add_job(memory->job_queue, callback, data);
+    } else {
+        callback(nullptr, data, 0);
+    }
 }
 
-static f32 random_range(u32* state, f32 min, f32 max) {
-    return min + (f32)(xorshift32(state) % 10000) / 10000.0f * (max - min);
+static void game_complete_all_jobs(GameMemory* memory) {
+    if (memory->complete_all_jobs) {
+        memory->complete_all_jobs(memory->job_queue);
+    }
 }
 
-// Atlas UV coordinates for each ravioli variant
-// Atlas is 32x32 with 4 sprites in 2x2 grid (16x16 each)
-struct SpriteUV {
-    f32 u0, v0, u1, v1;
-};
+// One contiguous range of raviolis processed by a job
+struct RavioliRangeJob {
+    GameState* state;
+    u32 first;
+    u32 count;
+    u32 rng_state;
+    f32 max_x;
+    f32 max_y;
 
-static const SpriteUV RAVIOLI_UVS[4] = {
-    {0.0f, 0.0f, 0.5f, 0.5f}, // Top-left: Green (happy)
-    {0.5f, 0.0f, 1.0f, 0.5f}, // Top-right: Cyan (happy)
-    {0.0f, 0.5f, 0.5f, 1.0f}, // Bottom-left: Red (angry)
-    {0.5f, 0.5f, 1.0f, 1.0f}, // Bottom-right: Blue (sad)
+    // Command recording: the range above when the whole world is in view,
+    // otherwise `count` raviolis filed in a run of the cells in view,
+    // numbered row-major from the top-left one
+    b32 from_cells;
+    SpatialGridCells cells;
+    u32 first_cell;
+    u32 cell_count;
+    f32 view_x;
+    f32 view_y;
+    RenderCommands* render_cmds;
+    RenderCommandSubList* sublist;
+    u32 texture_id;
 };
 
-static void randomize_ravioli_positions(
+static PLATFORM_JOB_CALLBACK(randomize_ravioli_range) {
+    TIMED_FUNCTION();
+    (void)queue;
+    (void)thread_index;
+    RavioliRangeJob* job = (RavioliRangeJob*)data;
+    Raviolis* raviolis = &job->state->raviolis;
+    XorshiftLanes lanes = xorshift_seed_lanes(job->rng_state);
+    u32 first = job->first;
+    xorshift_fill_range(&lanes, raviolis->x + first, job->count, 0, job->max_x);
+    xorshift_fill_range(&lanes, raviolis->y + first, job->count, 0, job->max_y);
+    xorshift_fill_mask(&lanes, raviolis->variant + first, job->count, 3);
+}
+
+// Grid cell of the k-th cell in view, counting row-major
+static u32 visible_cell(SpatialGrid* grid, SpatialGridCells cells, u32 k) {
+    u32 columns = cells.column1 - cells.column0 + 1;
+    return grid->cell_index(
+        cells.column0 + k % columns,
+        cells.row0 + k / columns
+    );
+}
+
+// Records one batch command for the job's cells into a sub-list in the arena
+// of the thread it runs on, in view space
+static PLATFORM_JOB_CALLBACK(record_ravioli_range) {
+    TIMED_FUNCTION();
+    (void)queue;
+    RavioliRangeJob* job = (RavioliRangeJob*)data;
+    GameState* state = job->state;
+    ASSERT(thread_index < state->thread_arena_count);
+
+    RenderCommands recorded = begin_render_sublist(
+        job->render_cmds,
+        &state->thread_arenas[thread_index],
+        atlas_sprite_batch_size(RavioliAtlas_Count, job->count)
+    );
+
+    f32 sprite_size = 16.0f;
+    AtlasSpriteBatch batch = push_atlas_sprite_batch(
+        &recorded,
+        job->texture_id,
+        sprite_size,
+        sprite_size,
+        RAVIOLI_ATLAS_REGIONS,
+        RavioliAtlas_Count,
+        job->count,
+        LAYER_SPRITES
+    );
+    Raviolis* raviolis = &state->raviolis;
+    if (job->from_cells) {
+        // Gather the raviolis cell by cell
+        SpatialGrid* grid = &raviolis->grid;
+        u32 written = 0;
+        u32 end_cell = job->first_cell + job->cell_count;
+        for (u32 k = job->first_cell; k < end_cell; k++) {
+            u32 cell = visible_cell(grid, job->cells, k);
+            for (u32 i = grid->heads[cell]; i != SPATIAL_GRID_NULL;
+                 i = grid->next[i]) {
+                batch.x[written] = raviolis->x[i] - job->view_x;
+                batch.y[written] = raviolis->y[i] - job->view_y;
+                batch.region[written] = raviolis->variant[i];
+                written++;
+            }
+        }
+        ASSERT(written == job->count);
+    } else {
+        // The view is at the origin, and the batch arrays have the same
+        // layout as the ravioli streams
+        u32 first = job->first;
+        memcpy(batch.x, raviolis->x + first, job->count * sizeof(f32));
+        memcpy(batch.y, raviolis->y + first, job->count * sizeof(f32));
+        memcpy(
+            batch.region,
+            raviolis->variant + first,
+            job->count * sizeof(u16)
+        );
+    }
+    for (u32 i = 0; i < job->count; i++) {
+        batch.tint[i] = 0xFFFFFFFF; // White (no tint)
+    }
+
+    end_render_sublist(job->render_cmds, job->sublist, &recorded);
+}
+
+// Split the raviolis into RAVIOLI_JOB_COUNT ranges. Ranges start on whole
+// XORSHIFT_LANES groups so the kernels' vectors stay aligned.
+static void split_ravioli_jobs(
     GameState* state,
-    u32 screen_width,
-    u32 screen_height
+    RavioliRangeJob* jobs,
+    u32 world_width,
+    u32 world_height
 ) {
     f32 sprite_size = 16.0f;
-    for (i32 i = 0; i < RAVIOLI_COUNT; i++) {
-        state->raviolis[i].x =
-            random_range(&state->rng_state, 0, (f32)screen_width - sprite_size);
-        state->raviolis[i].y = random_range(
-            &state->rng_state,
-            0,
-            (f32)screen_height - sprite_size
+    u32 ravioli_count = state->raviolis.index.count;
+    u32 per_job = ravioli_count / RAVIOLI_JOB_COUNT & ~(XORSHIFT_LANES - 1);
+    for (u32 i = 0; i < RAVIOLI_JOB_COUNT; i++) {
+        RavioliRangeJob* job = &jobs[i];
+        *job = {};
+        job->state = state;
+        job->first = i * per_job;
+        job->count = (i == RAVIOLI_JOB_COUNT - 1)
+                         ? ravioli_count - job->first
+                         : per_job;
+        job->max_x = (f32)world_width - sprite_size;
+        job->max_y = (f32)world_height - sprite_size;
+    }
+}
+
+// Split the cells in view into RAVIOLI_JOB_COUNT runs holding about as many
+// raviolis each. Runs may be empty when little is in view.
+static void split_visible_ravioli_jobs(
+    GameState* state,
+    RavioliRangeJob* jobs,
+    SpatialGridCells cells
+) {
+    SpatialGrid* grid = &state->raviolis.grid;
+    u32 cell_count = (cells.column1 - cells.column0 + 1) *
+                     (cells.row1 - cells.row0 + 1);
+    u32 visible_count = 0;
+    for (u32 k = 0; k < cell_count; k++) {
+        visible_count += grid->counts[visible_cell(grid, cells, k)];
+    }
+
+    u32 k = 0;
+    u32 assigned = 0;
+    for (u32 i = 0; i < RAVIOLI_JOB_COUNT; i++) {
+        RavioliRangeJob* job = &jobs[i];
+        *job = {};
+        job->state = state;
+        job->from_cells = true;
+        job->cells = cells;
+        job->first_cell = k;
+        u32 target_end =
+            (u32)((u64)visible_count * (i + 1) / RAVIOLI_JOB_COUNT);
+        while (k < cell_count && assigned + job->count < target_end) {
+            job->count += grid->counts[visible_cell(grid, cells, k)];
+            k++;
+        }
+        if (i == RAVIOLI_JOB_COUNT - 1) {
+            k = cell_count; // Trailing empty cells
+        }
+        job->cell_count = k - job->first_cell;
+        assigned += job->count;
+    }
+}
+
+// The grid, first refiling every ravioli if they were rearranged since it
+// was last used. Not from jobs: the cells' lists are shared between ranges.
+static SpatialGrid* ravioli_grid(Raviolis* raviolis) {
+    if (raviolis->grid_stale) {
+        TIMED_BLOCK("rebuild ravioli grid");
+        raviolis->grid.rebuild(
+            raviolis->x,
+            raviolis->y,
+            raviolis->index.count
         );
-        state->raviolis[i].variant = xorshift32(&state->rng_state) % 4;
+        raviolis->grid_stale = false;
+    }
+    return &raviolis->grid;
+}
+
+static void randomize_ravioli_positions(
+    GameMemory* memory,
+    GameState* state,
+    u32 world_width,
+    u32 world_height
+) {
+    ScratchScope scratch(&memory->frame_arena);
+    RavioliRangeJob* jobs =
+        scratch.arena->push_array<RavioliRangeJob>(RAVIOLI_JOB_COUNT);
+    split_ravioli_jobs(state, jobs, world_width, world_height);
+    for (u32 i = 0; i < RAVIOLI_JOB_COUNT; i++) {
+        // Each range gets its own RNG stream seeded from the state RNG
+        jobs[i].rng_state = xorshift32(&state->rng_state);
+        game_add_job(memory, randomize_ravioli_range, &jobs[i]);
+    }
+    game_complete_all_jobs(memory);
+    state->raviolis.grid_stale = true;
+}
+
+// Push stream storage for `capacity` raviolis, aligned for the kernels, and
+// a grid over a world of up to world_screens of the largest targets
+static Raviolis
+make_raviolis(MemoryArena* arena, u32 capacity, u32 world_screens) {
+    Raviolis result = {};
+    result.index = PoolIndex::make(arena, capacity);
+    result.x = (f32*)arena->push_size(
+        capacity * sizeof(f32),
+        RAVIOLI_STREAM_ALIGNMENT
+    );
+    result.y = (f32*)arena->push_size(
+        capacity * sizeof(f32),
+        RAVIOLI_STREAM_ALIGNMENT
+    );
+    result.variant = (u16*)arena->push_size(
+        capacity * sizeof(u16),
+        RAVIOLI_STREAM_ALIGNMENT
+    );
+    result.grid = SpatialGrid::make(
+        arena,
+        capacity,
+        (f32)(world_screens * GAME_MAX_TARGET_WIDTH),
+        (f32)(world_screens * GAME_MAX_TARGET_HEIGHT),
+        RAVIOLI_GRID_CELL_SIZE
+    );
+    return result;
+}
+
+// Add a ravioli at the end of the streams. Returns its dense position, or
+// POOL_NULL_INDEX if the pool is full.
+static u32 add_ravioli(Raviolis* raviolis, f32 x, f32 y, u16 variant) {
+    if (pool_handle_is_null(raviolis->index.add())) {
+        return POOL_NULL_INDEX;
+    }
+    u32 i = raviolis->index.count - 1;
+    raviolis->x[i] = x;
+    raviolis->y[i] = y;
+    raviolis->variant[i] = variant;
+    if (!raviolis->grid_stale) {
+        raviolis->grid.insert(i, x, y);
+    }
+    return i;
+}
+
+static void remove_ravioli(Raviolis* raviolis, PoolHandle handle) {
+    u32 hole = raviolis->index.remove(handle);
+    if (hole == POOL_NULL_INDEX) {
+        return;
+    }
+    u32 last = raviolis->index.count;
+    if (!raviolis->grid_stale) {
+        raviolis->grid.remove(hole);
+        raviolis->grid.relocate(last, hole);
+    }
+    raviolis->x[hole] = raviolis->x[last];
+    raviolis->y[hole] = raviolis->y[last];
+    raviolis->variant[hole] = raviolis->variant[last];
+}
+
+// Add up to `count` raviolis at random positions until the pool is full
+static void spawn_raviolis(
+    GameState* state,
+    u32 count,
+    u32 world_width,
+    u32 world_height
+) {
+    f32 sprite_size = 16.0f;
+    f32 max_x = (f32)world_width - sprite_size;
+    f32 max_y = (f32)world_height - sprite_size;
+    for (u32 i = 0; i < count; i++) {
+        f32 x = xorshift_range(&state->rng_state, 0, max_x);
+        f32 y = xorshift_range(&state->rng_state, 0, max_y);
+        u16 variant = (u16)(xorshift32(&state->rng_state) & 3);
+        if (add_ravioli(&state->raviolis, x, y, variant) == POOL_NULL_INDEX) {
+            break;
+        }
+    }
+}
+
+// Remove up to `count` raviolis picked at random
+static void despawn_raviolis(GameState* state, u32 count) {
+    PoolIndex* index = &state->raviolis.index;
+    for (u32 i = 0; i < count && index->count > 0; i++) {
+        u32 dense_index = xorshift32(&state->rng_state) % index->count;
+        remove_ravioli(&state->raviolis, index->handle_at(dense_index));
+    }
+}
+
+// Floor tiles are untextured, tinted squares
+static const AtlasRegion FLOOR_REGIONS[] = {{0.0f, 0.0f, 1.0f, 1.0f}};
+
+static Color floor_tile_color(u32 column, u32 row) {
+    return ((column + row) & 1) ? 0x202020FF : 0x1A1A1AFF;
+}
+
+// Lay a checkered floor over a world of up to world_screens of the largest
+// targets
+static void init_floor(GameState* state) {
+    u32 tile = FLOOR_TILE_SIZE;
+    u32 world_width = state->world_screens * GAME_MAX_TARGET_WIDTH;
+    u32 world_height = state->world_screens * GAME_MAX_TARGET_HEIGHT;
+    u32 columns = (world_width + tile - 1) / tile;
+    u32 rows = (world_height + tile - 1) / tile;
+    state->floor = StaticSpriteLayer::make(
+        &state->permanent_arena,
+        FLOOR_STATIC_LAYER,
+        columns * rows,
+        0, // White texture
+        (f32)tile,
+        (f32)tile,
+        FLOOR_REGIONS,
+        1
+    );
+    state->floor_columns = columns;
+    for (u32 row = 0; row < rows; row++) {
+        for (u32 column = 0; column < columns; column++) {
+            state->floor.set(
+                row * columns + column,
+                (f32)(column * tile),
+                (f32)(row * tile),
+                0,
+                floor_tile_color(column, row)
+            );
+        }
+    }
+}
+
+// Give `count` random floor tiles a random shade, which resends only the
+// span between them
+static void repaint_floor_tiles(GameState* state, u32 count) {
+    StaticSpriteLayer* floor = &state->floor;
+    for (u32 i = 0; i < count; i++) {
+        u32 tile = xorshift32(&state->rng_state) % floor->count;
+        u8 shade = (u8)(0x20 + (xorshift32(&state->rng_state) & 0x1F));
+        Color color = color_rgba(shade, shade, (u8)(shade + 8), 0xFF);
+        floor->set(tile, floor->x[tile], floor->y[tile], 0, color);
+    }
+}
+
+// Carve one sub-arena per job thread out of transient storage
+static void init_thread_arenas(GameMemory* memory, GameState* state) {
+    state->transient_arena = MemoryArena::make(
+        memory->transient_storage,
+        memory->transient_storage_size
+    );
+#if ARENA_TRACK_SITES
+    state->transient_arena.sites =
+        state->permanent_arena.push_struct_zero<ArenaSiteTable>();
+#endif
+
+    u32 thread_count = memory->job_thread_count;
+    if (thread_count == 0) {
+        thread_count = 1;
+    }
+    ASSERT(thread_count <= GAME_MAX_JOB_THREADS);
+
+    // Enough for one thread to end up recording every range of a full pool
+    u32 capacity = state->raviolis.index.capacity;
+    u32 regions = RavioliAtlas_Count;
+    usize arena_size =
+        atlas_sprite_batch_size(regions, capacity) +
+        RAVIOLI_JOB_COUNT * (atlas_sprite_batch_size(regions, 0) + 4);
+    if (arena_size < THREAD_ARENA_SIZE) {
+        arena_size = THREAD_ARENA_SIZE;
     }
+    for (u32 frame = 0; frame < GAME_FRAMES_IN_FLIGHT; frame++) {
+        for (u32 i = 0; i < thread_count; i++) {
+            void* base = state->transient_arena.push_size(arena_size);
+            MemoryArena* arena = &state->frame_thread_arenas[frame][i];
+            *arena = MemoryArena::make(base, arena_size);
+#if ARENA_TRACK_SITES
+            arena->sites =
+                state->permanent_arena.push_struct_zero<ArenaSiteTable>();
+#endif
+        }
+    }
+    state->thread_arenas = state->frame_thread_arenas[0];
+    state->thread_arena_count = thread_count;
 }
 
 extern "C" {
 
 GAME_UPDATE_AND_RENDER(game_update_and_render) {
+    if (g_profiler != memory->profiler) {
+        g_profiler = memory->profiler; // First frame after a (re)load
+    }
+    TIMED_FUNCTION();
+
     GameState* state = (GameState*)memory->permanent_storage;
 
     if (!memory->is_initialized) {
@@ -56,16 +428,41 @@ GAME_UPDATE_AND_RENDER(game_update_and_render) {
             (u8*)memory->permanent_storage + sizeof(GameState),
             memory->permanent_storage_size - sizeof(GameState)
         );
+#if ARENA_TRACK_SITES
+        state->permanent_arena.sites =
+            state->permanent_arena.push_struct_zero<ArenaSiteTable>();
+#endif
+
+        u32 ravioli_count = memory->sprite_count ? memory->sprite_count
+                                                 : RAVIOLI_DEFAULT_COUNT;
+        state->world_screens = memory->world_screens ? memory->world_screens
+                                                     : WORLD_DEFAULT_SCREENS;
+        state->raviolis = make_raviolis(
+            &state->permanent_arena,
+            ravioli_count * RAVIOLI_CAPACITY_FACTOR,
+            state->world_screens
+        );
+        for (u32 i = 0; i < ravioli_count; i++) {
+            add_ravioli(&state->raviolis, 0.0f, 0.0f, 0);
+        }
 
         state->atlas_loaded = false;
         state->rng_state = 12345; // Seed
         state->rearrange_timer = REARRANGE_INTERVAL;
+        state->camera_x = 0.0f;
+        state->camera_y = 0.0f;
+        state->prev_camera_x = 0.0f;
+        state->prev_camera_y = 0.0f;
+
+        init_thread_arenas(memory, state);
+        init_floor(state);
 
         // Initialize ravioli positions
         randomize_ravioli_positions(
+            memory,
             state,
-            render_cmds->width,
-            render_cmds->height
+            state->world_screens * render_cmds->width,
+            state->world_screens * render_cmds->height
         );
 
         memory->is_initialized = true;
@@ -75,44 +472,167 @@ GAME_UPDATE_AND_RENDER(game_update_and_render) {
     // Note: This happens in the game DLL context, texture loading is deferred
     // For now, we'll use a simple approach - load via platform if not loaded
 
+    // Per-thread scratch lives until the platform is done with the frame
+    state->frame_index++;
+    state->thread_arenas =
+        state->frame_thread_arenas[state->frame_index % GAME_FRAMES_IN_FLIGHT];
+    for (u32 i = 0; i < state->thread_arena_count; i++) {
+        state->thread_arenas[i].clear();
+    }
+
     f32 dt = input->dt_for_frame;
+    u32 world_width = state->world_screens * render_cmds->width;
+    u32 world_height = state->world_screens * render_cmds->height;
 
-    // Update rearrange timer
-    state->rearrange_timer -= dt;
-    if (state->rearrange_timer <= 0.0f) {
-        randomize_ravioli_positions(
-            state,
-            render_cmds->width,
-            render_cmds->height
-        );
-        state->rearrange_timer = REARRANGE_INTERVAL;
+    // Fixed-step simulation. The raviolis jump between positions rather than
+    // move, so rendering uses their latest tick as is; only the camera is
+    // interpolated by render_alpha.
+    for (u32 tick = 0; tick < input->sim_ticks; tick++) {
+        state->prev_camera_x = state->camera_x;
+        state->prev_camera_y = state->camera_y;
+        f32 step = CAMERA_SPEED * dt;
+        if (input->move_left.ended_down) {
+            state->camera_x -= step;
+        }
+        if (input->move_right.ended_down) {
+            state->camera_x += step;
+        }
+        if (input->move_up.ended_down) {
+            state->camera_y -= step;
+        }
+        if (input->move_down.ended_down) {
+            state->camera_y += step;
+        }
+        f32 max_camera_x = (f32)(world_width - render_cmds->width);
+        f32 max_camera_y = (f32)(world_height - render_cmds->height);
+        if (state->camera_x > max_camera_x) {
+            state->camera_x = max_camera_x;
+        }
+        if (state->camera_x < 0.0f) {
+            state->camera_x = 0.0f;
+        }
+        if (state->camera_y > max_camera_y) {
+            state->camera_y = max_camera_y;
+        }
+        if (state->camera_y < 0.0f) {
+            state->camera_y = 0.0f;
+        }
+
+        if (input->mouse_buttons[0].ended_down) {
+            spawn_raviolis(
+                state,
+                RAVIOLI_SPAWN_PER_TICK,
+                world_width,
+                world_height
+            );
+        }
+        if (input->mouse_buttons[1].ended_down) {
+            despawn_raviolis(state, RAVIOLI_SPAWN_PER_TICK);
+        }
+        if (input->action.ended_down) {
+            repaint_floor_tiles(state, FLOOR_REPAINT_PER_TICK);
+        }
+
+        // Update rearrange timer
+        state->rearrange_timer -= dt;
+        if (state->rearrange_timer <= 0.0f) {
+            randomize_ravioli_positions(
+                memory,
+                state,
+                world_width,
+                world_height
+            );
+            state->rearrange_timer += REARRANGE_INTERVAL;
+        }
     }
 
+    // Sprites only need painter's order where they overlap by texture, so let
+    // the platform group that layer by texture
+    render_cmds->sorted_layer_mask |= (1u << LAYER_SPRITES);
+
     // Clear command
-    RenderCommandClear* clear_cmd =
-        render_cmds->arena.push_struct<RenderCommandClear>();
-    clear_cmd->header.type = RenderCommand_Clear;
+    RenderCommandClear* clear_cmd = push_render_command<RenderCommandClear>(
+        render_cmds,
+        RenderCommand_Clear,
+        LAYER_BACKGROUND
+    );
     clear_cmd->color = 0x1A1A1AFF; // Dark gray
 
-    // Render all raviolis
-    f32 sprite_size = 16.0f;
-    for (i32 i = 0; i < RAVIOLI_COUNT; i++) {
-        const Ravioli& r = state->raviolis[i];
-        const SpriteUV& uv = RAVIOLI_UVS[r.variant];
-
-        RenderCommandAtlasSprite* cmd =
-            render_cmds->arena.push_struct<RenderCommandAtlasSprite>();
-        cmd->header.type = RenderCommand_AtlasSprite;
-        cmd->x = r.x;
-        cmd->y = r.y;
-        cmd->w = sprite_size;
-        cmd->h = sprite_size;
-        cmd->u0 = uv.u0;
-        cmd->v0 = uv.v0;
-        cmd->u1 = uv.u1;
-        cmd->v1 = uv.v1;
-        cmd->texture_id = state->atlas_texture_id; // Will be set by platform
-        cmd->tint = 0xFFFFFFFF;                    // White (no tint)
+    // The view snaps to whole target pixels so the sprites stay crisp
+    f32 alpha = input->render_alpha;
+    f32 view_x = state->prev_camera_x +
+                 (state->camera_x - state->prev_camera_x) * alpha;
+    f32 view_y = state->prev_camera_y +
+                 (state->camera_y - state->prev_camera_y) * alpha;
+    view_x = (f32)(i32)(view_x + 0.5f);
+    view_y = (f32)(i32)(view_y + 0.5f);
+
+    // The floor stays on the GPU; only tiles repainted since last frame ride
+    // along with its draw. Tiles are row-major, so the rows in view are one
+    // contiguous range.
+    StaticSpriteLayer* floor = &state->floor;
+    u32 floor_row0 = (u32)(view_y / FLOOR_TILE_SIZE);
+    u32 floor_row1 =
+        (u32)((view_y + (f32)render_cmds->height) / FLOOR_TILE_SIZE) + 1;
+    u32 floor_first = floor_row0 * state->floor_columns;
+    u32 floor_end = floor_row1 * state->floor_columns;
+    floor_first = (floor_first < floor->count) ? floor_first : floor->count;
+    floor_end = (floor_end < floor->count) ? floor_end : floor->count;
+    push_static_sprite_layer_range(
+        render_cmds,
+        floor,
+        floor_first,
+        floor_end - floor_first,
+        view_x,
+        view_y,
+        LAYER_BACKGROUND
+    );
+
+    // Record the visible raviolis in parallel, one batch command per run of
+    // cells. The sub-lists replay in run order no matter which job finishes
+    // first. A world that fits in the view is all drawn, so it is copied in
+    // dense ranges instead, which is faster than walking the cells.
+    RavioliRangeJob* jobs =
+        memory->frame_arena.push_array<RavioliRangeJob>(RAVIOLI_JOB_COUNT);
+    if (world_width <= render_cmds->width &&
+        world_height <= render_cmds->height) {
+        split_ravioli_jobs(state, jobs, world_width, world_height);
+    } else {
+        // Only cells that can show a sprite in the target: raviolis are
+        // filed by their top-left corner, so the query reaches one sprite
+        // further up and left than the view
+        f32 sprite_size = 16.0f;
+        SpatialGridCells cells =
+            ravioli_grid(&state->raviolis)
+                ->cells_overlapping(
+                    view_x - sprite_size,
+                    view_y - sprite_size,
+                    view_x + (f32)render_cmds->width,
+                    view_y + (f32)render_cmds->height
+                );
+        split_visible_ravioli_jobs(state, jobs, cells);
+    }
+    for (u32 i = 0; i < RAVIOLI_JOB_COUNT; i++) {
+        jobs[i].view_x = view_x;
+        jobs[i].view_y = view_y;
+        jobs[i].render_cmds = render_cmds;
+        jobs[i].sublist = push_render_sublist(render_cmds);
+        jobs[i].texture_id = state->atlas_texture_id; // Set by platform
+    }
+    for (u32 i = 0; i < RAVIOLI_JOB_COUNT; i++) {
+        game_add_job(memory, record_ravioli_range, &jobs[i]);
+    }
+    game_complete_all_jobs(memory);
+
+    if (g_profiler) {
+        profiler_report_arena(g_profiler, "permanent", &state->permanent_arena);
+        profiler_report_arena(g_profiler, "transient", &state->transient_arena);
+        profiler_report_arenas(
+            g_profiler,
+            "job commands",
+            state->thread_arenas,
+            state->thread_arena_count
+        );
     }
 }
 
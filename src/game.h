@@ -1,24 +1,91 @@
 #pragma once
 
 #include "game_interface.h"
+#include "lib/pool.h"
+#include "lib/spatial_grid.h"
 
 // Demo configuration
-#define RAVIOLI_COUNT 8192
+#define RAVIOLI_DEFAULT_COUNT 8192 // When GameMemory::sprite_count is 0
+#define RAVIOLI_CAPACITY_FACTOR 2  // Pool room over the starting count
+#define RAVIOLI_SPAWN_PER_TICK 64  // While a mouse button is held
 #define REARRANGE_INTERVAL 0.1f
 
-struct Ravioli {
-    f32 x;
-    f32 y;
-    u32 variant; // 0-3: which sprite in the atlas
+// The world is this many screens along each axis when
+// GameMemory::world_screens is 0, and the move buttons pan the view across it
+#define WORLD_DEFAULT_SCREENS 1
+#define CAMERA_SPEED 240.0f // Pixels per second
+
+// Two sprites across, so a cell in view is mostly drawn
+#define RAVIOLI_GRID_CELL_SIZE 32.0f
+
+// Checkered floor under the whole world, drawn from a retained layer. The
+// action button repaints random tiles while held.
+#define FLOOR_STATIC_LAYER 0
+#define FLOOR_TILE_SIZE 16
+#define FLOOR_REPAINT_PER_TICK 4
+
+// Raviolis are updated in this many ranges. Fixed rather than derived from
+// the thread count so the RNG streams, and the result, are the same on every
+// machine.
+#define RAVIOLI_JOB_COUNT 32
+
+// Minimum scratch reserved out of transient storage for each job thread;
+// grows with the ravioli count so one thread can record every range
+#define THREAD_ARENA_SIZE MB(4)
+
+// Render layers
+#define LAYER_BACKGROUND 0
+#define LAYER_SPRITES 1
+
+// Raviolis as structure of arrays: one stream per field, for the vector
+// update kernels and straight copies into batch commands. Dense position i in
+// every stream is the same ravioli, and `index` hands out the handles.
+// `grid` files the same dense positions by where they are in the world; it
+// follows adds and removes, and is rebuilt on next use after a rearrange.
+#define RAVIOLI_STREAM_ALIGNMENT 32
+
+struct Raviolis {
+    PoolIndex index;
+    f32* x;
+    f32* y;
+    u16* variant; // 0-3: which sprite in the atlas
+    SpatialGrid grid;
+    b32 grid_stale; // Positions moved since the grid was built
 };
 
 struct GameState {
     b32 atlas_loaded;
     u32 atlas_texture_id;
 
-    Ravioli raviolis[RAVIOLI_COUNT];
+    // In permanent_arena. Left mouse button spawns, right despawns.
+    Raviolis raviolis;
     f32 rearrange_timer;
     u32 rng_state; // Simple RNG state
 
+    // The world is world_screens targets along each axis, so it changes
+    // with the target size; the view's top-left corner is panned over it
+    // once per tick
+    u32 world_screens;
+    f32 camera_x;
+    f32 camera_y;
+    f32 prev_camera_x;
+    f32 prev_camera_y;
+
+    // One tile per FLOOR_TILE_SIZE square of the largest world, in
+    // permanent_arena
+    StaticSpriteLayer floor;
+    u32 floor_columns;
+
     MemoryArena permanent_arena;
+
+    // Per-job-thread sub-arenas carved out of transient storage, indexed by
+    // the thread_index a job runs on. Sub-lists record into them, so there is
+    // one set per frame in flight; thread_arenas points at this frame's set,
+    // which is cleared when the frame starts.
+    MemoryArena transient_arena;
+    MemoryArena frame_thread_arenas[GAME_FRAMES_IN_FLIGHT]
+                                   [GAME_MAX_JOB_THREADS];
+    MemoryArena* thread_arenas;
+    u32 thread_arena_count;
+    u32 frame_index;
 };
@@ -2,18 +2,68 @@
 
 #include "lib/def.h"
 #include "lib/memory_arena.h"
+#include "lib/profiler.h"
+#include <string.h>
 
 #define GAME_CODE_VERSION 1
 
 #define MB(value) ((value) * 1024LL * 1024LL)
 #define KB(value) ((value) * 1024LL)
 
+// Job system provided by the platform (see platform/job_queue.h). Callbacks
+// run on any job thread; thread_index is 0 for the thread that owns the queue
+// and 1..job_thread_count-1 for workers, so it can index per-thread data.
+struct PlatformJobQueue;
+
+#define GAME_MAX_JOB_THREADS 16
+
+#define PLATFORM_JOB_CALLBACK(name)                                            \
+    void name(PlatformJobQueue* queue, void* data, u32 thread_index)
+typedef PLATFORM_JOB_CALLBACK(platform_job_callback);
+
+#define PLATFORM_ADD_JOB(name)                                                 \
+    void name(                                                                 \
+        PlatformJobQueue* queue,                                               \
+        platform_job_callback* callback,                                       \
+        void* data                                                             \
+    )
+typedef PLATFORM_ADD_JOB(platform_add_job_func);
+
+#define PLATFORM_COMPLETE_ALL_JOBS(name) void name(PlatformJobQueue* queue)
+typedef PLATFORM_COMPLETE_ALL_JOBS(platform_complete_all_jobs_func);
+
 struct GameMemory {
     b32 is_initialized;
     u64 permanent_storage_size;
     void* permanent_storage;
     u64 transient_storage_size;
     void* transient_storage;
+
+    // Job system; add_job is null if the platform runs everything inline.
+    // All jobs must be completed before update_and_render returns, since the
+    // callbacks live in the reloadable game code.
+    PlatformJobQueue* job_queue;
+    u32 job_thread_count; // Including the calling thread
+    platform_add_job_func* add_job;
+    platform_complete_all_jobs_func* complete_all_jobs;
+
+    // Platform-owned profiler; the game points its g_profiler here every
+    // frame so timings survive reloads. Null if profiling is unavailable.
+    Profiler* profiler;
+    // Number of sprites the demo simulates, read once at initialization;
+    // 0 picks the game's default
+    u32 sprite_count;
+    // World size in screens along each axis, read once at initialization;
+    // 0 picks the game's default
+    u32 world_screens;
+
+    // Scratch reserved by the platform, growing as needed, and reset before
+    // every update_and_render, so nothing in it may outlive the call; render
+    // commands in particular must not point into it. Job callbacks use
+    // thread_scratch[thread_index], one per job thread. Release nested
+    // allocations early with TemporaryMemory or ScratchScope.
+    MemoryArena frame_arena;
+    MemoryArena thread_scratch[GAME_MAX_JOB_THREADS];
 };
 
 struct GameButtonState {
@@ -21,8 +71,17 @@ struct GameButtonState {
     i32 half_transition_count;
 };
 
+// Simulation rate the platform paces the game at
+#define GAME_TICKS_PER_SECOND 60
+
 struct GameInput {
+    // The platform runs the simulation on a fixed step: update_and_render
+    // advances sim_ticks ticks of dt_for_frame seconds each (possibly 0 on
+    // fast frames), then renders render_alpha of the way from the previous
+    // tick's state to the current one.
     f32 dt_for_frame;
+    u32 sim_ticks;
+    f32 render_alpha;
 
     GameButtonState move_up;
     GameButtonState move_down;
@@ -40,10 +99,25 @@ enum RenderCommandType {
     RenderCommand_Rect,
     RenderCommand_Sprite,
     RenderCommand_AtlasSprite,
+    RenderCommand_AtlasSpriteBatch,
+    RenderCommand_StaticLayer,
+    RenderCommand_SubList,
+};
+
+enum RenderBlendMode {
+    RenderBlend_Alpha,
+    RenderBlend_Additive,
 };
 
+// Layers execute in ascending order. Commands within a layer keep submission
+// order unless the layer's bit is set in RenderCommands::sorted_layer_mask, in
+// which case they are grouped by blend mode and texture to minimize flushes.
+#define RENDER_LAYER_COUNT 32
+
 struct RenderCommandHeader {
     RenderCommandType type;
+    u8 layer;
+    u8 blend_mode; // RenderBlendMode
 };
 
 struct RenderCommandClear {
@@ -72,12 +146,437 @@ struct RenderCommandAtlasSprite {
     Color tint;
 };
 
+// UV rect of one sub-image in an atlas texture
+struct AtlasRegion {
+    f32 u0, v0, u1, v1;
+};
+
+// Many same-sized sprites from one atlas in a single command. The per-sprite
+// data is stored as tightly packed arrays directly after the command (see
+// atlas_sprite_batch_arrays), 14 bytes per sprite instead of a full
+// RenderCommandAtlasSprite:
+//   AtlasRegion regions[region_count]  UV table indexed by region[]
+//   f32 x[count]
+//   f32 y[count]
+//   Color tint[count]
+//   u16 region[count]                  padded to 4 bytes
+struct RenderCommandAtlasSpriteBatch {
+    RenderCommandHeader header;
+    u32 size; // Total bytes including the arrays
+    u32 texture_id;
+    f32 w, h; // Destination size shared by all sprites
+    u32 region_count;
+    u32 count;
+};
+
+struct AtlasSpriteBatch {
+    RenderCommandAtlasSpriteBatch* command;
+    AtlasRegion* regions;
+    f32* x;
+    f32* y;
+    Color* tint;
+    u16* region;
+};
+
+inline usize atlas_sprite_batch_size(u32 region_count, u32 count) {
+    usize size = sizeof(RenderCommandAtlasSpriteBatch);
+    size += region_count * sizeof(AtlasRegion);
+    size += count * (2 * sizeof(f32) + sizeof(Color) + sizeof(u16));
+    return (size + 3) & ~(usize)3;
+}
+
+// Resolve the array pointers of a batch command
+inline AtlasSpriteBatch
+atlas_sprite_batch_arrays(RenderCommandAtlasSpriteBatch* command) {
+    AtlasSpriteBatch result = {};
+    result.command = command;
+    result.regions = (AtlasRegion*)(command + 1);
+    result.x = (f32*)(result.regions + command->region_count);
+    result.y = result.x + command->count;
+    result.tint = (Color*)(result.y + command->count);
+    result.region = (u16*)(result.tint + command->count);
+    return result;
+}
+
+// Draws a retained sprite layer: same-sized atlas sprites the renderer keeps
+// resident in a GPU buffer of its own, so a frame that changes nothing sends
+// this command alone and costs one draw whatever the sprite count. Sprites
+// [first, first + update_count) are resent in the same arrays as a batch
+// command, for the renderer to write into the layer before drawing it:
+//   AtlasRegion regions[region_count]  Empty when update_count is 0
+//   f32 x[update_count]
+//   f32 y[update_count]
+//   Color tint[update_count]
+//   u16 region[update_count]           padded to 4 bytes
+// Sprites [draw_first, draw_first + draw_count) are drawn, so a layer laid
+// out in rows can draw just the rows in view. Layers are named by the game;
+// capacity is fixed when one is first drawn, and its sprites are undefined
+// until they have been sent. Positions are in the layer's own space and
+// offset_x/offset_y are subtracted on the GPU, so a layer can scroll with
+// the camera without being resent.
+#define RENDER_MAX_STATIC_LAYERS 16
+
+struct RenderCommandStaticLayer {
+    RenderCommandHeader header;
+    u32 size; // Total bytes including the arrays
+    u32 layer_id; // 0..RENDER_MAX_STATIC_LAYERS-1
+    u32 capacity;
+    u32 draw_first;
+    u32 draw_count;
+    u32 texture_id;
+    f32 w, h; // Destination size shared by all sprites
+    f32 offset_x, offset_y;
+    u32 region_count;
+    u32 first;
+    u32 update_count;
+};
+
+struct StaticLayerUpdate {
+    RenderCommandStaticLayer* command;
+    AtlasRegion* regions;
+    f32* x;
+    f32* y;
+    Color* tint;
+    u16* region;
+};
+
+inline usize static_layer_command_size(u32 region_count, u32 update_count) {
+    usize size = sizeof(RenderCommandStaticLayer);
+    size += region_count * sizeof(AtlasRegion);
+    size += update_count * (2 * sizeof(f32) + sizeof(Color) + sizeof(u16));
+    return (size + 3) & ~(usize)3;
+}
+
+// Resolve the array pointers of a static layer command
+inline StaticLayerUpdate
+static_layer_update_arrays(RenderCommandStaticLayer* command) {
+    StaticLayerUpdate result = {};
+    result.command = command;
+    result.regions = (AtlasRegion*)(command + 1);
+    result.x = (f32*)(result.regions + command->region_count);
+    result.y = result.x + command->update_count;
+    result.tint = (Color*)(result.y + command->update_count);
+    result.region = (u16*)(result.tint + command->update_count);
+    return result;
+}
+
+// Placeholder in the main stream for commands recorded elsewhere, usually by
+// a job into its thread's arena. The sub-list's commands replay in place of
+// this command, so the main thread decides the order by where it pushes the
+// placeholder, regardless of which thread finishes first.
+struct RenderCommandSubList {
+    RenderCommandHeader header;
+    u32 index; // Into RenderCommands::sublists
+};
+
+#define RENDER_MAX_SUBLISTS 64
+
+// Recorded range of a sub-list. Empty until the recording job ends it.
+struct RenderSubList {
+    u8* base;
+    usize used;
+};
+
+// The platform may replay a frame's commands on a render thread while the
+// game records the next one, so memory that commands point at (sub-lists)
+// must stay valid for this many frames.
+#define GAME_FRAMES_IN_FLIGHT 2
+
+// Largest target the platform renders at (see platform_target_size), so the
+// most of the world one frame can show
+#define GAME_MAX_TARGET_WIDTH 384
+#define GAME_MAX_TARGET_HEIGHT 216
+
 struct RenderCommands {
     u32 width;
     u32 height;
+    u32 sorted_layer_mask; // Bit per layer that may be reordered for batching
     MemoryArena arena;
+
+    RenderSubList sublists[RENDER_MAX_SUBLISTS];
+    u32 sublist_count;
 };
 
+// Push a command and fill in its header
+template <typename T>
+inline T* push_render_command(
+    RenderCommands* commands,
+    RenderCommandType type,
+    u8 layer = 0,
+    RenderBlendMode blend_mode = RenderBlend_Alpha,
+    const char* site_file = ARENA_SITE_FILE,
+    u32 site_line = ARENA_SITE_LINE
+) {
+    T* result = commands->arena.push_struct<T>(site_file, site_line);
+    result->header.type = type;
+    result->header.layer = layer;
+    result->header.blend_mode = (u8)blend_mode;
+    return result;
+}
+
+// Push a batch of `count` sprites and copy in the region table. The caller
+// fills x, y, tint and region for every sprite.
+inline AtlasSpriteBatch push_atlas_sprite_batch(
+    RenderCommands* commands,
+    u32 texture_id,
+    f32 w,
+    f32 h,
+    const AtlasRegion* regions,
+    u32 region_count,
+    u32 count,
+    u8 layer = 0,
+    RenderBlendMode blend_mode = RenderBlend_Alpha,
+    const char* site_file = ARENA_SITE_FILE,
+    u32 site_line = ARENA_SITE_LINE
+) {
+    usize size = atlas_sprite_batch_size(region_count, count);
+    RenderCommandAtlasSpriteBatch* command =
+        (RenderCommandAtlasSpriteBatch*)commands->arena.push_size(
+            size,
+            alignof(RenderCommandAtlasSpriteBatch),
+            site_file,
+            site_line
+        );
+    command->header.type = RenderCommand_AtlasSpriteBatch;
+    command->header.layer = layer;
+    command->header.blend_mode = (u8)blend_mode;
+    command->size = (u32)size;
+    command->texture_id = texture_id;
+    command->w = w;
+    command->h = h;
+    command->region_count = region_count;
+    command->count = count;
+
+    AtlasSpriteBatch result = atlas_sprite_batch_arrays(command);
+    for (u32 i = 0; i < region_count; i++) {
+        result.regions[i] = regions[i];
+    }
+    return result;
+}
+
+// Game-side copy of a retained sprite layer. Sprites are edited here and
+// remembered as one dirty span, which push_static_sprite_layer resends and
+// clears. Changing the texture dirties the whole layer, since the renderer
+// bakes texture placement into the resident quads. Edits far apart resend
+// everything between them.
+//
+//   StaticSpriteLayer floor = StaticSpriteLayer::make(
+//       &arena, 0, 4096, tiles_texture, 16, 16, TILE_REGIONS, TileCount);
+//   floor.set(i, x, y, TileGrass, 0xFFFFFFFF);
+//   push_static_sprite_layer(render_cmds, &floor, camera_x, camera_y, 0);
+struct StaticSpriteLayer {
+    u32 id;
+    u32 capacity;
+    u32 count;
+    u32 texture_id;
+    f32 w, h;
+    AtlasRegion* regions; // Copied, so code reloads don't leave it dangling
+    u32 region_count;
+
+    f32* x;
+    f32* y;
+    Color* tint;
+    u16* region;
+
+    u32 dirty_first;
+    u32 dirty_end; // Nothing to resend when equal to dirty_first
+
+    // Push the sprite arrays from `arena` for a layer named `id`
+    static StaticSpriteLayer make(
+        MemoryArena* arena,
+        u32 id,
+        u32 capacity,
+        u32 texture_id,
+        f32 w,
+        f32 h,
+        const AtlasRegion* regions,
+        u32 region_count
+    ) {
+        ASSERT(id < RENDER_MAX_STATIC_LAYERS);
+        StaticSpriteLayer result = {};
+        result.id = id;
+        result.capacity = capacity;
+        result.texture_id = texture_id;
+        result.w = w;
+        result.h = h;
+        result.regions = arena->push_array<AtlasRegion>(region_count);
+        memcpy(result.regions, regions, region_count * sizeof(AtlasRegion));
+        result.region_count = region_count;
+        result.x = arena->push_array<f32>(capacity);
+        result.y = arena->push_array<f32>(capacity);
+        result.tint = arena->push_array<Color>(capacity);
+        result.region = arena->push_array<u16>(capacity);
+        return result;
+    }
+
+    void mark_dirty(u32 first, u32 end) {
+        if (dirty_first == dirty_end) {
+            dirty_first = first;
+            dirty_end = end;
+            return;
+        }
+        dirty_first = (first < dirty_first) ? first : dirty_first;
+        dirty_end = (end > dirty_end) ? end : dirty_end;
+    }
+
+    // Set sprite i, which may be `count` to append one
+    void set(u32 i, f32 at_x, f32 at_y, u16 region_index, Color color) {
+        ASSERT(i <= count && i < capacity);
+        x[i] = at_x;
+        y[i] = at_y;
+        region[i] = region_index;
+        tint[i] = color;
+        if (i == count) {
+            count++;
+        }
+        mark_dirty(i, i + 1);
+    }
+
+    void set_texture(u32 new_texture_id) {
+        if (texture_id != new_texture_id) {
+            texture_id = new_texture_id;
+            mark_dirty(0, count);
+        }
+    }
+};
+
+// Draw sprites [draw_first, draw_first + draw_count) of a retained layer,
+// resending its dirty span if it has one
+inline void push_static_sprite_layer_range(
+    RenderCommands* commands,
+    StaticSpriteLayer* layer,
+    u32 draw_first,
+    u32 draw_count,
+    f32 offset_x,
+    f32 offset_y,
+    u8 render_layer = 0,
+    RenderBlendMode blend_mode = RenderBlend_Alpha,
+    const char* site_file = ARENA_SITE_FILE,
+    u32 site_line = ARENA_SITE_LINE
+) {
+    u32 first = layer->dirty_first;
+    u32 update_count = layer->dirty_end - layer->dirty_first;
+    u32 region_count = update_count ? layer->region_count : 0;
+    usize size = static_layer_command_size(region_count, update_count);
+    RenderCommandStaticLayer* command =
+        (RenderCommandStaticLayer*)commands->arena.push_size(
+            size,
+            alignof(RenderCommandStaticLayer),
+            site_file,
+            site_line
+        );
+    command->header.type = RenderCommand_StaticLayer;
+    command->header.layer = render_layer;
+    command->header.blend_mode = (u8)blend_mode;
+    command->size = (u32)size;
+    command->layer_id = layer->id;
+    command->capacity = layer->capacity;
+    command->draw_first = draw_first;
+    command->draw_count = draw_count;
+    command->texture_id = layer->texture_id;
+    command->w = layer->w;
+    command->h = layer->h;
+    command->offset_x = offset_x;
+    command->offset_y = offset_y;
+    command->region_count = region_count;
+    command->first = first;
+    command->update_count = update_count;
+
+    StaticLayerUpdate update = static_layer_update_arrays(command);
+    memcpy(update.regions, layer->regions, region_count * sizeof(AtlasRegion));
+    memcpy(update.x, layer->x + first, update_count * sizeof(f32));
+    memcpy(update.y, layer->y + first, update_count * sizeof(f32));
+    memcpy(update.tint, layer->tint + first, update_count * sizeof(Color));
+    memcpy(update.region, layer->region + first, update_count * sizeof(u16));
+    layer->dirty_first = 0;
+    layer->dirty_end = 0;
+}
+
+// Draw all of a retained layer, resending its dirty span if it has one
+inline void push_static_sprite_layer(
+    RenderCommands* commands,
+    StaticSpriteLayer* layer,
+    f32 offset_x,
+    f32 offset_y,
+    u8 render_layer = 0,
+    RenderBlendMode blend_mode = RenderBlend_Alpha,
+    const char* site_file = ARENA_SITE_FILE,
+    u32 site_line = ARENA_SITE_LINE
+) {
+    push_static_sprite_layer_range(
+        commands,
+        layer,
+        0,
+        layer->count,
+        offset_x,
+        offset_y,
+        render_layer,
+        blend_mode,
+        site_file,
+        site_line
+    );
+}
+
+// Reserve a sub-list slot in the main stream. Call from the thread that
+// owns `commands`, in the order the sub-lists should replay. Recorded
+// commands keep their own layers when sorted.
+inline RenderCommandSubList* push_render_sublist(
+    RenderCommands* commands,
+    const char* site_file = ARENA_SITE_FILE,
+    u32 site_line = ARENA_SITE_LINE
+) {
+    ASSERT(commands->sublist_count < RENDER_MAX_SUBLISTS);
+    RenderCommandSubList* result = push_render_command<RenderCommandSubList>(
+        commands,
+        RenderCommand_SubList,
+        0,
+        RenderBlend_Alpha,
+        site_file,
+        site_line
+    );
+    result->index = commands->sublist_count++;
+    commands->sublists[result->index] = {};
+    return result;
+}
+
+// Start recording a sub-list into `size_bytes` carved from `arena`. The
+// returned command list records like the main one; any thread can use it.
+// Sub-lists cannot be nested, and the sort mask stays on the main list.
+inline RenderCommands begin_render_sublist(
+    RenderCommands* parent,
+    MemoryArena* arena,
+    usize size_bytes,
+    const char* site_file = ARENA_SITE_FILE,
+    u32 site_line = ARENA_SITE_LINE
+) {
+    RenderCommands result = {};
+    result.width = parent->width;
+    result.height = parent->height;
+    result.arena = MemoryArena::make(
+        arena->push_size(
+            size_bytes,
+            alignof(RenderCommandHeader),
+            site_file,
+            site_line
+        ),
+        size_bytes
+    );
+    result.sublist_count = RENDER_MAX_SUBLISTS; // Nesting trips the assert
+    return result;
+}
+
+// Publish what a sub-list recorded. Must happen before the commands are
+// executed, e.g. by completing the recording jobs.
+inline void end_render_sublist(
+    RenderCommands* parent,
+    RenderCommandSubList* sublist,
+    RenderCommands* recorded
+) {
+    RenderSubList* target = &parent->sublists[sublist->index];
+    target->base = recorded->arena.base;
+    target->used = recorded->arena.used;
+}
+
 #define GAME_UPDATE_AND_RENDER(name)                                           \
     void name(GameMemory* memory, GameInput* input, RenderCommands* render_cmds)
 typedef GAME_UPDATE_AND_RENDER(game_update_and_render_func);
@@ -0,0 +1,22 @@
+// Generated by atlas_packer - do not edit
+#pragma once
+
+#include "game_interface.h"
+
+#define RAVIOLI_ATLAS_WIDTH 32
+#define RAVIOLI_ATLAS_HEIGHT 32
+
+enum RavioliAtlasRegion {
+    RavioliAtlas_GreenHappy, // 16x16 at (0, 0)
+    RavioliAtlas_CyanHappy, // 16x16 at (16, 0)
+    RavioliAtlas_RedAngry, // 16x16 at (0, 16)
+    RavioliAtlas_BlueSad, // 16x16 at (16, 16)
+    RavioliAtlas_Count,
+};
+
+static const AtlasRegion RAVIOLI_ATLAS_REGIONS[RavioliAtlas_Count] = {
+    {0.0f, 0.0f, 0.5f, 0.5f}, // GreenHappy
+    {0.5f, 0.0f, 1.0f, 0.5f}, // CyanHappy
+    {0.0f, 0.5f, 0.5f, 1.0f}, // RedAngry
+    {0.5f, 0.5f, 1.0f, 1.0f}, // BlueSad
+};
@@ -2,10 +2,121 @@
 
 #include "def.h"
 
+// Growable arenas reserve address space up front and commit it in
+// commit_chunk steps as pushes reach it. The platform supplies the page
+// functions (see platform/memory.h), so a growable arena handed to the game
+// keeps working across reloads of the game code.
+#define ARENA_COMMIT_PAGES(name) b32 name(void* base, usize size)
+typedef ARENA_COMMIT_PAGES(arena_commit_pages_func);
+
+#define ARENA_DECOMMIT_PAGES(name) void name(void* base, usize size)
+typedef ARENA_DECOMMIT_PAGES(arena_decommit_pages_func);
+
+// Allocation statistics: pushes, alignment padding and the fill level's
+// high-water mark, read out through profiler_report_arena. Cheap enough to
+// leave on; build with ARENA_STATS=0 to drop the counting.
+#ifndef ARENA_STATS
+#define ARENA_STATS 1
+#endif
+
+// Per-call-site tagging for arenas given an ArenaSiteTable. Costs a table
+// search per push, so only debug builds turn it on.
+#ifndef ARENA_TRACK_SITES
+#define ARENA_TRACK_SITES 0
+#endif
+
+// Push call sites, filled in at the caller through default arguments
+#define ARENA_SITE_FILE __builtin_FILE()
+#define ARENA_SITE_LINE __builtin_LINE()
+
+#define ARENA_MAX_SITES 32
+#define ARENA_SITE_NAME_LENGTH 32
+
+struct ArenaSite {
+    const char* file; // Only compared: may point into code since unloaded
+    u32 line;
+    char file_name[ARENA_SITE_NAME_LENGTH]; // Copied, without the directory
+    u32 push_count;
+    usize bytes; // Requested
+    usize padding_bytes;
+};
+
+struct ArenaSiteTable {
+    u32 count;
+    u32 untracked_pushes; // Pushes from sites past ARENA_MAX_SITES
+    ArenaSite sites[ARENA_MAX_SITES];
+};
+
+// Counters since the last report, and the lifetime peak as of that report
+struct ArenaStats {
+    usize peak_used;
+    usize frame_peak_used;
+    u32 push_count;
+    usize padding_bytes; // Lost to alignment rounding
+};
+
+inline void arena_note_site(
+    ArenaSiteTable* table,
+    const char* file,
+    u32 line,
+    usize bytes,
+    usize padding_bytes
+) {
+    ArenaSite* site = nullptr;
+    for (u32 i = 0; i < table->count; i++) {
+        if (table->sites[i].file == file && table->sites[i].line == line) {
+            site = &table->sites[i];
+            break;
+        }
+    }
+    if (!site) {
+        if (table->count == ARENA_MAX_SITES) {
+            table->untracked_pushes++;
+            return;
+        }
+        site = &table->sites[table->count++];
+        *site = {};
+        site->file = file;
+        site->line = line;
+
+        const char* name = file;
+        for (const char* at = file; *at; at++) {
+            if (*at == '/' || *at == '\\') {
+                name = at + 1;
+            }
+        }
+        u32 length = 0;
+        for (; name[length] && length < ARENA_SITE_NAME_LENGTH - 1; length++) {
+            site->file_name[length] = name[length];
+        }
+        site->file_name[length] = 0;
+    }
+    site->push_count++;
+    site->bytes += bytes;
+    site->padding_bytes += padding_bytes;
+}
+
+enum ArenaFlags {
+    // clear() gives everything past the first commit_chunk back to the OS.
+    // For arenas that spike rarely; per-frame arenas should keep their pages.
+    ArenaFlag_DecommitOnClear = 1 << 0,
+};
+
 struct MemoryArena {
     u8* base;
-    usize size;
+    usize size; // Reserved bytes; the hard limit
     usize used;
+    usize committed; // Leading bytes backed by memory, == size if fixed
+    u32 temp_count;  // Open TemporaryMemory checkpoints
+
+    // Growable arenas only
+    u32 flags; // ArenaFlags
+    usize commit_chunk;
+    arena_commit_pages_func* commit_pages;
+    arena_decommit_pages_func* decommit_pages;
+
+    ArenaStats stats;
+    ArenaSiteTable* sites; // Only recorded into with ARENA_TRACK_SITES
 
     // Initialize an arena from a pre-allocated buffer
     static MemoryArena make(void* buffer, usize size_bytes) {
@@ -13,38 +124,125 @@ struct MemoryArena {
         result.base = (u8*)buffer;
         result.size = size_bytes;
         result.used = 0;
+        result.committed = size_bytes;
         return result;
     }
 
-    // Push raw bytes, returns aligned pointer
-    void* push_size(usize size_bytes, usize alignment = alignof(max_align_t)) {
+    // Initialize a growable arena over reserved, uncommitted address space.
+    // commit_chunk must be a multiple of the page size.
+    static MemoryArena make_growable(
+        void* reserved,
+        usize reserved_size,
+        usize commit_chunk,
+        arena_commit_pages_func* commit_pages,
+        arena_decommit_pages_func* decommit_pages,
+        u32 flags = 0
+    ) {
+        MemoryArena result = {};
+        result.base = (u8*)reserved;
+        result.size = reserved_size;
+        result.commit_chunk = commit_chunk;
+        result.commit_pages = commit_pages;
+        result.decommit_pages = decommit_pages;
+        result.flags = flags;
+        return result;
+    }
+
+    // Commit enough chunks to cover the first `needed` bytes
+    b32 grow(usize needed) {
+        if (!commit_pages || needed > size) {
+            return false;
+        }
+        usize target = (needed + commit_chunk - 1) / commit_chunk;
+        target *= commit_chunk;
+        if (target > size) {
+            target = size;
+        }
+        if (!commit_pages(base + committed, target - committed)) {
+            return false;
+        }
+        committed = target;
+        return true;
+    }
+
+    // Push raw bytes, returns aligned pointer. The site arguments tag the
+    // push for ARENA_TRACK_SITES; leave them to their defaults.
+    void* push_size(
+        usize size_bytes,
+        usize alignment = alignof(max_align_t),
+        const char* site_file = ARENA_SITE_FILE,
+        u32 site_line = ARENA_SITE_LINE
+    ) {
         usize aligned_offset = (used + (alignment - 1)) & ~(alignment - 1);
         ASSERT((aligned_offset + size_bytes) <= size);
+        if (aligned_offset + size_bytes > committed) {
+            b32 grown = grow(aligned_offset + size_bytes);
+            ASSERT(grown);
+        }
+#if ARENA_STATS
+        stats.push_count++;
+        stats.padding_bytes += aligned_offset - used;
+        if (aligned_offset + size_bytes > stats.frame_peak_used) {
+            stats.frame_peak_used = aligned_offset + size_bytes;
+        }
+#endif
+#if ARENA_TRACK_SITES
+        if (sites) {
+            arena_note_site(
+                sites,
+                site_file,
+                site_line,
+                size_bytes,
+                aligned_offset - used
+            );
+        }
+#endif
+        (void)site_file;
+        (void)site_line;
         void* result = base + aligned_offset;
         used = aligned_offset + size_bytes;
         return result;
     }
 
     // Push a single struct/type
-    template <typename T> T* push_struct() {
-        return (T*)push_size(sizeof(T), alignof(T));
+    template <typename T>
+    T* push_struct(
+        const char* site_file = ARENA_SITE_FILE,
+        u32 site_line = ARENA_SITE_LINE
+    ) {
+        return (T*)push_size(sizeof(T), alignof(T), site_file, site_line);
     }
 
     // Push an array of structs/types
-    template <typename T> T* push_array(usize count) {
-        return (T*)push_size(sizeof(T) * count, alignof(T));
+    template <typename T>
+    T* push_array(
+        usize count,
+        const char* site_file = ARENA_SITE_FILE,
+        u32 site_line = ARENA_SITE_LINE
+    ) {
+        usize size_bytes = sizeof(T) * count;
+        return (T*)push_size(size_bytes, alignof(T), site_file, site_line);
     }
 
     // Push and zero-initialize a single struct
-    template <typename T> T* push_struct_zero() {
-        T* result = push_struct<T>();
+    template <typename T>
+    T* push_struct_zero(
+        const char* site_file = ARENA_SITE_FILE,
+        u32 site_line = ARENA_SITE_LINE
+    ) {
+        T* result = push_struct<T>(site_file, site_line);
         *result = {};
         return result;
     }
 
     // Push and zero-initialize an array
-    template <typename T> T* push_array_zero(usize count) {
-        T* result = push_array<T>(count);
+    template <typename T>
+    T* push_array_zero(
+        usize count,
+        const char* site_file = ARENA_SITE_FILE,
+        u32 site_line = ARENA_SITE_LINE
+    ) {
+        T* result = push_array<T>(count, site_file, site_line);
         for (usize i = 0; i < count; ++i) {
             result[i] = {};
         }
@@ -52,24 +250,78 @@ struct MemoryArena {
     }
 
     // Reset arena to empty state
-    void clear() { used = 0; }
+    void clear() {
+        ASSERT(temp_count == 0);
+        used = 0;
+        if ((flags & ArenaFlag_DecommitOnClear) && committed > commit_chunk) {
+            decommit_pages(base + commit_chunk, committed - commit_chunk);
+            committed = commit_chunk;
+        }
+    }
 
     // Get remaining capacity
     usize remaining() { return size - used; }
+
+    // Start a new reporting period: fold the period's peak into the lifetime
+    // one and zero the counters, the sites' included
+    void reset_stats() {
+        if (stats.frame_peak_used > stats.peak_used) {
+            stats.peak_used = stats.frame_peak_used;
+        }
+        stats.frame_peak_used = used;
+        stats.push_count = 0;
+        stats.padding_bytes = 0;
+        if (sites) {
+            for (u32 i = 0; i < sites->count; i++) {
+                sites->sites[i].push_count = 0;
+                sites->sites[i].bytes = 0;
+                sites->sites[i].padding_bytes = 0;
+            }
+            sites->untracked_pushes = 0;
+        }
+    }
 };
 
+// Checkpoint of an arena's fill level. Everything pushed after make() is
+// released by end(). Checkpoints nest, and must end in reverse order.
 struct TemporaryMemory {
     MemoryArena* arena;
     usize saved_used;
 
-    TemporaryMemory make(MemoryArena* arena) {
+    static TemporaryMemory make(MemoryArena* arena) {
         TemporaryMemory result;
         result.arena = arena;
         result.saved_used = arena->used;
+        arena->temp_count++;
         return result;
     }
 
     void end() {
+        ASSERT(arena->temp_count > 0);
+        ASSERT(arena->used >= saved_used);
         arena->used = saved_used;
+        arena->temp_count--;
+    }
+};
+
+// TemporaryMemory that ends with the enclosing scope
+//
+//   {
+//       ScratchScope scratch(&memory->frame_arena);
+//       f32* values = scratch.arena->push_array<f32>(count);
+//       ...
+//   } // values released here
+struct ScratchScope {
+    MemoryArena* arena;
+    TemporaryMemory temp;
+
+    explicit ScratchScope(MemoryArena* scratch_arena) {
+        arena = scratch_arena;
+        temp = TemporaryMemory::make(scratch_arena);
     }
+
+    ~ScratchScope() { temp.end(); }
+
+    ScratchScope(const ScratchScope&) = delete;
+    ScratchScope& operator=(const ScratchScope&) = delete;
 };
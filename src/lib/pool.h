@@ -0,0 +1,135 @@
+#pragma once
+
+#include "def.h"
+#include "memory_arena.h"
+
+// Fixed-capacity pools with stable handles and dense storage.
+//
+// Live items are packed into dense positions [0, count), so updates and
+// render emission walk contiguous arrays. Removing an item moves the last one
+// into its place; handles stay valid across that because they name a slot,
+// and the slot tracks where its item currently lives. Free slots form an
+// intrusive list through the same field, so add and remove are O(1) and the
+// pool never fragments.
+//
+// Each slot's generation is bumped on add and on remove, so it is odd while
+// live. A handle only resolves while its generation matches, which makes
+// handles to removed items (and the zeroed null handle) safely stale.
+//
+// PoolIndex is the slot bookkeeping only; the owner keeps its items in as
+// many arrays as it likes, indexed by dense position, and moves them when
+// told to.
+//
+//   PoolIndex index = PoolIndex::make(&arena, 1024);
+//   PoolHandle handle = index.add();  // New item at index.count - 1
+//   u32 i = index.lookup(handle);     // POOL_NULL_INDEX once removed
+//   u32 hole = index.remove(handle);  // Move item index.count into hole
+//
+// To remove while iterating, walk the dense items backwards.
+
+#define POOL_NULL_INDEX 0xFFFFFFFFu
+
+struct PoolHandle {
+    u32 index;
+    u32 generation;
+};
+
+struct PoolSlot {
+    u32 generation;
+    u32 dense_index; // Next free slot while free
+};
+
+inline b32 pool_handle_is_null(PoolHandle handle) {
+    return handle.generation == 0;
+}
+
+struct PoolIndex {
+    u32* item_slots; // Slot of each dense item
+    PoolSlot* slots;
+    u32 capacity;
+    u32 count;
+    u32 free_head;
+
+    // Push the slot arrays from `arena`. All slots start free.
+    static PoolIndex make(MemoryArena* arena, u32 capacity) {
+        PoolIndex result = {};
+        result.item_slots = arena->push_array<u32>(capacity);
+        result.slots = arena->push_array<PoolSlot>(capacity);
+        result.capacity = capacity;
+        for (u32 i = 0; i < capacity; i++) {
+            result.slots[i].generation = 0;
+            result.slots[i].dense_index = i + 1;
+        }
+        if (capacity > 0) {
+            result.slots[capacity - 1].dense_index = POOL_NULL_INDEX;
+            result.free_head = 0;
+        } else {
+            result.free_head = POOL_NULL_INDEX;
+        }
+        return result;
+    }
+
+    b32 is_full() { return free_head == POOL_NULL_INDEX; }
+
+    // Claim a slot for a new item at dense position count - 1. Returns the
+    // null handle if the pool is full.
+    PoolHandle add() {
+        PoolHandle result = {};
+        if (free_head == POOL_NULL_INDEX) {
+            return result;
+        }
+        u32 index = free_head;
+        PoolSlot* slot = &slots[index];
+        free_head = slot->dense_index;
+
+        slot->generation++;
+        slot->dense_index = count;
+        item_slots[count] = index;
+        count++;
+
+        result.index = index;
+        result.generation = slot->generation;
+        return result;
+    }
+
+    // Dense position of the handle's item, or POOL_NULL_INDEX if it was
+    // removed
+    u32 lookup(PoolHandle handle) {
+        if (handle.index >= capacity || (handle.generation & 1) == 0 ||
+            slots[handle.index].generation != handle.generation) {
+            return POOL_NULL_INDEX;
+        }
+        return slots[handle.index].dense_index;
+    }
+
+    // Handle of the item at a dense position, for removing while iterating
+    PoolHandle handle_at(u32 dense_index) {
+        ASSERT(dense_index < count);
+        PoolHandle result;
+        result.index = item_slots[dense_index];
+        result.generation = slots[result.index].generation;
+        return result;
+    }
+
+    // Release the handle's slot and return the dense position it held, or
+    // POOL_NULL_INDEX if the handle was already stale. The caller moves its
+    // item at dense position `count` (the old last one) into that position.
+    u32 remove(PoolHandle handle) {
+        u32 dense_index = lookup(handle);
+        if (dense_index == POOL_NULL_INDEX) {
+            return POOL_NULL_INDEX;
+        }
+        u32 last = count - 1;
+        if (dense_index != last) {
+            item_slots[dense_index] = item_slots[last];
+            slots[item_slots[last]].dense_index = dense_index;
+        }
+        count--;
+
+        PoolSlot* slot = &slots[handle.index];
+        slot->generation++;
+        slot->dense_index = free_head;
+        free_head = handle.index;
+        return dense_index;
+    }
+};
@@ -0,0 +1,554 @@
+#pragma once
+
+#include "def.h"
+#include "memory_arena.h"
+#include <string.h>
+
+// Frame profiler shared by the platform layer and the game code.
+//
+//   TIMED_FUNCTION();          // times the enclosing function
+//   TIMED_BLOCK("name");       // times the rest of the enclosing scope
+//
+// Each thread appends begin/end events to its own ring buffer; nothing is
+// shared on the hot path but the thread's write index. Once per frame the
+// platform collates all rings into a ProfileFrame: per-block cycles, hit
+// counts and nesting depth, plus the renderer and command arena counters.
+//
+// Arenas are reported by name with profiler_report_arena, from the thread
+// that owns them: each frame keeps their latest fill level and high-water
+// mark, and the profiler keeps lifetime peaks and, for arenas with a site
+// table, totals per push site.
+//
+// The Profiler lives in platform memory and block names are copied into it,
+// so the history survives reloads of the game code; after a reload call
+// sites re-register by name and get their old block ids back. Each module
+// (platform executable, game library) points its own g_profiler at it.
+//
+// Build with PROFILER_ENABLED=0 to compile the macros out.
+
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define PROFILER_USE_RDTSC 1
+#endif
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <mach/mach_time.h>
+#include <pthread.h>
+#else
+#include <pthread.h>
+#include <time.h>
+#endif
+
+#define PROFILER_MAX_THREADS 32
+#define PROFILER_MAX_BLOCKS 256
+#define PROFILER_MAX_DEPTH 32
+#define PROFILER_RING_SIZE 16384 // Events per thread, power of two
+#define PROFILER_HISTORY 128     // Frames kept
+#define PROFILER_NAME_LENGTH 48
+#define PROFILER_MAX_ARENAS 16
+#define PROFILER_MAX_ARENA_SITES 128
+
+enum ProfileEventType {
+    ProfileEvent_Begin,
+    ProfileEvent_End,
+};
+
+struct ProfileEvent {
+    u64 clock;
+    u16 block;
+    u16 type; // ProfileEventType
+};
+
+struct ProfileBlockInfo {
+    char name[PROFILER_NAME_LENGTH];
+};
+
+struct ProfileThread {
+    u64 os_thread_id;
+
+    // Ring written by the owning thread only; write is published with
+    // release so the collator sees whole events
+    u32 write;
+    u32 read; // Collator only
+    ProfileEvent events[PROFILER_RING_SIZE];
+
+    // Blocks open across collations (collator only)
+    u64 open_clock[PROFILER_MAX_DEPTH];
+    u16 open_block[PROFILER_MAX_DEPTH];
+    u32 open_depth;
+};
+
+struct ProfileBlockStats {
+    u64 cycles; // Inclusive
+    u32 hits;
+    u32 depth; // Deepest nesting seen this frame, 0 = top level
+};
+
+// An arena, or the fullest member of a group, as of its latest report
+struct ProfileArenaStats {
+    u64 used;
+    u64 peak_used; // High-water mark since the report before
+    u64 committed;
+    u64 size;
+    u32 push_count; // Group members summed, as is padding
+    u64 padding_bytes;
+    u64 lifetime_peak_used;
+};
+
+struct ProfileArenaInfo {
+    char name[PROFILER_NAME_LENGTH];
+    u32 member_count;
+
+    // Lifetime
+    u64 peak_used;
+    u64 push_count;
+    u64 padding_bytes;
+};
+
+struct ProfileArenaSite {
+    u32 arena;
+    u32 line;
+    char file_name[ARENA_SITE_NAME_LENGTH];
+    u64 push_count;
+    u64 bytes;
+    u64 padding_bytes;
+};
+
+struct ProfileFrame {
+    u64 begin_clock;
+    u64 end_clock;
+    f64 seconds;
+
+    // Filled in by the platform before profiler_end_frame
+    u32 draw_calls;
+    u32 quads;
+    u64 bytes_uploaded;
+    u64 command_bytes; // Render command arena bytes used, sub-lists included
+    f64 gpu_draw_ms;
+    f64 gpu_blit_ms;
+
+    u32 events_dropped; // Ring overruns; cycles are undercounted if nonzero
+    ProfileBlockStats blocks[PROFILER_MAX_BLOCKS];
+
+    u32 arena_count;
+    ProfileArenaStats arenas[PROFILER_MAX_ARENAS];
+
+    // Each thread's ring read index once this frame was collated; the frame's
+    // events are those between the previous frame's marks and these
+    u32 thread_count;
+    u32 ring_end[PROFILER_MAX_THREADS];
+};
+
+struct Profiler {
+    u32 lock; // Guards block and thread registration
+
+    u32 block_count; // Block 0 is reserved as "unregistered"
+    ProfileBlockInfo blocks[PROFILER_MAX_BLOCKS];
+
+    u32 thread_count;
+    ProfileThread threads[PROFILER_MAX_THREADS];
+
+    // Guarded by lock; any thread may report an arena it owns
+    u32 arena_count;
+    ProfileArenaInfo arenas[PROFILER_MAX_ARENAS];
+    ProfileArenaStats arena_reports[PROFILER_MAX_ARENAS]; // Latest per arena
+    u32 arena_site_count;
+    u64 arena_untracked_pushes;
+    ProfileArenaSite arena_sites[PROFILER_MAX_ARENA_SITES];
+
+    ProfileFrame frames[PROFILER_HISTORY];
+    u32 frame_count; // Frames completed, published with release
+    f64 clocks_per_second;
+    f64 last_frame_time;
+};
+
+// One per module; the platform and the game each point theirs at the same
+// Profiler
+inline Profiler* g_profiler = nullptr;
+inline thread_local ProfileThread* t_profile_thread = nullptr;
+
+inline u64 profiler_clock() {
+#if defined(PROFILER_USE_RDTSC)
+    return __rdtsc();
+#elif defined(_WIN32)
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (u64)counter.QuadPart;
+#elif defined(__APPLE__)
+    return mach_absolute_time();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+#endif
+}
+
+inline u64 profiler_os_thread_id() {
+#ifdef _WIN32
+    return (u64)GetCurrentThreadId();
+#else
+    return (u64)(uintptr_t)pthread_self();
+#endif
+}
+
+inline void profiler_lock(Profiler* profiler) {
+    while (__atomic_exchange_n(&profiler->lock, 1u, __ATOMIC_ACQUIRE)) {
+    }
+}
+
+inline void profiler_unlock(Profiler* profiler) {
+    __atomic_store_n(&profiler->lock, 0u, __ATOMIC_RELEASE);
+}
+
+// Find or claim the calling thread's ring. Found by OS thread id, so a
+// thread keeps its ring across game code reloads.
+inline ProfileThread* profiler_thread(Profiler* profiler) {
+    u64 id = profiler_os_thread_id();
+    ProfileThread* result = nullptr;
+
+    profiler_lock(profiler);
+    for (u32 i = 0; i < profiler->thread_count; i++) {
+        if (profiler->threads[i].os_thread_id == id) {
+            result = &profiler->threads[i];
+            break;
+        }
+    }
+    if (!result && profiler->thread_count < PROFILER_MAX_THREADS) {
+        result = &profiler->threads[profiler->thread_count];
+        result->os_thread_id = id;
+        __atomic_store_n(
+            &profiler->thread_count,
+            profiler->thread_count + 1,
+            __ATOMIC_RELEASE
+        );
+    }
+    profiler_unlock(profiler);
+    return result;
+}
+
+// Look up a block by name, registering it on first use. Returns 0 if the
+// table is full.
+inline u16 profiler_register_block(Profiler* profiler, const char* name) {
+    u16 result = 0;
+    profiler_lock(profiler);
+    if (profiler->block_count == 0) {
+        profiler->block_count = 1;
+    }
+    for (u32 i = 1; i < profiler->block_count; i++) {
+        if (strncmp(profiler->blocks[i].name, name, PROFILER_NAME_LENGTH) ==
+            0) {
+            result = (u16)i;
+            break;
+        }
+    }
+    if (!result && profiler->block_count < PROFILER_MAX_BLOCKS) {
+        result = (u16)profiler->block_count;
+        ProfileBlockInfo* info = &profiler->blocks[result];
+        strncpy(info->name, name, PROFILER_NAME_LENGTH - 1);
+        info->name[PROFILER_NAME_LENGTH - 1] = 0;
+        __atomic_store_n(
+            &profiler->block_count,
+            profiler->block_count + 1,
+            __ATOMIC_RELEASE
+        );
+    }
+    profiler_unlock(profiler);
+    return result;
+}
+
+// Add an arena's site counters to the lifetime totals. Called locked.
+inline void profiler_merge_arena_sites(
+    Profiler* profiler,
+    u32 arena_index,
+    ArenaSiteTable* table
+) {
+    profiler->arena_untracked_pushes += table->untracked_pushes;
+    for (u32 i = 0; i < table->count; i++) {
+        ArenaSite* site = &table->sites[i];
+        if (site->push_count == 0) {
+            continue;
+        }
+        ProfileArenaSite* total = nullptr;
+        for (u32 j = 0; j < profiler->arena_site_count; j++) {
+            ProfileArenaSite* candidate = &profiler->arena_sites[j];
+            if (candidate->arena == arena_index &&
+                candidate->line == site->line &&
+                strcmp(candidate->file_name, site->file_name) == 0) {
+                total = candidate;
+                break;
+            }
+        }
+        if (!total) {
+            if (profiler->arena_site_count == PROFILER_MAX_ARENA_SITES) {
+                profiler->arena_untracked_pushes += site->push_count;
+                continue;
+            }
+            total = &profiler->arena_sites[profiler->arena_site_count++];
+            *total = {};
+            total->arena = arena_index;
+            total->line = site->line;
+            memcpy(total->file_name, site->file_name, ARENA_SITE_NAME_LENGTH);
+        }
+        total->push_count += site->push_count;
+        total->bytes += site->bytes;
+        total->padding_bytes += site->padding_bytes;
+    }
+}
+
+// Report `count` arenas under one name, e.g. a set of per-thread arenas, and
+// start their next reporting period. A group is reported as its fullest
+// member. Call from the thread that owns the arenas, at most once a frame;
+// the arenas must not be pushed to meanwhile.
+inline void profiler_report_arenas(
+    Profiler* profiler,
+    const char* name,
+    MemoryArena* arenas,
+    u32 count
+) {
+    profiler_lock(profiler);
+    u32 index = 0;
+    for (; index < profiler->arena_count; index++) {
+        if (strncmp(profiler->arenas[index].name, name, PROFILER_NAME_LENGTH) ==
+            0) {
+            break;
+        }
+    }
+    if (index == profiler->arena_count) {
+        if (index == PROFILER_MAX_ARENAS) {
+            profiler_unlock(profiler);
+            return;
+        }
+        ProfileArenaInfo* info = &profiler->arenas[index];
+        *info = {};
+        strncpy(info->name, name, PROFILER_NAME_LENGTH - 1);
+        profiler->arena_count++;
+    }
+
+    ProfileArenaInfo* info = &profiler->arenas[index];
+    ProfileArenaStats* report = &profiler->arena_reports[index];
+    *report = {};
+    info->member_count = count;
+    for (u32 i = 0; i < count; i++) {
+        MemoryArena* arena = &arenas[i];
+        ArenaStats* stats = &arena->stats;
+        if (arena->used > report->used) {
+            report->used = arena->used;
+        }
+        if (stats->frame_peak_used > report->peak_used) {
+            report->peak_used = stats->frame_peak_used;
+        }
+        if (arena->committed > report->committed) {
+            report->committed = arena->committed;
+        }
+        if (arena->size > report->size) {
+            report->size = arena->size;
+        }
+        report->push_count += stats->push_count;
+        report->padding_bytes += stats->padding_bytes;
+        if (arena->sites) {
+            profiler_merge_arena_sites(profiler, index, arena->sites);
+        }
+        arena->reset_stats();
+        if (stats->peak_used > info->peak_used) {
+            info->peak_used = stats->peak_used;
+        }
+    }
+    report->lifetime_peak_used = info->peak_used;
+    info->push_count += report->push_count;
+    info->padding_bytes += report->padding_bytes;
+    profiler_unlock(profiler);
+}
+
+inline void profiler_report_arena(
+    Profiler* profiler,
+    const char* name,
+    MemoryArena* arena
+) {
+    profiler_report_arenas(profiler, name, arena, 1);
+}
+
+inline void profiler_record(u16 block, ProfileEventType type) {
+    if (!t_profile_thread) {
+        t_profile_thread = profiler_thread(g_profiler);
+        if (!t_profile_thread) {
+            return;
+        }
+    }
+    ProfileThread* thread = t_profile_thread;
+    u32 write = thread->write;
+    ProfileEvent* event = &thread->events[write & (PROFILER_RING_SIZE - 1)];
+    event->clock = profiler_clock();
+    event->block = block;
+    event->type = (u16)type;
+    __atomic_store_n(&thread->write, write + 1, __ATOMIC_RELEASE);
+}
+
+// Scope guard behind TIMED_BLOCK. The block id is cached per call site.
+struct TimedBlock {
+    u16 block;
+
+    TimedBlock(u16* site_block, const char* name) {
+        block = 0;
+        if (!g_profiler) {
+            return;
+        }
+        block = __atomic_load_n(site_block, __ATOMIC_RELAXED);
+        if (!block) {
+            block = profiler_register_block(g_profiler, name);
+            __atomic_store_n(site_block, block, __ATOMIC_RELAXED);
+        }
+        if (block) {
+            profiler_record(block, ProfileEvent_Begin);
+        }
+    }
+
+    ~TimedBlock() {
+        if (block && g_profiler) {
+            profiler_record(block, ProfileEvent_End);
+        }
+    }
+};
+
+#if PROFILER_ENABLED
+#define PROFILER_CONCAT_(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_(a, b)
+#define TIMED_BLOCK(name)                                                      \
+    static u16 PROFILER_CONCAT(profile_site_, __LINE__) = 0;                   \
+    TimedBlock PROFILER_CONCAT(timed_block_, __LINE__)(                        \
+        &PROFILER_CONCAT(profile_site_, __LINE__),                             \
+        name                                                                   \
+    )
+#define TIMED_FUNCTION() TIMED_BLOCK(__func__)
+#else
+#define TIMED_BLOCK(name)
+#define TIMED_FUNCTION()
+#endif
+
+// Platform side ------------------------------------------------------------
+
+// Frame being collected; only the thread that ends frames may touch it
+inline ProfileFrame* profiler_current_frame(Profiler* profiler) {
+    return &profiler->frames[profiler->frame_count % PROFILER_HISTORY];
+}
+
+// Frames completed so far. Other threads may read the completed frames up to
+// this count while the collating thread keeps going, as long as they stay
+// well inside the history.
+inline u32 profiler_completed_frames(Profiler* profiler) {
+    return __atomic_load_n(&profiler->frame_count, __ATOMIC_ACQUIRE);
+}
+
+// Most recent completed frame, or null before the first one
+inline ProfileFrame* profiler_last_frame(Profiler* profiler) {
+    if (profiler->frame_count == 0) {
+        return nullptr;
+    }
+    return &profiler->frames[(profiler->frame_count - 1) % PROFILER_HISTORY];
+}
+
+inline void profiler_begin_frame(Profiler* profiler) {
+    ProfileFrame* frame = profiler_current_frame(profiler);
+    *frame = {};
+    frame->begin_clock = profiler_clock();
+}
+
+// Drain every thread's ring into the current frame
+inline void profiler_collate(Profiler* profiler, ProfileFrame* frame) {
+    u32 thread_count =
+        __atomic_load_n(&profiler->thread_count, __ATOMIC_ACQUIRE);
+    for (u32 t = 0; t < thread_count; t++) {
+        ProfileThread* thread = &profiler->threads[t];
+        u32 write = __atomic_load_n(&thread->write, __ATOMIC_ACQUIRE);
+        if (write - thread->read > PROFILER_RING_SIZE) {
+            // The writer lapped us; skip what was lost
+            frame->events_dropped += write - thread->read - PROFILER_RING_SIZE;
+            thread->read = write - PROFILER_RING_SIZE;
+            thread->open_depth = 0;
+        }
+
+        for (; thread->read != write; thread->read++) {
+            ProfileEvent* event =
+                &thread->events[thread->read & (PROFILER_RING_SIZE - 1)];
+            if (event->type == ProfileEvent_Begin) {
+                if (thread->open_depth < PROFILER_MAX_DEPTH) {
+                    thread->open_clock[thread->open_depth] = event->clock;
+                    thread->open_block[thread->open_depth] = event->block;
+                }
+                thread->open_depth++;
+                continue;
+            }
+
+            if (thread->open_depth == 0) {
+                continue; // End without a begin, e.g. after an overrun
+            }
+            thread->open_depth--;
+            if (thread->open_depth >= PROFILER_MAX_DEPTH ||
+                thread->open_block[thread->open_depth] != event->block) {
+                continue;
+            }
+
+            ProfileBlockStats* stats = &frame->blocks[event->block];
+            u64 begin_clock = thread->open_clock[thread->open_depth];
+            stats->cycles += event->clock - begin_clock;
+            stats->hits++;
+            if (thread->open_depth > stats->depth) {
+                stats->depth = thread->open_depth;
+            }
+        }
+        frame->ring_end[t] = thread->read;
+    }
+    frame->thread_count = thread_count;
+}
+
+// Close the current frame. `now` is the platform clock in seconds, used to
+// calibrate profiler clocks against wall time.
+inline void profiler_end_frame(Profiler* profiler, f64 now) {
+    ProfileFrame* frame = profiler_current_frame(profiler);
+    profiler_collate(profiler, frame);
+    frame->end_clock = profiler_clock();
+
+    profiler_lock(profiler);
+    frame->arena_count = profiler->arena_count;
+    for (u32 i = 0; i < profiler->arena_count; i++) {
+        frame->arenas[i] = profiler->arena_reports[i];
+    }
+    profiler_unlock(profiler);
+
+    if (profiler->last_frame_time > 0.0) {
+        frame->seconds = now - profiler->last_frame_time;
+        if (frame->seconds > 0.0) {
+            f64 measured =
+                (f64)(frame->end_clock - frame->begin_clock) / frame->seconds;
+            profiler->clocks_per_second =
+                (profiler->clocks_per_second == 0.0)
+                    ? measured
+                    : profiler->clocks_per_second * 0.9 + measured * 0.1;
+        }
+    }
+    profiler->last_frame_time = now;
+
+    __atomic_store_n(
+        &profiler->frame_count,
+        profiler->frame_count + 1,
+        __ATOMIC_RELEASE
+    );
+    profiler_begin_frame(profiler);
+}
+
+inline f64 profiler_cycles_to_ms(Profiler* profiler, u64 cycles) {
+    if (profiler->clocks_per_second == 0.0) {
+        return 0.0;
+    }
+    return (f64)cycles * 1000.0 / profiler->clocks_per_second;
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include "def.h"
+#include "memory_arena.h"
+
+// Skyline rectangle packer, shared by the offline atlas packer and the
+// renderer's runtime atlas.
+//
+// The packed area is tracked as its top edge: a run of horizontal segments
+// covering [0, width), each at the height of what has been placed below it.
+// A rectangle goes where its top ends up lowest (bottom-left rule), ties
+// going to the narrowest segment it starts on, so little space is buried
+// under it. Anything under the skyline is lost, which is fine for sprites of
+// similar sizes packed tallest first.
+//
+//   SkylinePacker packer = SkylinePacker::make(&arena, 1024, 1024);
+//   u32 x, y;
+//   if (packer.pack(w, h, &x, &y)) { ... }
+
+struct SkylineNode {
+    u32 x;
+    u32 y;
+    u32 width;
+};
+
+struct SkylinePacker {
+    SkylineNode* nodes;
+    u32 node_count;
+    u32 max_nodes;
+    u32 width;
+    u32 height;
+
+    // Push the node array from `arena`. Every node spans at least one
+    // column, plus one for the node a placement inserts before trimming.
+    static SkylinePacker make(MemoryArena* arena, u32 width, u32 height) {
+        SkylinePacker result = {};
+        result.nodes = arena->push_array<SkylineNode>(width + 1);
+        result.max_nodes = width + 1;
+        result.width = width;
+        result.height = height;
+        result.reset();
+        return result;
+    }
+
+    // Forget every placed rectangle
+    void reset() {
+        nodes[0] = {0, 0, width};
+        node_count = 1;
+    }
+
+    // Height a rectangle of width `w` would sit at when its left edge is at
+    // node `index`, or false if it runs off the right or top edge
+    b32 fit(u32 index, u32 w, u32 h, u32* out_y) {
+        u32 x = nodes[index].x;
+        if (x + w > width) {
+            return false;
+        }
+        u32 y = 0;
+        u32 remaining = w;
+        for (u32 i = index; remaining > 0; i++) {
+            ASSERT(i < node_count);
+            if (nodes[i].y > y) {
+                y = nodes[i].y;
+            }
+            remaining = (nodes[i].width >= remaining)
+                            ? 0
+                            : remaining - nodes[i].width;
+        }
+        if (y + h > height) {
+            return false;
+        }
+        *out_y = y;
+        return true;
+    }
+
+    // Place a w x h rectangle and return its top-left corner. Returns false
+    // if there is no room left for it.
+    b32 pack(u32 w, u32 h, u32* out_x, u32* out_y) {
+        if (w == 0 || h == 0) {
+            return false;
+        }
+
+        u32 best_index = max_nodes;
+        u32 best_top = 0xFFFFFFFFu;
+        u32 best_width = 0xFFFFFFFFu;
+        u32 best_y = 0;
+        for (u32 i = 0; i < node_count; i++) {
+            u32 y;
+            if (!fit(i, w, h, &y)) {
+                continue;
+            }
+            u32 top = y + h;
+            if (top < best_top ||
+                (top == best_top && nodes[i].width < best_width)) {
+                best_index = i;
+                best_top = top;
+                best_width = nodes[i].width;
+                best_y = y;
+            }
+        }
+        if (best_index == max_nodes || node_count == max_nodes) {
+            return false;
+        }
+
+        // Insert the rectangle's top edge as a new node, then trim the
+        // nodes it now covers
+        u32 x = nodes[best_index].x;
+        for (u32 i = node_count; i > best_index; i--) {
+            nodes[i] = nodes[i - 1];
+        }
+        nodes[best_index] = {x, best_top, w};
+        node_count++;
+
+        u32 right = x + w;
+        u32 next = best_index + 1;
+        while (next < node_count && nodes[next].x < right) {
+            u32 node_right = nodes[next].x + nodes[next].width;
+            if (node_right <= right) {
+                remove_node(next);
+                continue;
+            }
+            nodes[next].width = node_right - right;
+            nodes[next].x = right;
+            break;
+        }
+
+        // Neighbors at the same height become one segment
+        for (u32 i = 0; i + 1 < node_count;) {
+            if (nodes[i].y == nodes[i + 1].y) {
+                nodes[i].width += nodes[i + 1].width;
+                remove_node(i + 1);
+            } else {
+                i++;
+            }
+        }
+
+        *out_x = x;
+        *out_y = best_y;
+        return true;
+    }
+
+    void remove_node(u32 index) {
+        for (u32 i = index; i + 1 < node_count; i++) {
+            nodes[i] = nodes[i + 1];
+        }
+        node_count--;
+    }
+
+    // Height of the tallest placed column, for trimming a packed area
+    u32 used_height() {
+        u32 result = 0;
+        for (u32 i = 0; i < node_count; i++) {
+            if (nodes[i].y > result) {
+                result = nodes[i].y;
+            }
+        }
+        return result;
+    }
+};
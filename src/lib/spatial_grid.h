@@ -0,0 +1,225 @@
+#pragma once
+
+#include "def.h"
+#include "memory_arena.h"
+
+// Uniform grid over the positions of densely stored items.
+//
+// The world is cut into square cells, and each cell keeps its items in an
+// intrusive doubly linked list threaded through per-item arrays, so insert,
+// remove and move are O(1) and the grid never allocates after make. Items
+// are named by their dense position, as in PoolIndex: when the owner moves
+// its last item into a hole, it calls relocate to follow.
+//
+// Renderers walk the cells overlapping the view and skip the rest of the
+// world; gameplay asks for the items around a point the same way. Items are
+// filed by one point (a sprite's top-left corner), so queries for something
+// with extent have to grow their rect by that extent.
+//
+//   SpatialGrid grid = SpatialGrid::make(&arena, 1024, 4096, 4096, 32);
+//   grid.insert(i, x, y);
+//   SpatialGridCells cells = grid.cells_overlapping(x0, y0, x1, y1);
+//   for (u32 row = cells.row0; row <= cells.row1; row++) {
+//       for (u32 column = cells.column0; column <= cells.column1; column++) {
+//           u32 cell = grid.cell_index(column, row);
+//           for (u32 i = grid.heads[cell]; i != SPATIAL_GRID_NULL;
+//                i = grid.next[i]) { ... }
+//       }
+//   }
+//
+// Positions outside the world are filed in the nearest edge cell.
+
+#define SPATIAL_GRID_NULL 0xFFFFFFFFu
+
+// Inclusive range of cells
+struct SpatialGridCells {
+    u32 column0, row0;
+    u32 column1, row1;
+};
+
+struct SpatialGrid {
+    // Per item, indexed by dense position
+    u32* cell_of;
+    u32* next;
+    u32* prev;
+
+    // Per cell, row-major
+    u32* heads;
+    u32* counts;
+
+    u32 columns;
+    u32 rows;
+    f32 cell_size;
+    f32 inv_cell_size;
+    u32 capacity;
+
+    // Push room for `capacity` items in a world_width x world_height world
+    // cut into cells of cell_size. All cells start empty.
+    static SpatialGrid make(
+        MemoryArena* arena,
+        u32 capacity,
+        f32 world_width,
+        f32 world_height,
+        f32 cell_size
+    ) {
+        SpatialGrid result = {};
+        result.columns = (u32)(world_width / cell_size) + 1;
+        result.rows = (u32)(world_height / cell_size) + 1;
+        result.cell_size = cell_size;
+        result.inv_cell_size = 1.0f / cell_size;
+        result.capacity = capacity;
+
+        result.cell_of = arena->push_array<u32>(capacity);
+        result.next = arena->push_array<u32>(capacity);
+        result.prev = arena->push_array<u32>(capacity);
+
+        u32 cell_count = result.columns * result.rows;
+        result.heads = arena->push_array<u32>(cell_count);
+        result.counts = arena->push_array<u32>(cell_count);
+        for (u32 i = 0; i < cell_count; i++) {
+            result.heads[i] = SPATIAL_GRID_NULL;
+            result.counts[i] = 0;
+        }
+        return result;
+    }
+
+    u32 cell_index(u32 column, u32 row) { return row * columns + column; }
+
+    u32 column_at(f32 x) {
+        i32 column = (i32)(x * inv_cell_size);
+        if (column < 0) {
+            return 0;
+        }
+        return ((u32)column < columns) ? (u32)column : columns - 1;
+    }
+
+    u32 row_at(f32 y) {
+        i32 row = (i32)(y * inv_cell_size);
+        if (row < 0) {
+            return 0;
+        }
+        return ((u32)row < rows) ? (u32)row : rows - 1;
+    }
+
+    u32 cell_at(f32 x, f32 y) { return cell_index(column_at(x), row_at(y)); }
+
+    // Cells holding every item filed in [x0, x1] x [y0, y1]
+    SpatialGridCells cells_overlapping(f32 x0, f32 y0, f32 x1, f32 y1) {
+        SpatialGridCells result;
+        result.column0 = column_at(x0);
+        result.row0 = row_at(y0);
+        result.column1 = column_at(x1);
+        result.row1 = row_at(y1);
+        return result;
+    }
+
+    void link(u32 item, u32 cell) {
+        u32 head = heads[cell];
+        cell_of[item] = cell;
+        prev[item] = SPATIAL_GRID_NULL;
+        next[item] = head;
+        if (head != SPATIAL_GRID_NULL) {
+            prev[head] = item;
+        }
+        heads[cell] = item;
+        counts[cell]++;
+    }
+
+    void unlink(u32 item) {
+        u32 cell = cell_of[item];
+        if (prev[item] != SPATIAL_GRID_NULL) {
+            next[prev[item]] = next[item];
+        } else {
+            heads[cell] = next[item];
+        }
+        if (next[item] != SPATIAL_GRID_NULL) {
+            prev[next[item]] = prev[item];
+        }
+        counts[cell]--;
+    }
+
+    void insert(u32 item, f32 x, f32 y) {
+        ASSERT(item < capacity);
+        link(item, cell_at(x, y));
+    }
+
+    void remove(u32 item) {
+        ASSERT(item < capacity);
+        unlink(item);
+    }
+
+    // File the item under its new position; a no-op unless it changed cells
+    void move(u32 item, f32 x, f32 y) {
+        ASSERT(item < capacity);
+        u32 cell = cell_at(x, y);
+        if (cell != cell_of[item]) {
+            unlink(item);
+            link(item, cell);
+        }
+    }
+
+    // Refile items [0, count) from scratch, for when most of them moved.
+    // Cheaper than moving each, and leaves every cell's list in dense order,
+    // which makes walking it kinder to the cache.
+    void rebuild(const f32* x, const f32* y, u32 count) {
+        ASSERT(count <= capacity);
+        u32 cell_count = columns * rows;
+        for (u32 i = 0; i < cell_count; i++) {
+            heads[i] = SPATIAL_GRID_NULL;
+            counts[i] = 0;
+        }
+        for (u32 i = count; i > 0; i--) {
+            link(i - 1, cell_at(x[i - 1], y[i - 1]));
+        }
+    }
+
+    // The item at dense position `from` now lives at `to`, whose previous
+    // item must already be removed
+    void relocate(u32 from, u32 to) {
+        ASSERT(from < capacity && to < capacity);
+        if (from == to) {
+            return;
+        }
+        u32 cell = cell_of[from];
+        cell_of[to] = cell;
+        prev[to] = prev[from];
+        next[to] = next[from];
+        if (prev[to] != SPATIAL_GRID_NULL) {
+            next[prev[to]] = to;
+        } else {
+            heads[cell] = to;
+        }
+        if (next[to] != SPATIAL_GRID_NULL) {
+            prev[next[to]] = to;
+        }
+    }
+
+    // Items in the cells overlapping [x0, x1] x [y0, y1], up to max_count of
+    // them written to `items`. Returns how many there are in total, so a
+    // result above max_count means the output was cut short. Filter by
+    // position for an exact test.
+    u32 query(
+        f32 x0,
+        f32 y0,
+        f32 x1,
+        f32 y1,
+        u32* items,
+        u32 max_count
+    ) {
+        SpatialGridCells cells = cells_overlapping(x0, y0, x1, y1);
+        u32 found = 0;
+        for (u32 row = cells.row0; row <= cells.row1; row++) {
+            for (u32 column = cells.column0; column <= cells.column1;
+                 column++) {
+                u32 cell = cell_index(column, row);
+                for (u32 i = heads[cell]; i != SPATIAL_GRID_NULL; i = next[i]) {
+                    if (found < max_count) {
+                        items[found] = i;
+                    }
+                    found++;
+                }
+            }
+        }
+        return found;
+    }
+};
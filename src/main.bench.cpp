@@ -0,0 +1,374 @@
+// Headless benchmark - game update and command replay without a window
+//
+// Links the game code directly and replays into the null renderer, so it
+// measures the CPU side of a frame: game_update_and_render (including its
+// jobs) and execute_render_commands with the selected renderer mode.
+//
+//   out/bench [--frames N] [--warmup N] [--sprites N] [--world N]
+//             [--instanced] [--compact] [--texture-arrays] [--no-jobs]
+//             [--arenas] [--record FILE] [--replay FILE] [--frame-log FILE]
+//
+// --arenas runs the profiler and prints the arena report at the end, which
+// adds the profiler's own cost to the times. --world N spreads the sprites
+// over N x N screens with the view fixed on the top-left one, so only about
+// 1/N^2 of them are drawn.
+//
+// --replay FILE plays back an input recording (platform/input_recording.h)
+// from a desktop session or an earlier --record, as fast as it will go, in
+// place of the bench's own input; the recording sets the sprite count,
+// world size and storage. Warmup and timed frames each start from the
+// recording's first frame, and --frames defaults to its length, looping if
+// longer. --frame-log FILE writes every timed frame's times and counts as
+// CSV, so two builds replaying one recording compare frame by frame.
+
+#include <print>
+
+using std::println;
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "game_interface.h"
+#include "platform/debug_overlay.h"
+#include "platform/frame_pipeline.h"
+#include "platform/input_recording.h"
+#include "platform/job_queue.h"
+#include "platform/memory.h"
+#include "platform/render_commands.h"
+#include "platform/scratch_memory.h"
+#include "renderer.h"
+
+extern "C" GAME_UPDATE_AND_RENDER(game_update_and_render);
+
+// Room per sprite in each storage block on top of the platform defaults:
+// the entity's streams, pool slots and grid links in permanent storage, and
+// one batch entry per job thread arena in transient storage, both for the
+// game's pool capacity
+#define BENCH_PERMANENT_BYTES_PER_SPRITE 96
+#define BENCH_TRANSIENT_BYTES_PER_SPRITE 32
+
+static f64 get_time_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (f64)ts.tv_sec + (f64)ts.tv_nsec / 1000000000.0;
+}
+
+// Shell sort; frame counts are small and this keeps the bench dependency free
+static void sort_f64(f64* values, u32 count) {
+    for (u32 gap = count / 2; gap > 0; gap /= 2) {
+        for (u32 i = gap; i < count; i++) {
+            f64 value = values[i];
+            u32 j = i;
+            for (; j >= gap && values[j - gap] > value; j -= gap) {
+                values[j] = values[j - gap];
+            }
+            values[j] = value;
+        }
+    }
+}
+
+// Nearest-rank percentile of sorted values
+static f64 percentile(const f64* sorted, u32 count, f64 p) {
+    u32 rank = (u32)(p * (f64)count + 0.999999);
+    if (rank == 0) {
+        rank = 1;
+    }
+    if (rank > count) {
+        rank = count;
+    }
+    return sorted[rank - 1];
+}
+
+static void report_times(const char* label, f64* times, u32 count) {
+    sort_f64(times, count);
+    println(
+        "{:<8} min {:8.3f} ms  median {:8.3f} ms  p99 {:8.3f} ms",
+        label,
+        times[0] * 1000.0,
+        percentile(times, count, 0.5) * 1000.0,
+        percentile(times, count, 0.99) * 1000.0
+    );
+}
+
+int main(int argc, char** argv) {
+    u32 frame_count = 0; // 1000, or the recording's length
+    u32 warmup_count = 60;
+    u32 sprite_count = 0; // Game default
+    u32 world_screens = 0;
+    b32 use_jobs = true;
+    b32 report_arenas = false;
+    const char* record_path = nullptr;
+    const char* replay_path = nullptr;
+    const char* frame_log_path = nullptr;
+    RendererConfig renderer_config = {};
+    for (i32 i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frame_count = (u32)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            warmup_count = (u32)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--sprites") == 0 && i + 1 < argc) {
+            sprite_count = (u32)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--world") == 0 && i + 1 < argc) {
+            world_screens = (u32)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--instanced") == 0) {
+            renderer_config.batch_mode = RendererBatchMode_Instanced;
+        } else if (strcmp(argv[i], "--compact") == 0) {
+            renderer_config.vertex_format = RendererVertexFormat_Compact;
+        } else if (strcmp(argv[i], "--texture-arrays") == 0) {
+            renderer_config.texture_arrays = true;
+        } else if (strcmp(argv[i], "--no-jobs") == 0) {
+            use_jobs = false;
+        } else if (strcmp(argv[i], "--arenas") == 0) {
+            report_arenas = true;
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replay_path = argv[++i];
+        } else if (strcmp(argv[i], "--frame-log") == 0 && i + 1 < argc) {
+            frame_log_path = argv[++i];
+        } else {
+            println("Unknown argument: {}", argv[i]);
+            println(
+                "Usage: bench [--frames N] [--warmup N] [--sprites N] "
+                "[--world N] [--instanced] [--compact] [--texture-arrays] "
+                "[--no-jobs] [--arenas] [--record FILE] [--replay FILE] "
+                "[--frame-log FILE]"
+            );
+            return 1;
+        }
+    }
+
+    InputPlayback playback = {};
+    if (replay_path) {
+        if (!input_playback_open(&playback, replay_path)) {
+            println("Failed to open recording {}", replay_path);
+            return 1;
+        }
+        if (playback.frame_count == 0) {
+            println("Recording {} has no frames", replay_path);
+            return 1;
+        }
+        if (frame_count == 0) {
+            frame_count = playback.frame_count;
+        }
+    }
+    if (frame_count == 0) {
+        frame_count = 1000;
+    }
+
+    // Allocate game memory, sized for the sprite count or as recorded
+    GameMemory memory = {};
+    memory.sprite_count = sprite_count;
+    memory.world_screens = world_screens;
+    memory.permanent_storage_size =
+        MB(64) + (u64)sprite_count * BENCH_PERMANENT_BYTES_PER_SPRITE;
+    memory.transient_storage_size =
+        MB(256) + (u64)sprite_count * BENCH_TRANSIENT_BYTES_PER_SPRITE *
+                      GAME_FRAMES_IN_FLIGHT * GAME_MAX_JOB_THREADS;
+    if (replay_path) {
+        input_playback_size_memory(&playback, &memory);
+    }
+    if (!input_recording_alloc_game_memory(&memory)) {
+        println("Failed to allocate game memory");
+        return 1;
+    }
+
+    if (use_jobs) {
+        platform_attach_job_queue(&memory, platform_create_job_queue());
+    }
+
+    // Per-frame scratch arenas
+    if (!platform_init_scratch(
+            &memory,
+            PLATFORM_FRAME_SCRATCH_SIZE,
+            PLATFORM_THREAD_SCRATCH_SIZE
+        )) {
+        println("Failed to reserve scratch memory");
+        return 1;
+    }
+
+    if (replay_path && !input_playback_restart(&playback, &memory)) {
+        println(
+            "Recording {} needs game memory at {:#x} and {} job thread(s)",
+            replay_path,
+            playback.header->permanent_storage,
+            playback.header->job_thread_count
+        );
+        return 1;
+    }
+    InputRecorder recorder = {};
+    if (record_path &&
+        !input_recording_begin(&recorder, record_path, &memory)) {
+        println("Failed to start recording {}", record_path);
+        return 1;
+    }
+
+    if (report_arenas) {
+        g_profiler = (Profiler*)platform_alloc(sizeof(Profiler));
+        memory.profiler = g_profiler;
+    }
+
+    Renderer* renderer = renderer_init(&renderer_config);
+    if (!renderer) {
+        println("Failed to initialize renderer");
+        return 1;
+    }
+
+    RenderCommands commands = {};
+    if (!platform_reserve_arena(
+            &commands.arena,
+            FRAME_PIPELINE_COMMAND_RESERVE_SIZE
+        )) {
+        println("Failed to reserve render memory");
+        return 1;
+    }
+
+    usize times_size = 3 * (usize)frame_count * sizeof(f64) +
+                       2 * (usize)frame_count * sizeof(u32);
+    f64* frame_times = (f64*)platform_alloc(times_size);
+    if (!frame_times) {
+        println("Failed to allocate timing memory");
+        return 1;
+    }
+    f64* update_times = frame_times + frame_count;
+    f64* render_times = update_times + frame_count;
+    u32* frame_quads = (u32*)(render_times + frame_count);
+    u32* frame_draw_calls = frame_quads + frame_count;
+
+    // One fixed tick per frame, at a 720p window's target size
+    GameInput input = {};
+    input.dt_for_frame = 1.0f / GAME_TICKS_PER_SECOND;
+    input.sim_ticks = 1;
+    u32 window_width = 1280;
+    u32 window_height = 720;
+
+    u64 total_commands = 0;
+    u64 total_quads = 0;
+    u64 total_draw_calls = 0;
+    f64 total_seconds = 0.0;
+
+    for (u32 frame = 0; frame < warmup_count + frame_count; frame++) {
+        if (replay_path) {
+            const InputRecordingFrame* replayed =
+                (frame == warmup_count) ? nullptr
+                                        : input_playback_next(&playback);
+            if (!replayed) {
+                input_playback_restart(&playback, &memory);
+                replayed = input_playback_next(&playback);
+            }
+            input = replayed->input;
+            window_width = replayed->window_width;
+            window_height = replayed->window_height;
+        }
+        input_recording_frame(&recorder, &input, window_width, window_height);
+
+        render_commands_reset(&commands);
+        platform_reset_scratch(&memory);
+        platform_target_size(
+            window_width,
+            window_height,
+            &commands.width,
+            &commands.height
+        );
+
+        f64 start = get_time_seconds();
+        game_update_and_render(&memory, &input, &commands);
+        f64 updated = get_time_seconds();
+
+        // Counted outside the timed replay
+        u32 command_count = count_render_commands(&commands);
+
+        f64 counted = get_time_seconds();
+        renderer_begin_frame(
+            renderer,
+            window_width,
+            window_height,
+            commands.width,
+            commands.height
+        );
+        execute_render_commands(renderer, &commands);
+        renderer_end_frame(renderer);
+        f64 rendered = get_time_seconds();
+
+        if (g_profiler) {
+            profile_render_stats(g_profiler, renderer, &commands);
+            profiler_end_frame(g_profiler, rendered);
+        }
+
+        if (frame < warmup_count) {
+            continue;
+        }
+
+        u32 index = frame - warmup_count;
+        update_times[index] = updated - start;
+        render_times[index] = rendered - counted;
+        frame_times[index] = update_times[index] + render_times[index];
+        total_seconds += frame_times[index];
+
+        RendererStats stats;
+        renderer_get_stats(renderer, &stats);
+        frame_quads[index] = stats.quads;
+        frame_draw_calls[index] = stats.draw_calls;
+        total_commands += command_count;
+        total_quads += stats.quads;
+        total_draw_calls += stats.draw_calls;
+    }
+
+    if (record_path && !input_recording_end(&recorder)) {
+        println("Failed to write recording {}", record_path);
+        return 1;
+    }
+    if (frame_log_path) {
+        FILE* log = fopen(frame_log_path, "w");
+        if (!log) {
+            println("Failed to create {}", frame_log_path);
+            return 1;
+        }
+        fprintf(log, "frame,update_ms,render_ms,quads,draw_calls\n");
+        for (u32 i = 0; i < frame_count; i++) {
+            fprintf(
+                log,
+                "%u,%.4f,%.4f,%u,%u\n",
+                i,
+                update_times[i] * 1000.0,
+                render_times[i] * 1000.0,
+                frame_quads[i],
+                frame_draw_calls[i]
+            );
+        }
+        if (fclose(log) != 0) {
+            println("Failed to write {}", frame_log_path);
+            return 1;
+        }
+    }
+
+    const char* mode = "vertices, float";
+    if (renderer_config.batch_mode == RendererBatchMode_Instanced) {
+        mode = "instanced";
+    } else if (renderer_config.vertex_format == RendererVertexFormat_Compact) {
+        mode = "vertices, compact";
+    }
+    println(
+        "{} frames, {} quads/frame, {}{}, {} job thread(s)",
+        frame_count,
+        total_quads / frame_count,
+        mode,
+        renderer_config.texture_arrays ? ", texture arrays" : "",
+        memory.job_thread_count ? memory.job_thread_count : 1
+    );
+    report_times("frame", frame_times, frame_count);
+    report_times("update", update_times, frame_count);
+    report_times("render", render_times, frame_count);
+    println(
+        "commands/s {:.0f}  quads/s {:.0f}  draw calls/frame {:.1f}",
+        (f64)total_commands / total_seconds,
+        (f64)total_quads / total_seconds,
+        (f64)total_draw_calls / frame_count
+    );
+    if (g_profiler) {
+        debug_print_arena_report(g_profiler);
+    }
+
+    return 0;
+}
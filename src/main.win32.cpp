@@ -5,12 +5,22 @@
 #include <windows.h>
 
 #include "game_interface.h"
+#include "platform/debug_overlay.h"
 #include "platform/dll_loader.h"
+#include "platform/frame_pacing.h"
+#include "platform/frame_pipeline.h"
+#include "platform/input_recording.h"
+#include "platform/job_queue.h"
 #include "platform/loader.opengl.h"
 #include "platform/memory.h"
+#include "platform/render_commands.h"
+#include "platform/scratch_memory.h"
+#include "platform/shader_watch.h"
 #include "renderer.h"
 
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <print>
 
 using std::println;
@@ -21,6 +31,7 @@ typedef HGLRC(WINAPI* PFNWGLCREATECONTEXTATTRIBSARBPROC)(
     HGLRC hShareContext,
     const int* attribList
 );
+typedef BOOL(WINAPI* PFNWGLSWAPINTERVALEXTPROC)(int interval);
 typedef BOOL(WINAPI* PFNWGLCHOOSEPIXELFORMATARBPROC)(
     HDC hdc,
     const int* piAttribIList,
@@ -53,10 +64,15 @@ static b32 g_running = true;
 
 static GameMemory g_game_memory = {};
 static GameInput g_game_input = {};
-static RenderCommands g_render_commands = {};
+static FramePipeline g_pipeline = {};
 static PlatformDLL g_game_dll = {};
+static FileWatcher g_file_watcher;
+static ShaderWatch g_shader_watch;
+static GameCodeLoader g_game_loader;
 static GameCode g_game_code = {};
 static Renderer* g_renderer = nullptr;
+static PlatformJobQueue* g_job_queue = nullptr;
+static DebugOverlay g_overlay = {};
 
 static i32 g_window_width = 800;
 static i32 g_window_height = 600;
@@ -81,70 +97,6 @@ static void reset_input_half_transitions(GameInput* input) {
     }
 }
 
-/**
- * Executes all render commands stored in the command buffer.
- *
- * This function iterates through a linear arena of serialized render commands,
- * parsing each command header to determine its type, then dispatching to the
- * appropriate renderer function. Commands are tightly packed in memory with
- * variable sizes based on their type.
- *
- * @param renderer  The renderer instance to execute commands on.
- * @param commands  The render command buffer containing serialized commands.
- *                  Commands are stored sequentially starting at arena.base,
- *                  with arena.used indicating the total bytes of commands.
- *
- * Supported command types:
- *   - RenderCommand_Clear:  Sets the clear color for the frame
- *   - RenderCommand_Rect:   Draws a colored rectangle
- *   - RenderCommand_Sprite: Draws a textured sprite with optional tint
- */
-static void
-execute_render_commands(Renderer* renderer, RenderCommands* commands) {
-    u8* base = (u8*)commands->arena.base;
-    u8* at = base;
-    u8* end = base + commands->arena.used;
-
-    while (at < end) {
-        RenderCommandHeader* header = (RenderCommandHeader*)at;
-
-        switch (header->type) {
-            case RenderCommand_Clear: {
-                RenderCommandClear* cmd = (RenderCommandClear*)at;
-                renderer_set_clear_color(renderer, cmd->color);
-                at += sizeof(RenderCommandClear);
-            } break;
-
-            case RenderCommand_Rect: {
-                RenderCommandRect* cmd = (RenderCommandRect*)at;
-                renderer_draw_rect(
-                    renderer,
-                    cmd->x,
-                    cmd->y,
-                    cmd->w,
-                    cmd->h,
-                    cmd->color
-                );
-                at += sizeof(RenderCommandRect);
-            } break;
-
-            case RenderCommand_Sprite: {
-                RenderCommandSprite* cmd = (RenderCommandSprite*)at;
-                renderer_draw_sprite(
-                    renderer,
-                    cmd->x,
-                    cmd->y,
-                    cmd->w,
-                    cmd->h,
-                    cmd->texture_id,
-                    cmd->tint
-                );
-                at += sizeof(RenderCommandSprite);
-            } break;
-        }
-    }
-}
-
 static void process_keyboard_message(WPARAM wParam, b32 is_down) {
     switch (wParam) {
         case 'W':
@@ -162,6 +114,16 @@ static void process_keyboard_message(WPARAM wParam, b32 is_down) {
         case VK_SPACE:
             process_button_event(&g_game_input.action, is_down);
             break;
+        case VK_F1:
+            if (is_down) {
+                g_overlay.visible = !g_overlay.visible;
+            }
+            break;
+        case VK_F2:
+            if (is_down) {
+                debug_overlay_request_capture(&g_overlay);
+            }
+            break;
     }
 }
 
@@ -354,6 +316,86 @@ static b32 create_window_and_context(HINSTANCE hInstance) {
     return true;
 }
 
+static f64 get_time_seconds() {
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (f64)counter.QuadPart / (f64)g_perf_frequency.QuadPart;
+}
+
+// Replays one frame; runs on the render thread unless in lockstep
+static PIPELINE_RENDER(win32_render_frame) {
+    (void)user_data;
+    {
+        TIMED_BLOCK("render_frame");
+        renderer_begin_frame(
+            g_renderer,
+            frame->window_width,
+            frame->window_height,
+            frame->commands.width,
+            frame->commands.height
+        );
+        execute_render_commands(g_renderer, &frame->commands);
+        renderer_end_frame(g_renderer);
+
+        // Swap buffers
+        TIMED_BLOCK("swap_buffers");
+        SwapBuffers(g_device_context);
+    }
+
+    // The presented frame closes the profiler frame
+    if (g_profiler) {
+        profile_render_stats(g_profiler, g_renderer, &frame->commands);
+        profiler_end_frame(g_profiler, get_time_seconds());
+
+        debug_overlay_capture_if_requested(&g_overlay, g_profiler);
+    }
+}
+
+static PIPELINE_BIND_CONTEXT(win32_bind_context) {
+    (void)user_data;
+    if (bind) {
+        wglMakeCurrent(g_device_context, g_gl_context);
+    } else {
+        wglMakeCurrent(nullptr, nullptr);
+    }
+}
+
+// Set the swap interval on the current context (1 = vsync, 0 = off)
+static void win32_set_swap_interval(i32 interval) {
+    PFNWGLSWAPINTERVALEXTPROC wglSwapIntervalEXT =
+        (PFNWGLSWAPINTERVALEXTPROC)wglGetProcAddress("wglSwapIntervalEXT");
+    if (wglSwapIntervalEXT) {
+        wglSwapIntervalEXT(interval);
+    } else {
+        println("Swap interval control not available");
+    }
+}
+
+// Copy the word after `flag` in the command line into `out`. Returns null if
+// the flag is missing or its value does not fit.
+static const char* win32_command_line_value(
+    const char* command_line,
+    const char* flag,
+    char* out,
+    usize size
+) {
+    const char* value = strstr(command_line, flag);
+    if (!value) {
+        return nullptr;
+    }
+    value += strlen(flag);
+    usize length = 0;
+    while (value[length] && value[length] != ' ') {
+        length++;
+    }
+    if (length == 0 || length >= size) {
+        return nullptr;
+    }
+    memcpy(out, value, length);
+    out[length] = 0;
+    return out;
+}
+
 static void destroy_window_and_context() {
     if (g_gl_context) {
         wglMakeCurrent(nullptr, nullptr);
@@ -367,12 +409,6 @@ static void destroy_window_and_context() {
     }
 }
 
-static f64 get_time_seconds() {
-    LARGE_INTEGER counter;
-    QueryPerformanceCounter(&counter);
-    return (f64)counter.QuadPart / (f64)g_perf_frequency.QuadPart;
-}
-
 int WINAPI WinMain(
     HINSTANCE hInstance,
     HINSTANCE hPrevInstance,
@@ -380,11 +416,39 @@ int WINAPI WinMain(
     int nCmdShow
 ) {
     (void)hPrevInstance;
-    (void)lpCmdLine;
     (void)nCmdShow;
 
+    // --lockstep runs update and render back-to-back on one thread
+    // --no-vsync disables vsync; --fps N caps the frame rate by sleeping
+    // --hot-shaders reads the shaders from src/shaders and reloads edits
+    // --record FILE records the session's input; --replay FILE plays one
+    // back in a loop, at the rate the other flags set
+    b32 lockstep = strstr(lpCmdLine, "--lockstep") != nullptr;
+    b32 vsync = strstr(lpCmdLine, "--no-vsync") == nullptr;
+    b32 hot_shaders = strstr(lpCmdLine, "--hot-shaders") != nullptr;
+    f64 target_fps = 0.0;
+    const char* fps_arg = strstr(lpCmdLine, "--fps ");
+    if (fps_arg) {
+        target_fps = atof(fps_arg + 6);
+    }
+    char record_buffer[MAX_PATH];
+    char replay_buffer[MAX_PATH];
+    const char* record_path = win32_command_line_value(
+        lpCmdLine,
+        "--record ",
+        record_buffer,
+        sizeof(record_buffer)
+    );
+    const char* replay_path = win32_command_line_value(
+        lpCmdLine,
+        "--replay ",
+        replay_buffer,
+        sizeof(replay_buffer)
+    );
+
     // Initialize timing
     QueryPerformanceFrequency(&g_perf_frequency);
+    platform_request_fine_sleep();
 
     // Create console for debug output
     AllocConsole();
@@ -395,36 +459,89 @@ int WINAPI WinMain(
         return 1;
     }
 
-    // Allocate game memory
+    InputPlayback playback = {};
+    if (replay_path && !input_playback_open(&playback, replay_path)) {
+        println("Failed to open recording {}", replay_path);
+        replay_path = nullptr;
+    }
+
+    // Allocate game memory, where recordings expect it
     g_game_memory.permanent_storage_size = MB(64);
     g_game_memory.transient_storage_size = MB(256);
-
-    u64 total_size = g_game_memory.permanent_storage_size +
-                     g_game_memory.transient_storage_size;
-
-    void* base_memory = platform_alloc(total_size);
-    if (!base_memory) {
+    if (replay_path) {
+        input_playback_size_memory(&playback, &g_game_memory);
+    }
+    if (!input_recording_alloc_game_memory(&g_game_memory)) {
         println("Failed to allocate game memory");
         return 1;
     }
 
-    g_game_memory.permanent_storage = base_memory;
-    g_game_memory.transient_storage =
-        (u8*)base_memory + g_game_memory.permanent_storage_size;
-
-    // Arena for render commands
-    void* render_memory = platform_alloc(MB(4));
-    if (!render_memory) {
-        println("Failed to allocate render memory");
+    // Start the job threads; the game falls back to running jobs inline if
+    // this fails
+    g_job_queue = platform_create_job_queue();
+    platform_attach_job_queue(&g_game_memory, g_job_queue);
+
+    // Per-frame scratch arenas
+    if (!platform_init_scratch(
+            &g_game_memory,
+            PLATFORM_FRAME_SCRATCH_SIZE,
+            PLATFORM_THREAD_SCRATCH_SIZE
+        )) {
+        println("Failed to reserve scratch memory");
         return 1;
     }
 
-    g_render_commands.width = 320;
-    g_render_commands.height = 180;
-    g_render_commands.arena = MemoryArena::make(render_memory, MB(4));
+    if (replay_path && (playback.frame_count == 0 ||
+                        !input_playback_restart(&playback, &g_game_memory))) {
+        println("Recording {} does not fit this run", replay_path);
+        input_playback_close(&playback);
+        replay_path = nullptr;
+    }
+    InputRecorder recorder = {};
+    if (record_path &&
+        !input_recording_begin(&recorder, record_path, &g_game_memory)) {
+        println("Failed to start recording {}", record_path);
+    }
+
+    // Profiler shared with the game; profiling is skipped if this fails
+    g_profiler = (Profiler*)platform_alloc(sizeof(Profiler));
+    g_game_memory.profiler = g_profiler;
+
+    // Arenas for render commands, one per frame in flight
+    MemoryArena render_arenas[FRAME_PIPELINE_SLOTS];
+    if (!frame_pipeline_reserve_arenas(render_arenas)) {
+        println("Failed to reserve render memory");
+        return 1;
+    }
 
     // Initialize renderer
-    g_renderer = renderer_init();
+    RendererConfig renderer_config = {};
+    renderer_config.batch_mode = RendererBatchMode_Instanced;
+    renderer_config.texture_arrays = true;
+    renderer_config.texture_atlas = true;
+    renderer_config.shader_cache_dir = "out/shader_cache";
+    if (hot_shaders) {
+        renderer_config.shader_source_dir = SHADER_WATCH_SOURCE_DIR;
+    }
+    g_renderer = renderer_init(&renderer_config);
+
+    win32_set_swap_interval(vsync ? 1 : 0);
+
+    // Hand the GL context to the render thread
+    if (!lockstep) {
+        wglMakeCurrent(nullptr, nullptr);
+    }
+    if (!frame_pipeline_start(
+            &g_pipeline,
+            render_arenas,
+            lockstep,
+            win32_render_frame,
+            win32_bind_context,
+            nullptr
+        )) {
+        println("Failed to start render thread, running in lockstep");
+        wglMakeCurrent(g_device_context, g_gl_context);
+    }
 
     // Load game code
     g_game_dll =
@@ -434,17 +551,59 @@ int WINAPI WinMain(
     if (!g_game_code.is_valid) {
         println("Warning: Failed to load game code");
     }
+    if (!file_watcher_start(&g_file_watcher)) {
+        println("File watcher unavailable, polling for changes");
+    }
+    platform_watch_game_code(&g_game_dll, &g_file_watcher);
+    if (hot_shaders) {
+        platform_watch_shaders(
+            &g_shader_watch,
+            &g_file_watcher,
+            SHADER_WATCH_SOURCE_DIR
+        );
+    }
+    if (!game_code_loader_start(&g_game_loader)) {
+        println("Failed to start game code loader, reloading inline");
+    }
 
-    f64 last_time = get_time_seconds();
+    FramePacer pacer;
+    frame_pacer_init(
+        &pacer,
+        GAME_TICKS_PER_SECOND,
+        target_fps,
+        get_time_seconds()
+    );
 
     while (g_running) {
-        // Hot-reload game code
-        platform_reload_game_code_if_changed(&g_game_dll, &g_game_code);
+        // Route file changes from the watcher
+        u32 watch_id;
+        while (file_watcher_poll(&g_file_watcher, &watch_id)) {
+            platform_game_code_file_changed(&g_game_dll, watch_id);
+            platform_shader_file_changed(
+                &g_shader_watch,
+                g_renderer,
+                watch_id
+            );
+        }
+
+        // Hot-reload game code once a rebuild lands. The loader thread opens
+        // it; queued jobs point into the old code, so drain them before the
+        // swap.
+        platform_request_game_code(&g_game_loader, &g_game_dll);
+        if (platform_game_code_ready(&g_game_loader)) {
+            if (g_job_queue) {
+                platform_complete_all_jobs(g_job_queue);
+            }
+            platform_swap_game_code(&g_game_loader, &g_game_dll, &g_game_code);
+        }
 
-        // Calculate delta time
-        f64 current_time = get_time_seconds();
-        g_game_input.dt_for_frame = (f32)(current_time - last_time);
-        last_time = current_time;
+        // Advance the fixed-step clock
+        g_game_input.dt_for_frame = (f32)pacer.tick_seconds;
+        g_game_input.sim_ticks = frame_pacer_advance(
+            &pacer,
+            get_time_seconds(),
+            &g_game_input.render_alpha
+        );
 
         // Process Windows messages
         MSG msg;
@@ -456,30 +615,74 @@ int WINAPI WinMain(
             DispatchMessageA(&msg);
         }
 
-        // Reset render commands
-        g_render_commands.arena.used = 0;
+        // A recording stands in for live input and window size, rewinding
+        // at its end once the render thread is done with the game's memory
+        GameInput input = g_game_input;
+        u32 target_width = (u32)g_window_width;
+        u32 target_height = (u32)g_window_height;
+        if (replay_path) {
+            const InputRecordingFrame* replayed =
+                input_playback_next(&playback);
+            if (!replayed) {
+                frame_pipeline_flush(&g_pipeline);
+                input_playback_restart(&playback, &g_game_memory);
+                replayed = input_playback_next(&playback);
+            }
+            input = replayed->input;
+            target_width = replayed->window_width;
+            target_height = replayed->window_height;
+        }
+
+        // Record into the next free frame; in pipelined mode this waits while
+        // the render thread is still busy with both
+        PipelineFrame* frame = frame_pipeline_begin(&g_pipeline);
+        frame->window_width = g_window_width;
+        frame->window_height = g_window_height;
+        platform_target_size(
+            target_width,
+            target_height,
+            &frame->commands.width,
+            &frame->commands.height
+        );
 
         // Update and render game
+        platform_reset_scratch(&g_game_memory);
         if (g_game_code.is_valid) {
+            input_recording_frame(
+                &recorder,
+                &input,
+                target_width,
+                target_height
+            );
             g_game_code.update_and_render(
                 &g_game_memory,
-                &g_game_input,
-                &g_render_commands
+                &input,
+                &frame->commands
             );
         }
+        if (g_overlay.visible && g_profiler) {
+            debug_overlay_push(&g_overlay, g_profiler, &frame->commands);
+        }
 
-        // Execute render commands
-        renderer_begin_frame(g_renderer, g_window_width, g_window_height);
-        execute_render_commands(g_renderer, &g_render_commands);
-        renderer_end_frame(g_renderer);
+        // Replay on the render thread, or right here in lockstep
+        frame_pipeline_submit(&g_pipeline);
 
-        // Swap buffers
-        SwapBuffers(g_device_context);
+        // Sleep off the rest of the frame if capped
+        frame_pacer_wait(&pacer, get_time_seconds);
 
         // Reset input transitions
         reset_input_half_transitions(&g_game_input);
     }
 
+    frame_pipeline_stop(&g_pipeline);
+    if (record_path && !input_recording_end(&recorder)) {
+        println("Failed to write recording {}", record_path);
+    }
+    if (g_profiler) {
+        debug_print_arena_report(g_profiler);
+    }
+    file_watcher_stop(&g_file_watcher);
+    game_code_loader_stop(&g_game_loader);
     platform_unload_game_code(&g_game_dll);
     destroy_window_and_context();
 
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "lib/def.h"
+#include "platform/file_map.h"
+#include "renderer.h"
+#include <string.h>
+
+// Binary asset pack: GPU-ready textures behind a sorted index, written by
+// tools/asset_packer.cpp
+//
+//   AssetPackHeader
+//   AssetPackEntry entries[entry_count]   sorted by name
+//   texel data, each texture starting on an ASSET_PACK_ALIGNMENT boundary
+//
+// Texels are stored exactly as renderer_load_texture takes them (top row
+// first, rows tightly packed, RGBA8 or R8). The runtime maps the file and
+// hands out pointers straight into the mapping, so loading does no decode,
+// no swizzle and no copy of its own.
+
+#define ASSET_PACK_MAGIC 0x4B415052 // "RPAK"
+#define ASSET_PACK_VERSION 1
+#define ASSET_PACK_NAME_SIZE 48
+#define ASSET_PACK_ALIGNMENT 64
+
+enum AssetPackFormat {
+    AssetPackFormat_RGBA8 = 0,
+    AssetPackFormat_R8 = 1,
+};
+
+struct AssetPackHeader {
+    u32 magic;
+    u32 version;
+    u32 entry_count;
+    u32 reserved;
+    u64 file_size;
+};
+
+struct AssetPackEntry {
+    char name[ASSET_PACK_NAME_SIZE]; // Zero-terminated
+    u32 format;                      // AssetPackFormat
+    u32 width;
+    u32 height;
+    u32 reserved;
+    u64 offset; // From the start of the file
+    u64 size;
+};
+
+static_assert(sizeof(AssetPackHeader) == 24, "AssetPackHeader is on disk");
+static_assert(sizeof(AssetPackEntry) == 80, "AssetPackEntry is on disk");
+
+struct AssetPack {
+    PlatformFileMap file;
+    const AssetPackEntry* entries;
+    u32 entry_count;
+};
+
+inline u32 asset_pack_format_channels(u32 format) {
+    return (format == AssetPackFormat_R8) ? 1 : 4;
+}
+
+// Map a pack and check its index against the file, so entries can be used
+// without further bounds checks. Returns false if the file is missing or
+// malformed.
+inline b32 asset_pack_open(AssetPack* pack, const char* path) {
+    *pack = {};
+    if (!platform_map_file(path, &pack->file)) {
+        return false;
+    }
+
+    const u8* data = pack->file.data;
+    usize size = pack->file.size;
+    const AssetPackHeader* header = (const AssetPackHeader*)data;
+    b32 valid = size >= sizeof(AssetPackHeader) &&
+                header->magic == ASSET_PACK_MAGIC &&
+                header->version == ASSET_PACK_VERSION &&
+                header->file_size == size &&
+                header->entry_count <=
+                    (size - sizeof(AssetPackHeader)) / sizeof(AssetPackEntry);
+
+    const AssetPackEntry* entries = (const AssetPackEntry*)(header + 1);
+    for (u32 i = 0; valid && i < header->entry_count; i++) {
+        const AssetPackEntry* entry = &entries[i];
+        u64 texels = (u64)entry->width * entry->height;
+        valid = entry->name[ASSET_PACK_NAME_SIZE - 1] == 0 &&
+                (entry->format == AssetPackFormat_RGBA8 ||
+                 entry->format == AssetPackFormat_R8) &&
+                entry->size ==
+                    texels * asset_pack_format_channels(entry->format) &&
+                entry->offset <= size && entry->size <= size - entry->offset;
+    }
+    if (!valid) {
+        platform_unmap_file(&pack->file);
+        return false;
+    }
+
+    pack->entries = entries;
+    pack->entry_count = header->entry_count;
+    return true;
+}
+
+inline void asset_pack_close(AssetPack* pack) {
+    platform_unmap_file(&pack->file);
+    *pack = {};
+}
+
+// Binary search of the index, or null if the pack has no such asset
+inline const AssetPackEntry*
+asset_pack_find(AssetPack* pack, const char* name) {
+    u32 low = 0;
+    u32 high = pack->entry_count;
+    while (low < high) {
+        u32 mid = low + (high - low) / 2;
+        const char* mid_name = pack->entries[mid].name;
+        i32 order = strncmp(name, mid_name, ASSET_PACK_NAME_SIZE);
+        if (order == 0) {
+            return &pack->entries[mid];
+        }
+        if (order < 0) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+    return nullptr;
+}
+
+inline const void*
+asset_pack_data(AssetPack* pack, const AssetPackEntry* entry) {
+    return pack->file.data + entry->offset;
+}
+
+// Upload a texture straight from the mapping. Returns 0 (the white texture)
+// if the pack has no such asset or the renderer is out of room.
+inline u32 asset_pack_load_texture(
+    AssetPack* pack,
+    Renderer* renderer,
+    const char* name
+) {
+    const AssetPackEntry* entry = asset_pack_find(pack, name);
+    if (!entry) {
+        return 0;
+    }
+    return renderer_load_texture(
+        renderer,
+        asset_pack_data(pack, entry),
+        (i32)entry->width,
+        (i32)entry->height,
+        (i32)asset_pack_format_channels(entry->format)
+    );
+}
@@ -0,0 +1,353 @@
+#pragma once
+
+#include "game_interface.h"
+#include "lib/def.h"
+#include "lib/memory_arena.h"
+#include "platform/asset_pack.h"
+#include "platform/file_map.h"
+#include "platform/job_queue.h"
+#include "platform/memory.h"
+#include "renderer.h"
+#include "util/bmp_loader.h"
+#include <print>
+#include <string.h>
+
+using std::println;
+
+// Asynchronous texture streaming
+//
+// The frame loop requests a texture by path, or by name from an open asset
+// pack, and gets a handle back straight away. Files are decoded on worker
+// threads (BMP with bmp_load, PNG, JPEG and TGA with stb_image), each into an
+// arena of its own; packed textures are GPU-ready already and skip decoding.
+// The thread that owns the GL context then streams the texels in through
+// renderer_upload_texture_rows, a batch of rows at a time and never more
+// than the frame's upload budget, so a large texture is spread over several
+// frames instead of stalling one. A handle resolves to its texture id once
+// the last row is in, and to 0 (the white texture) until then.
+//
+// Requests come from one thread (the frame loop), uploads from one (the
+// render thread, or the frame loop itself in lockstep). Each asset's state
+// names the side that owns its fields, as in GameCodeLoader.
+
+#define ASSET_STREAMER_MAX_ASSETS 256 // The renderer's texture limit
+#define ASSET_STREAMER_NAME_SIZE 256
+#define ASSET_STREAMER_MAX_DECODE_THREADS 2
+
+// Address space reserved per decode. Pages are committed as the decoder
+// needs them and released once the texture is uploaded.
+#define ASSET_STREAMER_DECODE_RESERVE MB(256)
+
+// stb_image allocates from the decoding asset's arena. It frees only scratch
+// that the arena drops along with everything else after the upload. Running
+// out of reserve returns null, which stb_image reports as a failed decode.
+inline thread_local MemoryArena* t_asset_decode_arena = nullptr;
+
+inline void* asset_decode_alloc(usize size) {
+    MemoryArena* arena = t_asset_decode_arena;
+    if (size > arena->remaining() ||
+        arena->remaining() - size < alignof(max_align_t)) {
+        return nullptr;
+    }
+    return arena->push_size(size);
+}
+
+inline void* asset_decode_realloc(void* old, usize old_size, usize new_size) {
+    void* result = asset_decode_alloc(new_size);
+    if (!result) {
+        return nullptr;
+    }
+    if (old) {
+        memcpy(result, old, (old_size < new_size) ? old_size : new_size);
+    }
+    return result;
+}
+
+#define STBI_MALLOC(size) asset_decode_alloc(size)
+#define STBI_REALLOC_SIZED(old, old_size, new_size)                            \
+    asset_decode_realloc(old, old_size, new_size)
+#define STBI_FREE(pointer) ((void)(pointer))
+#define STBI_NO_STDIO
+#define STBI_ONLY_PNG
+#define STBI_ONLY_JPEG
+#define STBI_ONLY_TGA
+#define STB_IMAGE_STATIC
+#define STB_IMAGE_IMPLEMENTATION
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#include "stb/stb_image.h"
+#pragma GCC diagnostic pop
+
+enum AssetState {
+    AssetState_Decoding,  // Queued or running on a decode thread
+    AssetState_Decoded,   // Texels ready, waiting for the uploader
+    AssetState_Uploading, // Uploader streaming rows in
+    AssetState_Ready,     // texture_id is valid
+    AssetState_Failed,
+};
+
+struct StreamedAsset {
+    u32 state; // AssetState, accessed with __atomic builtins
+    char name[ASSET_STREAMER_NAME_SIZE]; // Path, or name in the pack
+
+    // Owned by whichever side the state names
+    const u8* pixels; // Top row first, tightly packed
+    i32 width;
+    i32 height;
+    i32 channels;
+    MemoryArena arena; // Decode memory; unused for packed textures
+    u32 texture_id;
+    i32 rows_uploaded;
+};
+
+// Zeroed handle is null and never resolves
+struct AssetHandle {
+    u32 index; // Asset index + 1
+};
+
+struct AssetStreamer {
+    PlatformJobQueue* decoders; // Null or workerless: decode at request
+    StreamedAsset assets[ASSET_STREAMER_MAX_ASSETS];
+    u32 asset_count; // Published by the requester with __atomic builtins
+
+    // Uploader only: every asset before this one is Ready or Failed
+    u32 first_pending;
+};
+
+// Decode thread, or the requester when there are none
+inline PLATFORM_JOB_CALLBACK(asset_decode_job) {
+    (void)queue;
+    (void)thread_index;
+    StreamedAsset* asset = (StreamedAsset*)data;
+
+    b32 decoded = false;
+    if (platform_reserve_arena(
+            &asset->arena,
+            ASSET_STREAMER_DECODE_RESERVE,
+            ArenaFlag_DecommitOnClear
+        )) {
+        const char* extension = strrchr(asset->name, '.');
+        if (extension && (strcmp(extension, ".bmp") == 0 ||
+                          strcmp(extension, ".BMP") == 0)) {
+            // bmp_load asserts on running out of arena, so size it first
+            i32 width;
+            i32 height;
+            if (bmp_info(asset->name, &width, &height) && width > 0 &&
+                height > 0 &&
+                bmp_load_size(width, height) <= asset->arena.remaining()) {
+                BMPImage image = bmp_load(asset->name, &asset->arena);
+                asset->pixels = image.pixels;
+                asset->width = image.width;
+                asset->height = image.height;
+                asset->channels = 4;
+                decoded = image.valid;
+            }
+        } else {
+            // stb_image allocates even to read the header
+            t_asset_decode_arena = &asset->arena;
+            PlatformFileMap file;
+            if (platform_map_file(asset->name, &file)) {
+                i32 width;
+                i32 height;
+                i32 channels;
+                if (stbi_info_from_memory(
+                        file.data,
+                        (i32)file.size,
+                        &width,
+                        &height,
+                        &channels
+                    )) {
+                    // The renderer takes R8 or RGBA8
+                    asset->channels = (channels == 1) ? 1 : 4;
+                    asset->pixels = stbi_load_from_memory(
+                        file.data,
+                        (i32)file.size,
+                        &asset->width,
+                        &asset->height,
+                        &channels,
+                        asset->channels
+                    );
+                    decoded = asset->pixels != nullptr;
+                }
+                platform_unmap_file(&file);
+            }
+            t_asset_decode_arena = nullptr;
+        }
+        if (!decoded) {
+            platform_release_arena(&asset->arena);
+        }
+    }
+
+    if (!decoded) {
+        println("Failed to decode {}", asset->name);
+    }
+    __atomic_store_n(
+        &asset->state,
+        (u32)(decoded ? AssetState_Decoded : AssetState_Failed),
+        __ATOMIC_RELEASE
+    );
+}
+
+// Start the decode threads, leaving the other cores to the game and render
+// threads. Without them files are decoded inline when requested.
+inline void asset_streamer_start(AssetStreamer* streamer) {
+    *streamer = {};
+    u32 decode_threads = platform_processor_count() - 1;
+    if (decode_threads > ASSET_STREAMER_MAX_DECODE_THREADS) {
+        decode_threads = ASSET_STREAMER_MAX_DECODE_THREADS;
+    }
+    if (decode_threads < 1) {
+        decode_threads = 1;
+    }
+    streamer->decoders = platform_create_worker_queue(decode_threads);
+}
+
+// Requester: claim the next asset, or null if the streamer is full
+inline StreamedAsset*
+asset_streamer_add(AssetStreamer* streamer, const char* name) {
+    if (streamer->asset_count >= ASSET_STREAMER_MAX_ASSETS ||
+        strlen(name) >= ASSET_STREAMER_NAME_SIZE) {
+        return nullptr;
+    }
+    StreamedAsset* asset = &streamer->assets[streamer->asset_count];
+    *asset = {};
+    strcpy(asset->name, name);
+    return asset;
+}
+
+// Requester: hand a filled-in asset to the uploader
+inline AssetHandle
+asset_streamer_publish(AssetStreamer* streamer, StreamedAsset* asset) {
+    u32 index = (u32)(asset - streamer->assets);
+    __atomic_store_n(&streamer->asset_count, index + 1, __ATOMIC_RELEASE);
+    return {index + 1};
+}
+
+// Request a texture file, decoded off the calling thread. Returns the null
+// handle if the streamer is full.
+inline AssetHandle
+asset_streamer_request_file(AssetStreamer* streamer, const char* path) {
+    StreamedAsset* asset = asset_streamer_add(streamer, path);
+    if (!asset) {
+        return {};
+    }
+    asset->state = AssetState_Decoding;
+    AssetHandle handle = asset_streamer_publish(streamer, asset);
+
+    PlatformJobQueue* decoders = streamer->decoders;
+    if (decoders && decoders->worker_count > 0) {
+        platform_add_job(decoders, asset_decode_job, asset);
+    } else {
+        asset_decode_job(nullptr, asset, 0);
+    }
+    return handle;
+}
+
+// Request a texture from an asset pack, which must stay open until the
+// handle resolves. Its texels upload straight from the mapping. Returns the
+// null handle if the pack has no such texture or the streamer is full.
+inline AssetHandle asset_streamer_request_packed(
+    AssetStreamer* streamer,
+    AssetPack* pack,
+    const char* name
+) {
+    const AssetPackEntry* entry = asset_pack_find(pack, name);
+    StreamedAsset* asset = entry ? asset_streamer_add(streamer, name) : nullptr;
+    if (!asset) {
+        return {};
+    }
+    asset->pixels = (const u8*)asset_pack_data(pack, entry);
+    asset->width = (i32)entry->width;
+    asset->height = (i32)entry->height;
+    asset->channels = (i32)asset_pack_format_channels(entry->format);
+    asset->state = AssetState_Decoded;
+    return asset_streamer_publish(streamer, asset);
+}
+
+// Uploader: drop the decode memory and hand the asset back
+inline void asset_streamer_finish(StreamedAsset* asset, AssetState state) {
+    if (asset->arena.base) {
+        platform_release_arena(&asset->arena);
+    }
+    asset->pixels = nullptr;
+    __atomic_store_n(&asset->state, (u32)state, __ATOMIC_RELEASE);
+}
+
+// Uploader, once per frame between renderer_begin_frame and
+// renderer_end_frame: create textures for decoded assets and stream in as
+// many rows as the frame's budget allows, oldest request first
+inline void asset_streamer_upload(AssetStreamer* streamer, Renderer* renderer) {
+    u32 count = __atomic_load_n(&streamer->asset_count, __ATOMIC_ACQUIRE);
+    usize frame_budget = renderer_texture_upload_available(renderer);
+
+    for (u32 i = streamer->first_pending; i < count; i++) {
+        StreamedAsset* asset = &streamer->assets[i];
+        u32 state = __atomic_load_n(&asset->state, __ATOMIC_ACQUIRE);
+        if (state == AssetState_Ready || state == AssetState_Failed) {
+            if (i == streamer->first_pending) {
+                streamer->first_pending++;
+            }
+            continue;
+        }
+
+        if (state == AssetState_Decoded) {
+            asset->texture_id = renderer_create_texture(
+                renderer,
+                asset->width,
+                asset->height,
+                asset->channels
+            );
+            if (!asset->texture_id) {
+                println("No room for texture {}", asset->name);
+                asset_streamer_finish(asset, AssetState_Failed);
+                continue;
+            }
+            asset->rows_uploaded = 0;
+            state = AssetState_Uploading;
+            __atomic_store_n(&asset->state, state, __ATOMIC_RELEASE);
+        }
+        if (state != AssetState_Uploading) {
+            continue;
+        }
+
+        usize row_bytes = (usize)asset->width * (usize)asset->channels;
+        if (row_bytes > frame_budget) {
+            println("Rows of {} exceed the upload budget", asset->name);
+            asset_streamer_finish(asset, AssetState_Failed);
+            continue;
+        }
+        usize fit = renderer_texture_upload_available(renderer) / row_bytes;
+        i32 rows = asset->height - asset->rows_uploaded;
+        if ((usize)rows > fit) {
+            rows = (i32)fit;
+        }
+        if (rows == 0) {
+            break; // Budget spent; carry on next frame
+        }
+
+        b32 uploaded = renderer_upload_texture_rows(
+            renderer,
+            asset->texture_id,
+            asset->pixels + (usize)asset->rows_uploaded * row_bytes,
+            asset->rows_uploaded,
+            rows
+        );
+        ASSERT(uploaded);
+        (void)uploaded;
+        asset->rows_uploaded += rows;
+        if (asset->rows_uploaded == asset->height) {
+            asset_streamer_finish(asset, AssetState_Ready);
+        }
+    }
+}
+
+// The handle's texture id once it is ready, 0 (the white texture) until then
+// or if it failed
+inline u32 asset_streamer_texture(AssetStreamer* streamer, AssetHandle handle) {
+    if (handle.index == 0) {
+        return 0;
+    }
+    StreamedAsset* asset = &streamer->assets[handle.index - 1];
+    u32 state = __atomic_load_n(&asset->state, __ATOMIC_ACQUIRE);
+    return (state == AssetState_Ready) ? asset->texture_id : 0;
+}
@@ -0,0 +1,552 @@
+#pragma once
+
+#include "game_interface.h"
+#include "lib/def.h"
+#include "lib/profiler.h"
+#include <cstdio>
+#include <string.h>
+#include <print>
+
+using std::println;
+
+// Profiler overlay and trace capture for the platform layers.
+//
+// The overlay is pushed on the game thread after update_and_render, as plain
+// Rect commands on the top layer, so it goes through the same path as the
+// game's own drawing. It only reads completed profiler frames, which the
+// render thread no longer writes, and is capped at DEBUG_OVERLAY_MAX_RECTS
+// commands so turning it on doesn't move the numbers it shows:
+//
+//   - frame time graph of the last DEBUG_OVERLAY_GRAPH_FRAMES frames, with a
+//     line at the tick rate's frame time
+//   - a bar per timed block, averaged over a few frames, indented by depth
+//     and colored by block id (the renderer has no text, so the color is the
+//     label; ids are stable across reloads)
+//   - GPU draw and blit time
+//   - a bar per reported arena: the frame's high-water mark out of what is
+//     committed, with a tick at the lifetime peak, colored by arena
+//
+// A capture writes the last DEBUG_CAPTURE_FRAMES frames of raw timing events
+// to a Chrome trace JSON file, which about:tracing and ui.perfetto.dev open,
+// with a counter track per arena. It has to run on the thread that ends
+// profiler frames. debug_print_arena_report prints the lifetime arena peaks
+// and push sites, for sizing memory.
+
+#define DEBUG_OVERLAY_GRAPH_FRAMES 64
+#define DEBUG_OVERLAY_AVERAGE_FRAMES 8
+#define DEBUG_OVERLAY_MAX_TIMERS 16
+#define DEBUG_OVERLAY_MAX_ARENAS 8
+#define DEBUG_OVERLAY_MAX_RECTS 120
+#define DEBUG_CAPTURE_FRAMES 60
+
+struct DebugOverlay {
+    b32 visible; // Game thread only
+    b32 capture_requested; // Accessed with __atomic builtins
+};
+
+// Game thread: ask for a capture at the end of the next presented frame
+inline void debug_overlay_request_capture(DebugOverlay* overlay) {
+    __atomic_store_n(&overlay->capture_requested, true, __ATOMIC_RELEASE);
+}
+
+// Render thread: consume a pending capture request
+inline b32 debug_overlay_take_capture(DebugOverlay* overlay) {
+    return __atomic_exchange_n(
+        &overlay->capture_requested,
+        false,
+        __ATOMIC_ACQ_REL
+    );
+}
+
+inline void debug_overlay_rect(
+    RenderCommands* commands,
+    u32* rect_count,
+    f32 x,
+    f32 y,
+    f32 w,
+    f32 h,
+    Color color
+) {
+    if (*rect_count >= DEBUG_OVERLAY_MAX_RECTS || w <= 0.0f || h <= 0.0f) {
+        return;
+    }
+    RenderCommandRect* rect = push_render_command<RenderCommandRect>(
+        commands,
+        RenderCommand_Rect,
+        RENDER_LAYER_COUNT - 1
+    );
+    rect->x = x;
+    rect->y = y;
+    rect->w = w;
+    rect->h = h;
+    rect->color = color;
+    (*rect_count)++;
+}
+
+// Frame time from the frame's own clock span, so the overlay never touches
+// the calibration the render thread keeps updating
+inline f64 debug_overlay_block_ms(ProfileFrame* frame, u64 cycles) {
+    u64 span = frame->end_clock - frame->begin_clock;
+    if (span == 0) {
+        return 0.0;
+    }
+    return (f64)cycles * frame->seconds * 1000.0 / (f64)span;
+}
+
+inline Color debug_overlay_block_color(u32 block) {
+    static const Color palette[] = {
+        0xE6194BFF,
+        0x3CB44BFF,
+        0xFFE119FF,
+        0x4363D8FF,
+        0xF58231FF,
+        0x911EB4FF,
+        0x46F0F0FF,
+        0xF032E6FF,
+    };
+    u32 hash = block * 2654435761u;
+    return palette[(hash >> 29) % (sizeof(palette) / sizeof(palette[0]))];
+}
+
+// Game thread: draw the overlay over what the game recorded this frame
+inline void debug_overlay_push(
+    DebugOverlay* overlay,
+    Profiler* profiler,
+    RenderCommands* commands
+) {
+    TIMED_FUNCTION();
+    (void)overlay;
+
+    u32 completed = profiler_completed_frames(profiler);
+    u32 graph_frames = (completed < DEBUG_OVERLAY_GRAPH_FRAMES)
+                           ? completed
+                           : DEBUG_OVERLAY_GRAPH_FRAMES;
+
+    constexpr f32 X = 2.0f;
+    constexpr f32 Y = 2.0f;
+    constexpr f32 WIDTH = DEBUG_OVERLAY_GRAPH_FRAMES * 2.0f;
+    constexpr f32 GRAPH_HEIGHT = 32.0f;
+    constexpr f32 BAR_HEIGHT = 2.0f;
+    constexpr f32 BAR_STEP = 3.0f;
+    constexpr f64 TARGET_MS = 1000.0 / GAME_TICKS_PER_SECOND;
+    constexpr f64 GRAPH_MS = TARGET_MS * 2.0; // Full graph height
+
+    constexpr u32 BAR_ROWS =
+        2 + DEBUG_OVERLAY_MAX_TIMERS + DEBUG_OVERLAY_MAX_ARENAS;
+
+    u32 rect_count = 0;
+    f32 panel_height = GRAPH_HEIGHT + 4.0f + BAR_ROWS * BAR_STEP + 2.0f;
+    debug_overlay_rect(
+        commands,
+        &rect_count,
+        X - 1.0f,
+        Y - 1.0f,
+        WIDTH + 2.0f,
+        panel_height,
+        0x000000B0
+    );
+
+    // Frame times, oldest on the left
+    for (u32 i = 0; i < graph_frames; i++) {
+        u32 index = completed - graph_frames + i;
+        ProfileFrame* frame = &profiler->frames[index % PROFILER_HISTORY];
+        f64 ms = frame->seconds * 1000.0;
+        f32 h = (f32)(ms / GRAPH_MS) * GRAPH_HEIGHT;
+        if (h > GRAPH_HEIGHT) {
+            h = GRAPH_HEIGHT;
+        }
+        Color color = (ms <= TARGET_MS * 1.05) ? 0x40C040FF
+                      : (ms <= TARGET_MS * 2.0) ? 0xE0C040FF
+                                                : 0xE04040FF;
+        f32 x = X + (f32)(DEBUG_OVERLAY_GRAPH_FRAMES - graph_frames + i) * 2.0f;
+        debug_overlay_rect(
+            commands,
+            &rect_count,
+            x,
+            Y + GRAPH_HEIGHT - h,
+            2.0f,
+            h,
+            color
+        );
+    }
+    f32 target_y =
+        Y + GRAPH_HEIGHT - (f32)(TARGET_MS / GRAPH_MS) * GRAPH_HEIGHT;
+    debug_overlay_rect(
+        commands,
+        &rect_count,
+        X,
+        target_y,
+        WIDTH,
+        1.0f,
+        0xFFFFFF80
+    );
+
+    if (completed == 0) {
+        return;
+    }
+
+    // Bars below the graph share one scale: full width is one target frame
+    f32 y = Y + GRAPH_HEIGHT + 4.0f;
+    f32 ms_to_width = (f32)(WIDTH / TARGET_MS);
+
+    ProfileFrame* last = &profiler->frames[(completed - 1) % PROFILER_HISTORY];
+    f32 gpu_draw = (f32)last->gpu_draw_ms * ms_to_width;
+    f32 gpu_blit = (f32)last->gpu_blit_ms * ms_to_width;
+    debug_overlay_rect(
+        commands,
+        &rect_count,
+        X,
+        y,
+        (gpu_draw < WIDTH) ? gpu_draw : WIDTH,
+        BAR_HEIGHT,
+        0xC0C0C0FF
+    );
+    y += BAR_STEP;
+    debug_overlay_rect(
+        commands,
+        &rect_count,
+        X,
+        y,
+        (gpu_blit < WIDTH) ? gpu_blit : WIDTH,
+        BAR_HEIGHT,
+        0x808080FF
+    );
+    y += BAR_STEP;
+
+    // Timed blocks, averaged so the bars don't flicker
+    u32 average_frames = (completed < DEBUG_OVERLAY_AVERAGE_FRAMES)
+                             ? completed
+                             : DEBUG_OVERLAY_AVERAGE_FRAMES;
+    u32 block_count =
+        __atomic_load_n(&profiler->block_count, __ATOMIC_ACQUIRE);
+    u32 timers_drawn = 0;
+    for (u32 block = 1;
+         block < block_count && timers_drawn < DEBUG_OVERLAY_MAX_TIMERS;
+         block++) {
+        f64 total_ms = 0.0;
+        u32 depth = 0;
+        for (u32 i = 0; i < average_frames; i++) {
+            u32 index = completed - 1 - i;
+            ProfileFrame* frame = &profiler->frames[index % PROFILER_HISTORY];
+            ProfileBlockStats* stats = &frame->blocks[block];
+            total_ms += debug_overlay_block_ms(frame, stats->cycles);
+            if (stats->depth > depth) {
+                depth = stats->depth;
+            }
+        }
+        if (total_ms <= 0.0) {
+            continue;
+        }
+
+        f32 indent = (f32)depth * 2.0f;
+        f32 w = (f32)(total_ms / average_frames) * ms_to_width;
+        if (w > WIDTH - indent) {
+            w = WIDTH - indent;
+        }
+        debug_overlay_rect(
+            commands,
+            &rect_count,
+            X + indent,
+            y,
+            (w < 1.0f) ? 1.0f : w,
+            BAR_HEIGHT,
+            debug_overlay_block_color(block)
+        );
+        y += BAR_STEP;
+        timers_drawn++;
+    }
+
+    // Arenas: the last frame's high-water mark against what is committed,
+    // with a tick at the lifetime peak
+    y = Y + GRAPH_HEIGHT + 4.0f + (2 + DEBUG_OVERLAY_MAX_TIMERS) * BAR_STEP;
+    u32 arena_count = (last->arena_count < DEBUG_OVERLAY_MAX_ARENAS)
+                          ? last->arena_count
+                          : DEBUG_OVERLAY_MAX_ARENAS;
+    for (u32 i = 0; i < arena_count; i++) {
+        ProfileArenaStats* arena = &last->arenas[i];
+        if (arena->committed == 0) {
+            continue;
+        }
+        f32 scale = WIDTH / (f32)arena->committed;
+        u64 peak = arena->lifetime_peak_used;
+        if (peak > arena->committed) {
+            peak = arena->committed;
+        }
+        debug_overlay_rect(
+            commands,
+            &rect_count,
+            X,
+            y,
+            WIDTH,
+            BAR_HEIGHT,
+            0x404040FF
+        );
+        debug_overlay_rect(
+            commands,
+            &rect_count,
+            X,
+            y,
+            (f32)arena->peak_used * scale,
+            BAR_HEIGHT,
+            debug_overlay_block_color(i)
+        );
+        debug_overlay_rect(
+            commands,
+            &rect_count,
+            X + (f32)peak * scale - 1.0f,
+            y,
+            1.0f,
+            BAR_HEIGHT,
+            0xFFFFFFFF
+        );
+        y += BAR_STEP;
+    }
+}
+
+inline void debug_trace_write_string(FILE* file, const char* text) {
+    fputc('"', file);
+    for (const char* at = text; *at; at++) {
+        if (*at == '"' || *at == '\\') {
+            fputc('\\', file);
+        }
+        if ((u8)*at >= 0x20) {
+            fputc(*at, file);
+        }
+    }
+    fputc('"', file);
+}
+
+// Microseconds since the start of the capture
+inline f64 debug_trace_us(u64 clock, u64 base_clock, f64 us_per_clock) {
+    if (clock <= base_clock) {
+        return 0.0;
+    }
+    return (f64)(clock - base_clock) * us_per_clock;
+}
+
+// Render thread: write the last `frame_count` completed frames as a Chrome
+// trace. Frames show up as spans on their own track, and every thread's
+// begin/end events on a track per thread. Returns false if nothing could be
+// written.
+inline b32 debug_write_chrome_trace(
+    Profiler* profiler,
+    const char* path,
+    u32 frame_count
+) {
+    u32 completed = profiler->frame_count;
+    if (profiler->clocks_per_second == 0.0 || completed < 2) {
+        return false;
+    }
+
+    // Keep one completed frame before the first for its ring marks, and stay
+    // clear of the frame being collected
+    if (frame_count > PROFILER_HISTORY - 2) {
+        frame_count = PROFILER_HISTORY - 2;
+    }
+    if (frame_count > completed - 1) {
+        frame_count = completed - 1;
+    }
+    u32 first = completed - frame_count;
+    ProfileFrame* before = &profiler->frames[(first - 1) % PROFILER_HISTORY];
+    ProfileFrame* last = &profiler->frames[(completed - 1) % PROFILER_HISTORY];
+
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        return false;
+    }
+
+    u64 base_clock = before->end_clock;
+    f64 us_per_clock = 1000000.0 / profiler->clocks_per_second;
+
+    fprintf(file, "{\"traceEvents\":[\n");
+    fprintf(
+        file,
+        "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,"
+        "\"args\":{\"name\":\"frames\"}}"
+    );
+    for (u32 i = first; i < completed; i++) {
+        ProfileFrame* frame = &profiler->frames[i % PROFILER_HISTORY];
+        fprintf(
+            file,
+            ",\n{\"name\":\"frame %u\",\"ph\":\"X\",\"pid\":1,\"tid\":0,"
+            "\"ts\":%.3f,\"dur\":%.3f}",
+            i,
+            debug_trace_us(frame->begin_clock, base_clock, us_per_clock),
+            (f64)(frame->end_clock - frame->begin_clock) * us_per_clock
+        );
+    }
+
+    // Arena high-water marks as counter tracks, one sample per frame
+    char arena_names[PROFILER_MAX_ARENAS][PROFILER_NAME_LENGTH];
+    profiler_lock(profiler);
+    u32 arena_count = profiler->arena_count;
+    for (u32 i = 0; i < arena_count; i++) {
+        memcpy(arena_names[i], profiler->arenas[i].name, PROFILER_NAME_LENGTH);
+    }
+    profiler_unlock(profiler);
+    for (u32 i = first; i < completed; i++) {
+        ProfileFrame* frame = &profiler->frames[i % PROFILER_HISTORY];
+        for (u32 a = 0; a < frame->arena_count && a < arena_count; a++) {
+            fprintf(file, ",\n{\"name\":");
+            debug_trace_write_string(file, arena_names[a]);
+            fprintf(
+                file,
+                ",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,"
+                "\"args\":{\"peak\":%llu,\"committed\":%llu}}",
+                debug_trace_us(frame->begin_clock, base_clock, us_per_clock),
+                (unsigned long long)frame->arenas[a].peak_used,
+                (unsigned long long)frame->arenas[a].committed
+            );
+        }
+    }
+
+    for (u32 t = 0; t < last->thread_count; t++) {
+        ProfileThread* thread = &profiler->threads[t];
+        u32 begin = (t < before->thread_count) ? before->ring_end[t]
+                                               : last->ring_end[t] -
+                                                     PROFILER_RING_SIZE;
+        u32 end = last->ring_end[t];
+
+        // Writers keep going while we read. They can't get more than a
+        // couple of frames ahead of the render thread, so staying half a
+        // ring behind them keeps every event we read intact.
+        u32 write = __atomic_load_n(&thread->write, __ATOMIC_ACQUIRE);
+        if (write - begin > PROFILER_RING_SIZE / 2) {
+            begin = write - PROFILER_RING_SIZE / 2;
+        }
+        if ((i32)(end - begin) <= 0) {
+            continue;
+        }
+
+        fprintf(
+            file,
+            ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+            "\"args\":{\"name\":\"thread %u\"}}",
+            t + 1,
+            t
+        );
+
+        // Drop ends whose begins fell before the window, and close blocks
+        // still open at the end of it
+        u16 open[PROFILER_MAX_DEPTH];
+        u32 depth = 0;
+        u64 last_clock = base_clock;
+        for (u32 at = begin; at != end; at++) {
+            ProfileEvent* event =
+                &thread->events[at & (PROFILER_RING_SIZE - 1)];
+            if (event->type == ProfileEvent_Begin) {
+                if (depth == PROFILER_MAX_DEPTH) {
+                    continue;
+                }
+                open[depth++] = event->block;
+            } else if (depth == 0 || open[depth - 1] != event->block) {
+                continue;
+            } else {
+                depth--;
+            }
+
+            fprintf(file, ",\n{\"name\":");
+            debug_trace_write_string(file, profiler->blocks[event->block].name);
+            fprintf(
+                file,
+                ",\"ph\":\"%c\",\"pid\":1,\"tid\":%u,\"ts\":%.3f}",
+                (event->type == ProfileEvent_Begin) ? 'B' : 'E',
+                t + 1,
+                debug_trace_us(event->clock, base_clock, us_per_clock)
+            );
+            last_clock = event->clock;
+        }
+        while (depth > 0) {
+            depth--;
+            fprintf(
+                file,
+                ",\n{\"ph\":\"E\",\"pid\":1,\"tid\":%u,\"ts\":%.3f}",
+                t + 1,
+                debug_trace_us(last_clock, base_clock, us_per_clock)
+            );
+        }
+    }
+
+    fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+    b32 ok = ferror(file) == 0;
+    fclose(file);
+    return ok;
+}
+
+// Render thread, after profiler_end_frame: write a capture if one was asked
+// for. Files are named after the last frame they contain.
+inline void
+debug_overlay_capture_if_requested(DebugOverlay* overlay, Profiler* profiler) {
+    if (!debug_overlay_take_capture(overlay)) {
+        return;
+    }
+    char path[64];
+    snprintf(path, sizeof(path), "profile_%u.json", profiler->frame_count);
+    if (debug_write_chrome_trace(profiler, path, DEBUG_CAPTURE_FRAMES)) {
+        println("Wrote profiler capture to {}", path);
+    } else {
+        println("Failed to write profiler capture to {}", path);
+    }
+}
+
+// Print every reported arena's lifetime peak against its size, then the
+// push sites, for right-sizing memory. Sites are only tracked in builds with
+// ARENA_TRACK_SITES.
+inline void debug_print_arena_report(Profiler* profiler) {
+    profiler_lock(profiler);
+    ProfileFrame* last = profiler_last_frame(profiler);
+    println(
+        "{:<16} {:>8} {:>10} {:>10} {:>10}",
+        "Arena",
+        "peak KB",
+        "size KB",
+        "pushes",
+        "padding B"
+    );
+    for (u32 i = 0; i < profiler->arena_count; i++) {
+        ProfileArenaInfo* info = &profiler->arenas[i];
+        u64 size = 0;
+        if (last && i < last->arena_count) {
+            size = last->arenas[i].size;
+        }
+        println(
+            "{:<16} {:>8} {:>10} {:>10} {:>10}{}",
+            info->name,
+            info->peak_used / 1024,
+            size / 1024,
+            info->push_count,
+            info->padding_bytes,
+            (info->member_count > 1) ? " (fullest member)" : ""
+        );
+    }
+    if (profiler->arena_site_count > 0) {
+        println(
+            "{:<28} {:>8} {:>10} {:>10}  {}",
+            "Site",
+            "pushes",
+            "bytes",
+            "padding B",
+            "arena"
+        );
+        for (u32 i = 0; i < profiler->arena_site_count; i++) {
+            ProfileArenaSite* site = &profiler->arena_sites[i];
+            char name[ARENA_SITE_NAME_LENGTH + 16];
+            snprintf(name, sizeof(name), "%s:%u", site->file_name, site->line);
+            println(
+                "{:<28} {:>8} {:>10} {:>10}  {}",
+                name,
+                site->push_count,
+                site->bytes,
+                site->padding_bytes,
+                profiler->arenas[site->arena].name
+            );
+        }
+        if (profiler->arena_untracked_pushes > 0) {
+            println(
+                "{} pushes from sites past the tables",
+                profiler->arena_untracked_pushes
+            );
+        }
+    }
+    profiler_unlock(profiler);
+}
@@ -3,6 +3,7 @@
 #include "game_interface.h"
 #include "lib/def.h"
 #include "platform/file_watcher.h"
+#include "platform/job_queue.h"
 #include <cstdio>
 #include <print>
 
@@ -16,11 +17,16 @@ using std::println;
 #else
 #include <dlfcn.h>
 #include <fcntl.h>
+#include <pthread.h>
 #include <stdlib.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #ifdef __APPLE__
+#include <copyfile.h>
+#include <sys/clonefile.h>
 #define DLL_EXT ".dylib"
 #else
+#include <sys/sendfile.h>
 #define DLL_EXT ".so"
 #endif
 #endif
@@ -37,31 +43,77 @@ struct PlatformDLL {
     const char* temp_dll_base;
     char temp_dll_path[256];
     const char* lock_path;
-    FileTime last_write_time;
     b32 is_valid;
+
+    // File watcher ids for the library and the build's lock file; a change to
+    // either sets reload_pending
+    u32 dll_watch;
+    u32 lock_watch;
+    b32 reload_pending;
 };
 
-inline void platform_copy_file(const char* source, const char* dest) {
+// Copy a library for loading, keeping the copy's contents independent of
+// the source so a rebuild cannot touch a loaded image. The kernel does the
+// copying: copy_file_range (which reflinks where the file system can) or
+// sendfile on Linux, a clone or copyfile on macOS, CopyFile on Windows.
+// A hardlink would be cheaper but shares the inode, and linkers are free
+// to rewrite their output in place.
+inline b32 platform_copy_file(const char* source, const char* dest) {
 #ifdef _WIN32
-    CopyFileA(source, dest, FALSE);
+    return CopyFileA(source, dest, FALSE) != 0;
+#elif defined(__APPLE__)
+    unlink(dest);
+    if (clonefile(source, dest, 0) == 0) {
+        return true;
+    }
+    return copyfile(source, dest, nullptr, COPYFILE_DATA | COPYFILE_STAT) == 0;
 #else
-    char buffer[8192];
-    FILE* src = fopen(source, "rb");
-    if (!src) return;
-
-    FILE* dst = fopen(dest, "wb");
-    if (!dst) {
-        fclose(src);
-        return;
+    int src = open(source, O_RDONLY | O_CLOEXEC);
+    if (src < 0) {
+        return false;
+    }
+    struct stat src_stat;
+    if (fstat(src, &src_stat) != 0) {
+        close(src);
+        return false;
+    }
+    int dst = open(
+        dest,
+        O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+        src_stat.st_mode & 0777
+    );
+    if (dst < 0) {
+        close(src);
+        return false;
     }
 
-    usize bytes_read;
-    while ((bytes_read = fread(buffer, 1, sizeof(buffer), src)) > 0) {
-        fwrite(buffer, 1, bytes_read, dst);
+    off_t remaining = src_stat.st_size;
+    b32 use_sendfile = false;
+    while (remaining > 0) {
+        ssize_t copied = use_sendfile
+                             ? sendfile(dst, src, nullptr, (usize)remaining)
+                             : copy_file_range(
+                                   src,
+                                   nullptr,
+                                   dst,
+                                   nullptr,
+                                   (usize)remaining,
+                                   0
+                               );
+        if (copied < 0 && !use_sendfile && remaining == src_stat.st_size) {
+            // Not supported between these file systems
+            use_sendfile = true;
+            continue;
+        }
+        if (copied <= 0) {
+            break;
+        }
+        remaining -= copied;
     }
 
-    fclose(src);
-    fclose(dst);
+    close(src);
+    close(dst);
+    return remaining == 0;
 #endif
 }
 
@@ -94,6 +146,8 @@ inline PlatformDLL platform_load_game_code(
     result.dll_path = source_dll_path;
     result.temp_dll_base = temp_dll_base;
     result.lock_path = lock_path;
+    result.dll_watch = FILE_WATCHER_INVALID_ID;
+    result.lock_watch = FILE_WATCHER_INVALID_ID;
 
     if (platform_file_exists(lock_path)) {
         result.is_valid = false;
@@ -109,7 +163,11 @@ inline PlatformDLL platform_load_game_code(
         g_dll_load_counter++
     );
 
-    platform_copy_file(source_dll_path, result.temp_dll_path);
+    if (!platform_copy_file(source_dll_path, result.temp_dll_path)) {
+        println("Failed to copy game code to {}", result.temp_dll_path);
+        result.is_valid = false;
+        return result;
+    }
 
 #ifdef _WIN32
     result.handle = LoadLibraryA(result.temp_dll_path);
@@ -127,7 +185,6 @@ inline PlatformDLL platform_load_game_code(
     }
 #endif
 
-    result.last_write_time = platform_get_file_write_time(source_dll_path);
     result.is_valid = true;
     return result;
 }
@@ -175,15 +232,201 @@ inline GameCode platform_get_game_code(PlatformDLL* dll) {
     return result;
 }
 
+// Watch the library and its lock file. The lock is removed when a build
+// finishes, which retries a reload the lock held back.
+inline void platform_watch_game_code(PlatformDLL* dll, FileWatcher* watcher) {
+    dll->dll_watch = file_watcher_add(watcher, dll->dll_path);
+    dll->lock_watch = file_watcher_add(watcher, dll->lock_path);
+}
+
+// Note a change reported by the file watcher
+inline void platform_game_code_file_changed(PlatformDLL* dll, u32 watch_id) {
+    if (watch_id == dll->dll_watch || watch_id == dll->lock_watch) {
+        dll->reload_pending = true;
+    }
+}
+
+// Reloads run on a loader thread, so the frame loop never waits on the
+// copy or on the dynamic linker. The frame loop requests a load once a
+// change is pending; the loader copies and opens the library, resolving
+// every symbol up front, and marks it ready. The frame loop then swaps the
+// GameCode pointers at a frame boundary and hands the old library back to
+// be closed. One reload is in flight at a time; changes that land meanwhile
+// stay pending and are picked up after it.
+//
+// If the thread cannot be started, the same calls load and close inline.
+
+enum GameCodeLoaderState {
+    GameCodeLoaderState_Idle,
+    GameCodeLoaderState_Loading,  // Loader opening `prepared`
+    GameCodeLoaderState_Ready,    // `prepared` is open, waiting for the swap
+    GameCodeLoaderState_Retiring, // Loader closing `retired`
+};
+
+struct GameCodeLoader {
+    u32 state; // GameCodeLoaderState, accessed with __atomic builtins
+    u32 quit;
+    b32 running;
+    JobSemaphore wake;
+#ifdef _WIN32
+    HANDLE thread;
+#else
+    pthread_t thread;
+#endif
+
+    // Owned by whichever side the state names
+    PlatformDLL request;
+    PlatformDLL prepared;
+    GameCode prepared_code;
+    PlatformDLL retired;
+};
+
+// Loader thread, or the caller when there is none
+inline void game_code_loader_run(GameCodeLoader* loader) {
+    u32 state = __atomic_load_n(&loader->state, __ATOMIC_ACQUIRE);
+    if (state == GameCodeLoaderState_Loading) {
+        PlatformDLL dll = platform_load_game_code(
+            loader->request.dll_path,
+            loader->request.temp_dll_base,
+            loader->request.lock_path
+        );
+        GameCode code = platform_get_game_code(&dll);
+        if (code.is_valid) {
+            loader->prepared = dll;
+            loader->prepared_code = code;
+            state = GameCodeLoaderState_Ready;
+        } else {
+            platform_unload_game_code(&dll);
+            state = GameCodeLoaderState_Idle;
+        }
+        __atomic_store_n(&loader->state, state, __ATOMIC_RELEASE);
+    } else if (state == GameCodeLoaderState_Retiring) {
+        platform_unload_game_code(&loader->retired);
+        __atomic_store_n(
+            &loader->state,
+            (u32)GameCodeLoaderState_Idle,
+            __ATOMIC_RELEASE
+        );
+    }
+}
+
+#ifdef _WIN32
+inline DWORD WINAPI game_code_loader_thread_proc(LPVOID param) {
+#else
+inline void* game_code_loader_thread_proc(void* param) {
+#endif
+    GameCodeLoader* loader = (GameCodeLoader*)param;
+    for (;;) {
+        job_semaphore_wait(&loader->wake);
+        game_code_loader_run(loader);
+        if (__atomic_load_n(&loader->quit, __ATOMIC_ACQUIRE)) {
+            break;
+        }
+    }
+    return 0;
+}
+
+// Start the loader thread. Returns false if it could not be started, in
+// which case reloads happen inline.
+inline b32 game_code_loader_start(GameCodeLoader* loader) {
+    *loader = {};
+    job_semaphore_init(&loader->wake);
+#ifdef _WIN32
+    loader->thread =
+        CreateThread(NULL, 0, game_code_loader_thread_proc, loader, 0, NULL);
+    loader->running = loader->thread != NULL;
+#else
+    loader->running = pthread_create(
+                          &loader->thread,
+                          nullptr,
+                          game_code_loader_thread_proc,
+                          loader
+                      ) == 0;
+#endif
+    return loader->running;
+}
+
+// Let the loader finish what it is doing, stop it, and close a library that
+// was prepared or retired but not yet dealt with
+inline void game_code_loader_stop(GameCodeLoader* loader) {
+    if (loader->running) {
+        __atomic_store_n(&loader->quit, 1u, __ATOMIC_RELEASE);
+        job_semaphore_signal(&loader->wake);
+#ifdef _WIN32
+        WaitForSingleObject(loader->thread, INFINITE);
+        CloseHandle(loader->thread);
+#else
+        pthread_join(loader->thread, nullptr);
+#endif
+        loader->running = false;
+    }
+    u32 state = __atomic_load_n(&loader->state, __ATOMIC_ACQUIRE);
+    if (state == GameCodeLoaderState_Ready) {
+        platform_unload_game_code(&loader->prepared);
+    } else if (state == GameCodeLoaderState_Retiring) {
+        platform_unload_game_code(&loader->retired);
+    }
+    loader->state = GameCodeLoaderState_Idle;
+}
+
+// Frame loop: start loading the rebuilt library if a change is pending and
+// the loader is free. While the build still holds its lock nothing happens;
+// removing the lock posts another change.
 inline void
-platform_reload_game_code_if_changed(PlatformDLL* dll, GameCode* game_code) {
-    FileTime new_write_time = platform_get_file_write_time(dll->dll_path);
-    if (platform_file_time_changed(dll->last_write_time, new_write_time)) {
-        const char* dll_path = dll->dll_path;
-        const char* temp_base = dll->temp_dll_base;
-        const char* lock_path = dll->lock_path;
-        platform_unload_game_code(dll);
-        *dll = platform_load_game_code(dll_path, temp_base, lock_path);
-        *game_code = platform_get_game_code(dll);
+platform_request_game_code(GameCodeLoader* loader, PlatformDLL* dll) {
+    if (!dll->reload_pending ||
+        __atomic_load_n(&loader->state, __ATOMIC_ACQUIRE) !=
+            GameCodeLoaderState_Idle) {
+        return;
+    }
+    dll->reload_pending = false;
+    if (platform_file_exists(dll->lock_path)) {
+        return;
+    }
+    loader->request = *dll;
+    __atomic_store_n(
+        &loader->state,
+        (u32)GameCodeLoaderState_Loading,
+        __ATOMIC_RELEASE
+    );
+    if (loader->running) {
+        job_semaphore_signal(&loader->wake);
+    } else {
+        game_code_loader_run(loader);
+    }
+}
+
+// Frame loop: true once a requested library is open and can be swapped in
+inline b32 platform_game_code_ready(GameCodeLoader* loader) {
+    return __atomic_load_n(&loader->state, __ATOMIC_ACQUIRE) ==
+           GameCodeLoaderState_Ready;
+}
+
+// Frame loop, once ready: switch to the prepared library and hand the old
+// one to the loader. Nothing may still be running the old code, queued jobs
+// included.
+inline void platform_swap_game_code(
+    GameCodeLoader* loader,
+    PlatformDLL* dll,
+    GameCode* game_code
+) {
+    ASSERT(platform_game_code_ready(loader));
+    loader->retired = *dll;
+
+    *dll = loader->prepared;
+    dll->dll_watch = loader->retired.dll_watch;
+    dll->lock_watch = loader->retired.lock_watch;
+    dll->reload_pending = loader->retired.reload_pending;
+    *game_code = loader->prepared_code;
+
+    __atomic_store_n(
+        &loader->state,
+        (u32)GameCodeLoaderState_Retiring,
+        __ATOMIC_RELEASE
+    );
+    if (loader->running) {
+        job_semaphore_signal(&loader->wake);
+    } else {
+        game_code_loader_run(loader);
     }
 }
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "lib/def.h"
+
+// Read-only file mappings
+//
+// The file's pages are shared with the OS page cache, so reading from the
+// mapping costs no copy and no memory of our own; pages fault in on first
+// touch and can be dropped again under memory pressure. On POSIX the whole
+// mapping is requested to be read ahead, since everything we map gets read
+// in full.
+
+struct PlatformFileMap {
+    const u8* data;
+    usize size;
+#ifdef _WIN32
+    void* file;
+    void* mapping;
+#endif
+};
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+inline b32 platform_map_file(const char* path, PlatformFileMap* map) {
+    *map = {};
+    HANDLE file = CreateFileA(
+        path,
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr
+    );
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping =
+        CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        CloseHandle(file);
+        return false;
+    }
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!data) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    map->data = (const u8*)data;
+    map->size = (usize)size.QuadPart;
+    map->file = file;
+    map->mapping = mapping;
+    return true;
+}
+
+inline void platform_unmap_file(PlatformFileMap* map) {
+    if (map->data) {
+        UnmapViewOfFile(map->data);
+        CloseHandle(map->mapping);
+        CloseHandle(map->file);
+    }
+    *map = {};
+}
+
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+inline b32 platform_map_file(const char* path, PlatformFileMap* map) {
+    *map = {};
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    usize size = (usize)st.st_size;
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // The mapping keeps the file referenced on its own
+    close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    madvise(data, size, MADV_WILLNEED);
+
+    map->data = (const u8*)data;
+    map->size = size;
+    return true;
+}
+
+inline void platform_unmap_file(PlatformFileMap* map) {
+    if (map->data) {
+        munmap((void*)map->data, map->size);
+    }
+    *map = {};
+}
+
+#endif
@@ -1,14 +1,62 @@
 #pragma once
 
 #include "lib/def.h"
+#include <string.h>
+
+// File change notifications for hot reload.
+//
+// A FileWatcher keeps a fixed table of watched files. A background thread
+// waits on kernel notifications for their directories (inotify on Linux,
+// ReadDirectoryChangesW on Windows, FSEvents on macOS) and posts the ids of
+// files that changed, so the frame loop never touches the file system: it
+// drains the ids with file_watcher_poll, which is one atomic load when
+// nothing happened. Directories are watched rather than the files, because
+// builds often replace a file instead of rewriting it.
+//
+// Notifications are debounced. A file is only reported once it has been
+// quiet for FILE_WATCHER_DEBOUNCE_MS, and only if its write time (or whether
+// it exists) actually changed, so a build that writes in several steps posts
+// one event. A file whose id is still waiting to be drained is not queued
+// again.
+//
+// If the backend cannot start, file_watcher_poll falls back to checking the
+// table itself every FILE_WATCHER_POLL_INTERVAL_MS.
+//
+//   file_watcher_start(&watcher);
+//   u32 shader_watch = file_watcher_add(&watcher, "data/sprite.glsl");
+//   u32 id;
+//   while (file_watcher_poll(&watcher, &id)) { ... }
+//   file_watcher_stop(&watcher);
 
 #ifdef _WIN32
     #define WIN32_LEAN_AND_MEAN
     #include <windows.h>
 #else
+    #include <pthread.h>
     #include <sys/stat.h>
+    #include <time.h>
+    #include <unistd.h>
+    #ifdef __APPLE__
+        #include <CoreServices/CoreServices.h>
+        #include <limits.h>
+        #include <stdlib.h>
+    #else
+        #include <errno.h>
+        #include <poll.h>
+        #include <sys/eventfd.h>
+        #include <sys/inotify.h>
+    #endif
 #endif
 
+#define FILE_WATCHER_MAX_PATHS 64 // Must be a power of two
+#define FILE_WATCHER_MAX_DIRECTORIES 16
+#define FILE_WATCHER_PATH_SIZE 256
+#define FILE_WATCHER_DEBOUNCE_MS 50
+#define FILE_WATCHER_POLL_INTERVAL_MS 250
+#define FILE_WATCHER_INVALID_ID 0xFFFFFFFFu
+
+// Last write time: nanoseconds on POSIX, 100 ns ticks on Windows, zero if the
+// file does not exist. Only ever compared.
 struct FileTime {
     u64 value;
 };
@@ -26,7 +74,12 @@ inline FileTime platform_get_file_write_time(const char* filename) {
 #else
     struct stat file_stat;
     if (stat(filename, &file_stat) == 0) {
-        result.value = file_stat.st_mtime;
+    #ifdef __APPLE__
+        struct timespec time = file_stat.st_mtimespec;
+    #else
+        struct timespec time = file_stat.st_mtim;
+    #endif
+        result.value = (u64)time.tv_sec * 1000000000ull + (u64)time.tv_nsec;
     }
 #endif
     return result;
@@ -35,3 +88,687 @@ inline FileTime platform_get_file_write_time(const char* filename) {
 inline b32 platform_file_time_changed(FileTime old_time, FileTime new_time) {
     return old_time.value != new_time.value;
 }
+
+struct FileWatch {
+    char path[FILE_WATCHER_PATH_SIZE];
+    const char* name; // File name within path
+    u32 directory;
+    FileTime write_time;
+    u64 deadline_ms; // Debounce deadline, zero while quiet
+    u32 queued;      // Set while the id is in the event ring
+};
+
+struct FileWatchDirectory {
+    char path[FILE_WATCHER_PATH_SIZE]; // Resolved on macOS to match FSEvents
+#ifdef _WIN32
+    HANDLE handle;
+    OVERLAPPED overlapped;
+    b32 armed; // Watcher thread only
+    DWORD buffer[1024];
+#elif !defined(__APPLE__)
+    int descriptor;
+#endif
+};
+
+struct FileWatcher {
+    u32 lock; // Guards the tables and posting
+    u32 watch_count;
+    u32 directory_count;
+    FileWatch watches[FILE_WATCHER_MAX_PATHS];
+    FileWatchDirectory directories[FILE_WATCHER_MAX_DIRECTORIES];
+
+    // Ring of changed watch ids. Monotonic counters; each watch is in the
+    // ring at most once, so it never overflows.
+    u32 events[FILE_WATCHER_MAX_PATHS];
+    u32 event_write;
+    u32 event_read; // Polling thread only
+
+    b32 running;      // Backend thread is up
+    u64 next_poll_ms; // Polling fallback only
+    u32 quit;
+#ifdef _WIN32
+    HANDLE thread;
+    HANDLE wake;
+#elif defined(__APPLE__)
+    pthread_t thread;
+    CFRunLoopRef run_loop;
+    CFRunLoopTimerRef timer;
+    FSEventStreamRef stream;
+    u32 dirty; // Directories changed, recreate the stream
+#else
+    pthread_t thread;
+    int inotify;
+    int wake;
+#endif
+};
+
+inline u64 file_watcher_now_ms() {
+#ifdef _WIN32
+    return (u64)GetTickCount64();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000ull + (u64)ts.tv_nsec / 1000000ull;
+#endif
+}
+
+inline void file_watcher_lock(FileWatcher* watcher) {
+    while (__atomic_exchange_n(&watcher->lock, 1u, __ATOMIC_ACQUIRE)) {
+    }
+}
+
+inline void file_watcher_unlock(FileWatcher* watcher) {
+    __atomic_store_n(&watcher->lock, 0u, __ATOMIC_RELEASE);
+}
+
+inline b32 file_watcher_names_match(const char* a, const char* b) {
+#ifdef _WIN32
+    return lstrcmpiA(a, b) == 0;
+#else
+    return strcmp(a, b) == 0;
+#endif
+}
+
+// Restart the debounce of the watches in a directory: the one called `name`,
+// or all of them if it is null (the backend lost events). Lock held.
+inline void file_watcher_touch(
+    FileWatcher* watcher,
+    u32 directory,
+    const char* name,
+    u64 deadline_ms
+) {
+    for (u32 i = 0; i < watcher->watch_count; i++) {
+        FileWatch* watch = &watcher->watches[i];
+        if (watch->directory == directory &&
+            (!name || file_watcher_names_match(watch->name, name))) {
+            watch->deadline_ms = deadline_ms;
+        }
+    }
+}
+
+// Post every watch whose debounce has run out and whose write time changed.
+// Returns the milliseconds until the next deadline, or -1 if none is pending.
+inline i32 file_watcher_flush(FileWatcher* watcher, u64 now_ms) {
+    i32 timeout = -1;
+    file_watcher_lock(watcher);
+    for (u32 i = 0; i < watcher->watch_count; i++) {
+        FileWatch* watch = &watcher->watches[i];
+        if (watch->deadline_ms == 0) {
+            continue;
+        }
+        if (watch->deadline_ms > now_ms) {
+            i32 remaining = (i32)(watch->deadline_ms - now_ms);
+            if (timeout < 0 || remaining < timeout) {
+                timeout = remaining;
+            }
+            continue;
+        }
+        watch->deadline_ms = 0;
+
+        FileTime write_time = platform_get_file_write_time(watch->path);
+        if (!platform_file_time_changed(watch->write_time, write_time)) {
+            continue;
+        }
+        watch->write_time = write_time;
+        if (!__atomic_exchange_n(&watch->queued, 1u, __ATOMIC_ACQUIRE)) {
+            u32 write = watcher->event_write;
+            watcher->events[write & (FILE_WATCHER_MAX_PATHS - 1)] = i;
+            __atomic_store_n(
+                &watcher->event_write,
+                write + 1,
+                __ATOMIC_RELEASE
+            );
+        }
+    }
+    file_watcher_unlock(watcher);
+    return timeout;
+}
+
+#ifdef _WIN32
+
+inline DWORD WINAPI file_watcher_thread_proc(LPVOID param) {
+    FileWatcher* watcher = (FileWatcher*)param;
+    const DWORD filter = FILE_NOTIFY_CHANGE_FILE_NAME |
+                         FILE_NOTIFY_CHANGE_LAST_WRITE |
+                         FILE_NOTIFY_CHANGE_SIZE;
+    while (!__atomic_load_n(&watcher->quit, __ATOMIC_ACQUIRE)) {
+        // Arm directories added since the last pass; the read has to be
+        // issued here, since it is cancelled if its thread exits
+        HANDLE handles[FILE_WATCHER_MAX_DIRECTORIES + 1];
+        u32 owners[FILE_WATCHER_MAX_DIRECTORIES];
+        u32 handle_count = 0;
+        handles[handle_count++] = watcher->wake;
+        file_watcher_lock(watcher);
+        for (u32 i = 0; i < watcher->directory_count; i++) {
+            FileWatchDirectory* directory = &watcher->directories[i];
+            if (!directory->armed) {
+                directory->armed = ReadDirectoryChangesW(
+                    directory->handle,
+                    directory->buffer,
+                    sizeof(directory->buffer),
+                    FALSE,
+                    filter,
+                    NULL,
+                    &directory->overlapped,
+                    NULL
+                );
+            }
+            if (directory->armed) {
+                owners[handle_count - 1] = i;
+                handles[handle_count++] = directory->overlapped.hEvent;
+            }
+        }
+        file_watcher_unlock(watcher);
+
+        i32 timeout = file_watcher_flush(watcher, file_watcher_now_ms());
+        DWORD result = WaitForMultipleObjects(
+            handle_count,
+            handles,
+            FALSE,
+            timeout < 0 ? INFINITE : (DWORD)timeout
+        );
+        if (result <= WAIT_OBJECT_0 || result >= WAIT_OBJECT_0 + handle_count) {
+            continue;
+        }
+
+        u32 index = owners[result - WAIT_OBJECT_0 - 1];
+        FileWatchDirectory* directory = &watcher->directories[index];
+        DWORD size = 0;
+        BOOL ok = GetOverlappedResult(
+            directory->handle,
+            &directory->overlapped,
+            &size,
+            FALSE
+        );
+        directory->armed = false;
+
+        u64 deadline_ms = file_watcher_now_ms() + FILE_WATCHER_DEBOUNCE_MS;
+        file_watcher_lock(watcher);
+        if (!ok || size == 0) {
+            // The buffer overflowed
+            file_watcher_touch(watcher, index, nullptr, deadline_ms);
+        } else {
+            u8* at = (u8*)directory->buffer;
+            for (;;) {
+                FILE_NOTIFY_INFORMATION* info = (FILE_NOTIFY_INFORMATION*)at;
+                char name[FILE_WATCHER_PATH_SIZE];
+                i32 length = WideCharToMultiByte(
+                    CP_UTF8,
+                    0,
+                    info->FileName,
+                    (i32)(info->FileNameLength / sizeof(WCHAR)),
+                    name,
+                    sizeof(name) - 1,
+                    NULL,
+                    NULL
+                );
+                if (length > 0) {
+                    name[length] = '\0';
+                    file_watcher_touch(watcher, index, name, deadline_ms);
+                }
+                if (info->NextEntryOffset == 0) {
+                    break;
+                }
+                at += info->NextEntryOffset;
+            }
+        }
+        file_watcher_unlock(watcher);
+    }
+
+    // Reads are cancelled per issuing thread, so do it on the way out
+    for (u32 i = 0; i < watcher->directory_count; i++) {
+        FileWatchDirectory* directory = &watcher->directories[i];
+        if (directory->armed) {
+            DWORD size;
+            CancelIo(directory->handle);
+            GetOverlappedResult(
+                directory->handle,
+                &directory->overlapped,
+                &size,
+                TRUE
+            );
+            directory->armed = false;
+        }
+    }
+    return 0;
+}
+
+#elif defined(__APPLE__)
+
+// Flush, then aim the timer at the next debounce deadline. Watcher thread.
+inline void file_watcher_schedule(FileWatcher* watcher) {
+    i32 timeout = file_watcher_flush(watcher, file_watcher_now_ms());
+    CFAbsoluteTime fire_date = timeout < 0
+                                   ? CFAbsoluteTimeGetCurrent() + 1.0e9
+                                   : CFAbsoluteTimeGetCurrent() +
+                                         (f64)timeout / 1000.0;
+    CFRunLoopTimerSetNextFireDate(watcher->timer, fire_date);
+}
+
+inline void file_watcher_timer_callback(CFRunLoopTimerRef, void* info) {
+    file_watcher_schedule((FileWatcher*)info);
+}
+
+inline void file_watcher_stream_callback(
+    ConstFSEventStreamRef,
+    void* info,
+    size_t event_count,
+    void* event_paths,
+    const FSEventStreamEventFlags* event_flags,
+    const FSEventStreamEventId*
+) {
+    FileWatcher* watcher = (FileWatcher*)info;
+    char** paths = (char**)event_paths;
+    const FSEventStreamEventFlags lost =
+        kFSEventStreamEventFlagMustScanSubDirs |
+        kFSEventStreamEventFlagRootChanged;
+    u64 deadline_ms = file_watcher_now_ms() + FILE_WATCHER_DEBOUNCE_MS;
+
+    file_watcher_lock(watcher);
+    for (size_t i = 0; i < event_count; i++) {
+        const char* path = paths[i];
+        const char* name = strrchr(path, '/');
+        if (!name) {
+            continue;
+        }
+        usize directory_length = (usize)(name - path);
+        name++;
+        for (u32 j = 0; j < watcher->directory_count; j++) {
+            const char* directory = watcher->directories[j].path;
+            if (event_flags[i] & lost) {
+                file_watcher_touch(watcher, j, nullptr, deadline_ms);
+            } else if (strlen(directory) == directory_length &&
+                       memcmp(directory, path, directory_length) == 0) {
+                file_watcher_touch(watcher, j, name, deadline_ms);
+            }
+        }
+    }
+    file_watcher_unlock(watcher);
+
+    file_watcher_schedule(watcher);
+}
+
+// Replace the event stream with one covering every directory. Watcher thread.
+inline void file_watcher_restart_stream(FileWatcher* watcher) {
+    if (watcher->stream) {
+        FSEventStreamStop(watcher->stream);
+        FSEventStreamInvalidate(watcher->stream);
+        FSEventStreamRelease(watcher->stream);
+        watcher->stream = nullptr;
+    }
+
+    CFStringRef paths[FILE_WATCHER_MAX_DIRECTORIES];
+    file_watcher_lock(watcher);
+    u32 path_count = watcher->directory_count;
+    for (u32 i = 0; i < path_count; i++) {
+        paths[i] = CFStringCreateWithCString(
+            NULL,
+            watcher->directories[i].path,
+            kCFStringEncodingUTF8
+        );
+    }
+    file_watcher_unlock(watcher);
+    if (path_count == 0) {
+        return;
+    }
+
+    CFArrayRef path_array = CFArrayCreate(
+        NULL,
+        (const void**)paths,
+        path_count,
+        &kCFTypeArrayCallBacks
+    );
+    FSEventStreamContext context = {0, watcher, NULL, NULL, NULL};
+    watcher->stream = FSEventStreamCreate(
+        NULL,
+        file_watcher_stream_callback,
+        &context,
+        path_array,
+        kFSEventStreamEventIdSinceNow,
+        0.01,
+        kFSEventStreamCreateFlagFileEvents | kFSEventStreamCreateFlagNoDefer
+    );
+    CFRelease(path_array);
+    for (u32 i = 0; i < path_count; i++) {
+        CFRelease(paths[i]);
+    }
+
+    if (watcher->stream) {
+        FSEventStreamScheduleWithRunLoop(
+            watcher->stream,
+            CFRunLoopGetCurrent(),
+            kCFRunLoopDefaultMode
+        );
+        FSEventStreamStart(watcher->stream);
+    }
+}
+
+inline void* file_watcher_thread_proc(void* param) {
+    FileWatcher* watcher = (FileWatcher*)param;
+    CFRunLoopRef run_loop = CFRunLoopGetCurrent();
+
+    // Debounce timer; it also keeps the run loop alive with no stream
+    CFRunLoopTimerContext context = {0, watcher, NULL, NULL, NULL};
+    watcher->timer = CFRunLoopTimerCreate(
+        NULL,
+        CFAbsoluteTimeGetCurrent() + 1.0e9,
+        1.0e9,
+        0,
+        0,
+        file_watcher_timer_callback,
+        &context
+    );
+    CFRunLoopAddTimer(run_loop, watcher->timer, kCFRunLoopDefaultMode);
+
+    // Adds and stop flag first, then stop the run loop. A stop that lands
+    // before CFRunLoopRun makes it return at once, so none is lost.
+    __atomic_store_n(&watcher->run_loop, run_loop, __ATOMIC_SEQ_CST);
+    while (!__atomic_load_n(&watcher->quit, __ATOMIC_SEQ_CST)) {
+        if (__atomic_exchange_n(&watcher->dirty, 0u, __ATOMIC_SEQ_CST)) {
+            file_watcher_restart_stream(watcher);
+        }
+        CFRunLoopRun();
+    }
+
+    if (watcher->stream) {
+        FSEventStreamStop(watcher->stream);
+        FSEventStreamInvalidate(watcher->stream);
+        FSEventStreamRelease(watcher->stream);
+        watcher->stream = nullptr;
+    }
+    CFRunLoopTimerInvalidate(watcher->timer);
+    CFRelease(watcher->timer);
+    return nullptr;
+}
+
+// Make the watcher thread look at its flags
+inline void file_watcher_wake(FileWatcher* watcher) {
+    CFRunLoopRef run_loop =
+        __atomic_load_n(&watcher->run_loop, __ATOMIC_SEQ_CST);
+    if (run_loop) {
+        CFRunLoopStop(run_loop);
+    }
+}
+
+#else
+
+inline void* file_watcher_thread_proc(void* param) {
+    FileWatcher* watcher = (FileWatcher*)param;
+    alignas(struct inotify_event) char buffer[4096];
+    for (;;) {
+        i32 timeout = file_watcher_flush(watcher, file_watcher_now_ms());
+        struct pollfd fds[2] = {
+            {watcher->inotify, POLLIN, 0},
+            {watcher->wake, POLLIN, 0},
+        };
+        if (poll(fds, 2, timeout) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (fds[1].revents) {
+            break;
+        }
+        if (!(fds[0].revents & POLLIN)) {
+            continue;
+        }
+
+        ssize_t size = read(watcher->inotify, buffer, sizeof(buffer));
+        if (size <= 0) {
+            continue;
+        }
+        u64 deadline_ms = file_watcher_now_ms() + FILE_WATCHER_DEBOUNCE_MS;
+        file_watcher_lock(watcher);
+        for (char* at = buffer; at < buffer + size;) {
+            struct inotify_event* event = (struct inotify_event*)at;
+            at += sizeof(struct inotify_event) + event->len;
+            b32 lost = (event->mask & IN_Q_OVERFLOW) != 0;
+            if (!lost && event->len == 0) {
+                continue;
+            }
+            for (u32 i = 0; i < watcher->directory_count; i++) {
+                if (lost) {
+                    file_watcher_touch(watcher, i, nullptr, deadline_ms);
+                } else if (watcher->directories[i].descriptor == event->wd) {
+                    file_watcher_touch(watcher, i, event->name, deadline_ms);
+                }
+            }
+        }
+        file_watcher_unlock(watcher);
+    }
+    return nullptr;
+}
+
+#endif
+
+// Start the notification thread. Returns false if the backend is not
+// available, in which case file_watcher_poll checks the table itself.
+inline b32 file_watcher_start(FileWatcher* watcher) {
+    memset(watcher, 0, sizeof(*watcher));
+#ifdef _WIN32
+    watcher->wake = CreateEventA(NULL, FALSE, FALSE, NULL);
+    if (!watcher->wake) {
+        return false;
+    }
+    watcher->thread =
+        CreateThread(NULL, 0, file_watcher_thread_proc, watcher, 0, NULL);
+    if (!watcher->thread) {
+        CloseHandle(watcher->wake);
+        return false;
+    }
+#elif defined(__APPLE__)
+    if (pthread_create(
+            &watcher->thread,
+            nullptr,
+            file_watcher_thread_proc,
+            watcher
+        ) != 0) {
+        return false;
+    }
+#else
+    watcher->inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watcher->inotify < 0) {
+        return false;
+    }
+    watcher->wake = eventfd(0, EFD_CLOEXEC);
+    if (watcher->wake < 0) {
+        close(watcher->inotify);
+        return false;
+    }
+    if (pthread_create(
+            &watcher->thread,
+            nullptr,
+            file_watcher_thread_proc,
+            watcher
+        ) != 0) {
+        close(watcher->inotify);
+        close(watcher->wake);
+        return false;
+    }
+#endif
+    watcher->running = true;
+    return true;
+}
+
+// Open a directory with the backend. Lock held.
+inline b32 file_watcher_open_directory(
+    FileWatcher* watcher,
+    FileWatchDirectory* directory
+) {
+    if (!watcher->running) {
+        return true;
+    }
+#ifdef _WIN32
+    directory->handle = CreateFileA(
+        directory->path,
+        FILE_LIST_DIRECTORY,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        NULL,
+        OPEN_EXISTING,
+        FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
+        NULL
+    );
+    if (directory->handle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    directory->overlapped.hEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+    if (!directory->overlapped.hEvent) {
+        CloseHandle(directory->handle);
+        return false;
+    }
+    return true;
+#elif defined(__APPLE__)
+    (void)directory;
+    return true;
+#else
+    directory->descriptor = inotify_add_watch(
+        watcher->inotify,
+        directory->path,
+        IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_FROM |
+            IN_MOVED_TO | IN_ATTRIB
+    );
+    return directory->descriptor >= 0;
+#endif
+}
+
+// Watch `path`, which need not exist yet but whose directory must. Returns
+// the id that file_watcher_poll reports, or FILE_WATCHER_INVALID_ID if the
+// tables are full or the directory cannot be watched.
+inline u32 file_watcher_add(FileWatcher* watcher, const char* path) {
+    usize length = strlen(path);
+    if (length >= FILE_WATCHER_PATH_SIZE) {
+        return FILE_WATCHER_INVALID_ID;
+    }
+    usize split = length;
+    while (split > 0 && path[split - 1] != '/'
+#ifdef _WIN32
+           && path[split - 1] != '\\'
+#endif
+    ) {
+        split--;
+    }
+
+    char directory_path[FILE_WATCHER_PATH_SIZE];
+    if (split == 0) {
+        strcpy(directory_path, ".");
+    } else {
+        usize directory_length = split > 1 ? split - 1 : split;
+        memcpy(directory_path, path, directory_length);
+        directory_path[directory_length] = '\0';
+    }
+#ifdef __APPLE__
+    char resolved[PATH_MAX];
+    if (!realpath(directory_path, resolved) ||
+        strlen(resolved) >= FILE_WATCHER_PATH_SIZE) {
+        return FILE_WATCHER_INVALID_ID;
+    }
+    strcpy(directory_path, resolved);
+#endif
+
+    file_watcher_lock(watcher);
+    if (watcher->watch_count == FILE_WATCHER_MAX_PATHS) {
+        file_watcher_unlock(watcher);
+        return FILE_WATCHER_INVALID_ID;
+    }
+    u32 directory_index = 0;
+    while (directory_index < watcher->directory_count &&
+           strcmp(
+               watcher->directories[directory_index].path,
+               directory_path
+           ) != 0) {
+        directory_index++;
+    }
+    b32 new_directory = directory_index == watcher->directory_count;
+    if (new_directory) {
+        if (watcher->directory_count == FILE_WATCHER_MAX_DIRECTORIES) {
+            file_watcher_unlock(watcher);
+            return FILE_WATCHER_INVALID_ID;
+        }
+        FileWatchDirectory* directory =
+            &watcher->directories[directory_index];
+        strcpy(directory->path, directory_path);
+        if (!file_watcher_open_directory(watcher, directory)) {
+            file_watcher_unlock(watcher);
+            return FILE_WATCHER_INVALID_ID;
+        }
+        watcher->directory_count++;
+    }
+
+    u32 id = watcher->watch_count;
+    FileWatch* watch = &watcher->watches[id];
+    memcpy(watch->path, path, length + 1);
+    watch->name = watch->path + split;
+    watch->directory = directory_index;
+    watch->write_time = platform_get_file_write_time(path);
+    watch->deadline_ms = 0;
+    watch->queued = 0;
+    watcher->watch_count++;
+    file_watcher_unlock(watcher);
+
+    if (new_directory && watcher->running) {
+#ifdef _WIN32
+        SetEvent(watcher->wake);
+#elif defined(__APPLE__)
+        __atomic_store_n(&watcher->dirty, 1u, __ATOMIC_SEQ_CST);
+        file_watcher_wake(watcher);
+#endif
+    }
+    return id;
+}
+
+// Take the next changed watch id. Call from one thread, typically once per
+// frame until it returns false.
+inline b32 file_watcher_poll(FileWatcher* watcher, u32* id) {
+    if (!watcher->running) {
+        u64 now_ms = file_watcher_now_ms();
+        if (now_ms >= watcher->next_poll_ms) {
+            watcher->next_poll_ms = now_ms + FILE_WATCHER_POLL_INTERVAL_MS;
+            file_watcher_lock(watcher);
+            for (u32 i = 0; i < watcher->directory_count; i++) {
+                file_watcher_touch(watcher, i, nullptr, now_ms);
+            }
+            file_watcher_unlock(watcher);
+            file_watcher_flush(watcher, now_ms);
+        }
+    }
+
+    u32 read = watcher->event_read;
+    if (read == __atomic_load_n(&watcher->event_write, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+    u32 watch_id = watcher->events[read & (FILE_WATCHER_MAX_PATHS - 1)];
+    watcher->event_read = read + 1;
+    __atomic_store_n(&watcher->watches[watch_id].queued, 0u, __ATOMIC_RELEASE);
+    *id = watch_id;
+    return true;
+}
+
+// Stop the notification thread and close the directories
+inline void file_watcher_stop(FileWatcher* watcher) {
+    if (!watcher->running) {
+        return;
+    }
+    __atomic_store_n(&watcher->quit, 1u, __ATOMIC_SEQ_CST);
+#ifdef _WIN32
+    SetEvent(watcher->wake);
+    WaitForSingleObject(watcher->thread, INFINITE);
+    CloseHandle(watcher->thread);
+    CloseHandle(watcher->wake);
+    for (u32 i = 0; i < watcher->directory_count; i++) {
+        CloseHandle(watcher->directories[i].overlapped.hEvent);
+        CloseHandle(watcher->directories[i].handle);
+    }
+#elif defined(__APPLE__)
+    file_watcher_wake(watcher);
+    pthread_join(watcher->thread, nullptr);
+#else
+    u64 value = 1;
+    ssize_t written = write(watcher->wake, &value, sizeof(value));
+    (void)written;
+    pthread_join(watcher->thread, nullptr);
+    close(watcher->inotify);
+    close(watcher->wake);
+#endif
+    watcher->running = false;
+}
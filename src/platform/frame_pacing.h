@@ -0,0 +1,124 @@
+#pragma once
+
+#include "lib/def.h"
+
+// Fixed-timestep frame pacing shared by the platform loops.
+//
+// Wall-clock time is accumulated and handed to the game as a whole number of
+// fixed simulation ticks plus an interpolation alpha for rendering between
+// the last two ticks. When the game falls behind, up to FRAME_PACER_MAX_TICKS
+// ticks run per frame and the rest of the backlog is dropped, so a stall
+// slows the game down instead of snowballing.
+//
+// Frame rate is capped either by vsync or, with a target frame time, by
+// sleeping: the OS sleep covers all but the last FRAME_PACER_SPIN_MARGIN
+// seconds, and the remainder is spent yielding, which keeps the wake-up
+// accurate without spinning a core for the whole frame.
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <mmsystem.h>
+#else
+#include <sched.h>
+#include <time.h>
+#endif
+
+#define FRAME_PACER_MAX_TICKS 8
+#define FRAME_PACER_SPIN_MARGIN 0.002
+
+struct FramePacer {
+    f64 tick_seconds;
+    f64 accumulator;
+    f64 last_time;
+    f64 target_frame_seconds; // 0 = uncapped (e.g. vsync does the pacing)
+    f64 next_frame_time;
+};
+
+inline void platform_sleep_seconds(f64 seconds) {
+    if (seconds <= 0.0) {
+        return;
+    }
+#ifdef _WIN32
+    Sleep((DWORD)(seconds * 1000.0));
+#else
+    struct timespec ts;
+    ts.tv_sec = (time_t)seconds;
+    ts.tv_nsec = (long)((seconds - (f64)ts.tv_sec) * 1000000000.0);
+    nanosleep(&ts, nullptr);
+#endif
+}
+
+inline void platform_yield() {
+#ifdef _WIN32
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+// Ask the OS for 1 ms scheduler granularity so short sleeps are honored.
+// Only Windows needs this; elsewhere it is a no-op.
+inline void platform_request_fine_sleep() {
+#ifdef _WIN32
+    timeBeginPeriod(1);
+#endif
+}
+
+inline void frame_pacer_init(
+    FramePacer* pacer,
+    f64 ticks_per_second,
+    f64 target_fps,
+    f64 now
+) {
+    *pacer = {};
+    pacer->tick_seconds = 1.0 / ticks_per_second;
+    pacer->target_frame_seconds = (target_fps > 0.0) ? 1.0 / target_fps : 0.0;
+    pacer->last_time = now;
+    pacer->next_frame_time = now;
+}
+
+// Consume elapsed time. Returns how many fixed ticks to simulate this frame
+// and stores how far the frame is between the last tick and the next one.
+inline u32 frame_pacer_advance(FramePacer* pacer, f64 now, f32* alpha) {
+    pacer->accumulator += now - pacer->last_time;
+    pacer->last_time = now;
+
+    u32 ticks = 0;
+    while (pacer->accumulator >= pacer->tick_seconds &&
+           ticks < FRAME_PACER_MAX_TICKS) {
+        pacer->accumulator -= pacer->tick_seconds;
+        ticks++;
+    }
+    if (pacer->accumulator >= pacer->tick_seconds) {
+        // Too far behind to catch up; drop the backlog
+        pacer->accumulator = 0.0;
+    }
+
+    *alpha = (f32)(pacer->accumulator / pacer->tick_seconds);
+    return ticks;
+}
+
+// Block until the next frame is due. Does nothing when uncapped.
+// get_time is the platform's high resolution clock in seconds.
+inline void frame_pacer_wait(FramePacer* pacer, f64 (*get_time)()) {
+    if (pacer->target_frame_seconds <= 0.0) {
+        return;
+    }
+
+    pacer->next_frame_time += pacer->target_frame_seconds;
+    f64 now = get_time();
+    if (now >= pacer->next_frame_time) {
+        // Missed the deadline; start the next frame from now rather than
+        // rushing to catch up
+        pacer->next_frame_time = now;
+        return;
+    }
+
+    platform_sleep_seconds(
+        pacer->next_frame_time - now - FRAME_PACER_SPIN_MARGIN
+    );
+    while (get_time() < pacer->next_frame_time) {
+        platform_yield();
+    }
+}
@@ -0,0 +1,221 @@
+#pragma once
+
+#include "game_interface.h"
+#include "lib/def.h"
+#include "platform/job_queue.h"
+#include "platform/memory.h"
+#include "platform/render_commands.h"
+
+// Two-slot frame pipeline between the game thread and a render thread.
+//
+// The game thread records frame N+1 into one slot while the render thread
+// replays frame N from the other. Hand-off is a bounded two-slot ring: the
+// game waits for a retired slot before recording, the render thread waits for
+// a published one before replaying. Each side only ever touches the slot it
+// currently holds, so the frames themselves need no locking.
+//
+// In lockstep mode no thread is started and submit renders the frame inline,
+// which is the old single-threaded loop, for debugging.
+
+#define FRAME_PIPELINE_SLOTS 2
+
+// Address space reserved for each slot's command arena. Pages are committed
+// as a frame first needs them and kept, so this is a ceiling, not a cost.
+#define FRAME_PIPELINE_COMMAND_RESERVE_SIZE MB(256)
+
+// Everything the render side needs to present one frame
+struct PipelineFrame {
+    RenderCommands commands;
+    u32 window_width;
+    u32 window_height;
+};
+
+#define PIPELINE_RENDER(name) void name(PipelineFrame* frame, void* user_data)
+typedef PIPELINE_RENDER(pipeline_render_func);
+
+// Called on the render thread with bind = true before the first frame and
+// bind = false before it exits, to make the GL context current there and
+// release it again
+#define PIPELINE_BIND_CONTEXT(name) void name(void* user_data, b32 bind)
+typedef PIPELINE_BIND_CONTEXT(pipeline_bind_context_func);
+
+struct FramePipeline {
+    PipelineFrame frames[FRAME_PIPELINE_SLOTS];
+    b32 lockstep;
+
+    pipeline_render_func* render;
+    pipeline_bind_context_func* bind_context;
+    void* user_data;
+
+    // Game side
+    u32 record_index;
+
+    // Render side
+    u32 replay_index;
+    b32 quit; // Accessed with __atomic builtins
+
+    JobSemaphore published; // Frames ready to replay
+    JobSemaphore retired;   // Slots free to record into
+
+#ifdef _WIN32
+    HANDLE thread;
+#else
+    pthread_t thread;
+#endif
+};
+
+// Render thread: replay published frames until asked to quit
+#ifdef _WIN32
+inline DWORD WINAPI frame_pipeline_thread_proc(LPVOID param) {
+#else
+inline void* frame_pipeline_thread_proc(void* param) {
+#endif
+    FramePipeline* pipeline = (FramePipeline*)param;
+    if (pipeline->bind_context) {
+        pipeline->bind_context(pipeline->user_data, true);
+    }
+
+    for (;;) {
+        job_semaphore_wait(&pipeline->published);
+        if (__atomic_load_n(&pipeline->quit, __ATOMIC_ACQUIRE)) {
+            break;
+        }
+
+        PipelineFrame* frame = &pipeline->frames[pipeline->replay_index];
+        pipeline->render(frame, pipeline->user_data);
+        pipeline->replay_index =
+            (pipeline->replay_index + 1) % FRAME_PIPELINE_SLOTS;
+        job_semaphore_signal(&pipeline->retired);
+    }
+
+    if (pipeline->bind_context) {
+        pipeline->bind_context(pipeline->user_data, false);
+    }
+#ifdef _WIN32
+    return 0;
+#else
+    return nullptr;
+#endif
+}
+
+// Reserve FRAME_PIPELINE_SLOTS command arenas for frame_pipeline_start.
+// Returns false if the address space is not available.
+inline b32 frame_pipeline_reserve_arenas(MemoryArena* arenas) {
+    for (u32 i = 0; i < FRAME_PIPELINE_SLOTS; i++) {
+        if (!platform_reserve_arena(
+                &arenas[i],
+                FRAME_PIPELINE_COMMAND_RESERVE_SIZE
+            )) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Hand the slots their command arenas (FRAME_PIPELINE_SLOTS of them) and
+// start the render thread. When not in lockstep the caller must
+// release its GL context first; bind_context picks it up on the render
+// thread.
+// If the thread cannot be started the pipeline falls back to lockstep and
+// this returns false, so the caller can take its context back.
+inline b32 frame_pipeline_start(
+    FramePipeline* pipeline,
+    const MemoryArena* arenas,
+    b32 lockstep,
+    pipeline_render_func* render,
+    pipeline_bind_context_func* bind_context,
+    void* user_data
+) {
+    *pipeline = {};
+    pipeline->lockstep = lockstep;
+    pipeline->render = render;
+    pipeline->bind_context = bind_context;
+    pipeline->user_data = user_data;
+
+    for (u32 i = 0; i < FRAME_PIPELINE_SLOTS; i++) {
+        pipeline->frames[i].commands.arena = arenas[i];
+    }
+
+    if (lockstep) {
+        return true;
+    }
+
+    job_semaphore_init(&pipeline->published);
+    job_semaphore_init(&pipeline->retired);
+    for (u32 i = 0; i < FRAME_PIPELINE_SLOTS; i++) {
+        job_semaphore_signal(&pipeline->retired);
+    }
+
+#ifdef _WIN32
+    pipeline->thread =
+        CreateThread(NULL, 0, frame_pipeline_thread_proc, pipeline, 0, NULL);
+    b32 started = pipeline->thread != NULL;
+#else
+    b32 started = pthread_create(
+                      &pipeline->thread,
+                      nullptr,
+                      frame_pipeline_thread_proc,
+                      pipeline
+                  ) == 0;
+#endif
+    if (!started) {
+        pipeline->lockstep = true;
+    }
+    return started;
+}
+
+// Game thread: get the next slot to record into, waiting for the render
+// thread to retire it if both are in flight. The commands are reset.
+inline PipelineFrame* frame_pipeline_begin(FramePipeline* pipeline) {
+    if (!pipeline->lockstep) {
+        job_semaphore_wait(&pipeline->retired);
+    }
+    PipelineFrame* frame = &pipeline->frames[pipeline->record_index];
+    render_commands_reset(&frame->commands);
+    return frame;
+}
+
+// Game thread: hand the recorded frame to the render side
+inline void frame_pipeline_submit(FramePipeline* pipeline) {
+    if (pipeline->lockstep) {
+        pipeline->render(&pipeline->frames[0], pipeline->user_data);
+        return;
+    }
+    pipeline->record_index =
+        (pipeline->record_index + 1) % FRAME_PIPELINE_SLOTS;
+    job_semaphore_signal(&pipeline->published);
+}
+
+// Game thread: wait for the render thread to replay everything submitted,
+// after which nothing reads the game's memory until the next submit
+inline void frame_pipeline_flush(FramePipeline* pipeline) {
+    if (pipeline->lockstep) {
+        return;
+    }
+    for (u32 i = 0; i < FRAME_PIPELINE_SLOTS; i++) {
+        job_semaphore_wait(&pipeline->retired);
+    }
+    for (u32 i = 0; i < FRAME_PIPELINE_SLOTS; i++) {
+        job_semaphore_signal(&pipeline->retired);
+    }
+}
+
+// Game thread: let the render thread finish what was submitted, then stop
+// it. The render thread releases the GL context on the way out, so the caller
+// can make it current again.
+inline void frame_pipeline_stop(FramePipeline* pipeline) {
+    if (pipeline->lockstep) {
+        return;
+    }
+    for (u32 i = 0; i < FRAME_PIPELINE_SLOTS; i++) {
+        job_semaphore_wait(&pipeline->retired);
+    }
+    __atomic_store_n(&pipeline->quit, true, __ATOMIC_RELEASE);
+    job_semaphore_signal(&pipeline->published);
+#ifdef _WIN32
+    WaitForSingleObject(pipeline->thread, INFINITE);
+    CloseHandle(pipeline->thread);
+#else
+    pthread_join(pipeline->thread, nullptr);
+#endif
+}
@@ -0,0 +1,281 @@
+#pragma once
+
+#include "game_interface.h"
+#include "lib/def.h"
+#include "platform/file_map.h"
+#include "platform/memory.h"
+#include <stdio.h>
+#include <string.h>
+
+// Deterministic input recording and playback
+//
+// A recording snapshots permanent storage when it starts, then appends every
+// frame's GameInput (dt_for_frame and sim_ticks included) and the window size
+// the frame was rendered at:
+//
+//   InputRecordingHeader
+//   permanent storage snapshot, snapshot_size bytes
+//   InputRecordingFrame frames[]   from frames_offset to the end of the file
+//
+// The game is deterministic given its memory and input, so playing the
+// frames back from the snapshot repeats the session exactly, at whatever
+// rate it is played. Playback maps the file, copies the snapshot over
+// permanent storage and hands out frames straight from the mapping, looping
+// back to the snapshot at the end. Transient storage is not saved; the game
+// rebuilds it every frame.
+//
+// Game state points into both storage blocks, so a snapshot only holds at
+// the address it was taken. input_recording_alloc_game_memory puts the
+// blocks at the same address in every process that can, which lets the
+// desktop builds record a session and the bench replay it.
+
+#define INPUT_RECORDING_MAGIC 0x43455252 // "RREC"
+#define INPUT_RECORDING_VERSION 1
+#define INPUT_RECORDING_ALIGNMENT 64
+
+// 2 TB: clear of where the OSes put executables, heaps and libraries
+#define INPUT_RECORDING_MEMORY_BASE ((void*)0x20000000000ull)
+
+struct InputRecordingHeader {
+    u32 magic;
+    u32 version;
+    u32 input_size; // sizeof(GameInput) of the build that recorded
+    u32 is_initialized;
+    u64 permanent_storage;
+    u64 permanent_storage_size;
+    u64 transient_storage;
+    u64 transient_storage_size;
+    u32 sprite_count;
+    u32 world_screens;
+    u32 job_thread_count;
+    u32 reserved;
+    u64 snapshot_size; // Snapshot follows the header
+    u64 frames_offset; // From the start of the file
+};
+
+struct InputRecordingFrame {
+    GameInput input;
+    u32 window_width;
+    u32 window_height;
+};
+
+static_assert(
+    sizeof(InputRecordingHeader) == 80,
+    "InputRecordingHeader is on disk"
+);
+
+struct InputRecorder {
+    FILE* file;
+    u32 frame_count;
+};
+
+struct InputPlayback {
+    PlatformFileMap file;
+    const InputRecordingHeader* header;
+    const InputRecordingFrame* frames;
+    u32 frame_count;
+    u32 next_frame;
+};
+
+// Allocate permanent and transient storage back to back, at
+// INPUT_RECORDING_MEMORY_BASE if the range is free and anywhere otherwise.
+// Recordings made in the second case only play back in the same run.
+inline b32 input_recording_alloc_game_memory(GameMemory* memory) {
+    u64 total_size =
+        memory->permanent_storage_size + memory->transient_storage_size;
+    void* base = platform_alloc_at(INPUT_RECORDING_MEMORY_BASE, total_size);
+    if (!base) {
+        base = platform_alloc(total_size);
+    }
+    if (!base) {
+        return false;
+    }
+    memory->permanent_storage = base;
+    memory->transient_storage = (u8*)base + memory->permanent_storage_size;
+    return true;
+}
+
+// Snapshot permanent storage into a new recording at `path`. Trailing pages
+// the game never wrote are left out, so a recording started before the game
+// initializes is small.
+inline b32 input_recording_begin(
+    InputRecorder* recorder,
+    const char* path,
+    GameMemory* memory
+) {
+    *recorder = {};
+    const u8* permanent = (const u8*)memory->permanent_storage;
+    usize page = platform_page_size();
+    u64 snapshot_size = memory->permanent_storage_size;
+    while (snapshot_size > 0) {
+        u64 start = (snapshot_size - 1) / page * page;
+        const u8* p = permanent + start;
+        const u8* end = permanent + snapshot_size;
+        while (p < end && *p == 0) {
+            p++;
+        }
+        if (p < end) {
+            break;
+        }
+        snapshot_size = start;
+    }
+
+    InputRecordingHeader header = {};
+    header.magic = INPUT_RECORDING_MAGIC;
+    header.version = INPUT_RECORDING_VERSION;
+    header.input_size = sizeof(GameInput);
+    header.is_initialized = memory->is_initialized ? 1 : 0;
+    header.permanent_storage = (u64)(usize)memory->permanent_storage;
+    header.permanent_storage_size = memory->permanent_storage_size;
+    header.transient_storage = (u64)(usize)memory->transient_storage;
+    header.transient_storage_size = memory->transient_storage_size;
+    header.sprite_count = memory->sprite_count;
+    header.world_screens = memory->world_screens;
+    header.job_thread_count = memory->job_thread_count;
+    header.snapshot_size = snapshot_size;
+    u64 snapshot_end = sizeof(InputRecordingHeader) + snapshot_size;
+    header.frames_offset = (snapshot_end + INPUT_RECORDING_ALIGNMENT - 1) /
+                           INPUT_RECORDING_ALIGNMENT *
+                           INPUT_RECORDING_ALIGNMENT;
+
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        return false;
+    }
+    static const u8 zeros[INPUT_RECORDING_ALIGNMENT] = {};
+    usize padding = (usize)(header.frames_offset - snapshot_end);
+    b32 ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+             (snapshot_size == 0 ||
+              fwrite(permanent, (usize)snapshot_size, 1, file) == 1) &&
+             (padding == 0 || fwrite(zeros, padding, 1, file) == 1);
+    if (!ok) {
+        fclose(file);
+        remove(path);
+        return false;
+    }
+    recorder->file = file;
+    return true;
+}
+
+// Append a frame, with the input as update_and_render saw it. Writes are
+// buffered; the file is only complete after input_recording_end.
+inline void input_recording_frame(
+    InputRecorder* recorder,
+    const GameInput* input,
+    u32 window_width,
+    u32 window_height
+) {
+    if (!recorder->file) {
+        return;
+    }
+    InputRecordingFrame frame = {};
+    frame.input = *input;
+    frame.window_width = window_width;
+    frame.window_height = window_height;
+    if (fwrite(&frame, sizeof(frame), 1, recorder->file) == 1) {
+        recorder->frame_count++;
+    }
+}
+
+// Returns false if any of the recording failed to reach the disk
+inline b32 input_recording_end(InputRecorder* recorder) {
+    b32 ok = true;
+    if (recorder->file) {
+        ok = !ferror(recorder->file);
+        ok = (fclose(recorder->file) == 0) && ok;
+    }
+    *recorder = {};
+    return ok;
+}
+
+// Map a recording and check its header against the file. Returns false if
+// the file is missing, malformed, or was recorded by a build with another
+// GameInput.
+inline b32 input_playback_open(InputPlayback* playback, const char* path) {
+    *playback = {};
+    if (!platform_map_file(path, &playback->file)) {
+        return false;
+    }
+
+    usize size = playback->file.size;
+    const InputRecordingHeader* header =
+        (const InputRecordingHeader*)playback->file.data;
+    b32 valid = size >= sizeof(InputRecordingHeader) &&
+                header->magic == INPUT_RECORDING_MAGIC &&
+                header->version == INPUT_RECORDING_VERSION &&
+                header->input_size == sizeof(GameInput) &&
+                header->snapshot_size <= header->permanent_storage_size &&
+                header->frames_offset >=
+                    sizeof(InputRecordingHeader) + header->snapshot_size &&
+                header->frames_offset <= size;
+    if (!valid) {
+        platform_unmap_file(&playback->file);
+        return false;
+    }
+
+    playback->header = header;
+    playback->frames = (const InputRecordingFrame*)(playback->file.data +
+                                                    header->frames_offset);
+    playback->frame_count =
+        (u32)((size - header->frames_offset) / sizeof(InputRecordingFrame));
+    return true;
+}
+
+inline void input_playback_close(InputPlayback* playback) {
+    platform_unmap_file(&playback->file);
+    *playback = {};
+}
+
+// Size storage as the recording's was, before allocating it
+inline void input_playback_size_memory(
+    InputPlayback* playback,
+    GameMemory* memory
+) {
+    memory->permanent_storage_size = playback->header->permanent_storage_size;
+    memory->transient_storage_size = playback->header->transient_storage_size;
+}
+
+// Whether `memory` can take the snapshot: storage allocated at the recorded
+// addresses and sizes, and, once the game has initialized, carved for the
+// same number of job threads
+inline b32 input_playback_matches(InputPlayback* playback, GameMemory* memory) {
+    const InputRecordingHeader* header = playback->header;
+    return header->permanent_storage == (u64)(usize)memory->permanent_storage &&
+           header->permanent_storage_size == memory->permanent_storage_size &&
+           header->transient_storage == (u64)(usize)memory->transient_storage &&
+           header->transient_storage_size == memory->transient_storage_size &&
+           (!header->is_initialized ||
+            header->job_thread_count == memory->job_thread_count);
+}
+
+// Rewind: put the snapshot back in permanent storage and start over from the
+// first frame. All jobs must be complete and nothing may still be reading
+// the game's memory. Returns false if input_playback_matches does not hold.
+inline b32 input_playback_restart(InputPlayback* playback, GameMemory* memory) {
+    if (!input_playback_matches(playback, memory)) {
+        return false;
+    }
+    const InputRecordingHeader* header = playback->header;
+    u8* permanent = (u8*)memory->permanent_storage;
+    usize snapshot_size = (usize)header->snapshot_size;
+    memcpy(permanent, header + 1, snapshot_size);
+    memset(
+        permanent + snapshot_size,
+        0,
+        (usize)header->permanent_storage_size - snapshot_size
+    );
+    memory->is_initialized = header->is_initialized != 0;
+    memory->sprite_count = header->sprite_count;
+    memory->world_screens = header->world_screens;
+    playback->next_frame = 0;
+    return true;
+}
+
+// The next recorded frame, or null once the recording has run out and needs
+// a restart
+inline const InputRecordingFrame* input_playback_next(InputPlayback* playback) {
+    if (playback->next_frame >= playback->frame_count) {
+        return nullptr;
+    }
+    return &playback->frames[playback->next_frame++];
+}
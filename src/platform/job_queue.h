@@ -0,0 +1,231 @@
+#pragma once
+
+#include "game_interface.h"
+#include "lib/def.h"
+#include "platform/memory.h"
+
+// Platform job queue handed to the game through GameMemory. A fixed ring of
+// jobs is filled by the thread that owns the queue and drained by a pool of
+// worker threads; the owning thread helps drain it while it waits in
+// complete_all_jobs, so a queue with zero workers still makes progress.
+//
+// Jobs point at functions inside the game code, so the queue must be empty
+// whenever the game code is reloaded. The game completes its jobs before
+// update_and_render returns, and the platform drains the queue again before
+// reloading as a safety net.
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#define JOB_QUEUE_CAPACITY 256 // Must be a power of two
+
+struct PlatformJob {
+    platform_job_callback* callback;
+    void* data;
+};
+
+// Counting semaphore the workers sleep on while the queue is empty
+struct JobSemaphore {
+#ifdef _WIN32
+    HANDLE handle;
+#else
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    u32 count;
+#endif
+};
+
+struct JobThread {
+    PlatformJobQueue* queue;
+    u32 thread_index;
+};
+
+struct PlatformJobQueue {
+    // Monotonic counters, accessed with __atomic builtins where shared. Indices
+    // into entries are taken modulo the capacity.
+    u32 next_entry_to_write;
+    u32 next_entry_to_read;
+    u32 completion_goal; // Owning thread only
+    u32 completion_count;
+
+    JobSemaphore semaphore;
+    PlatformJob entries[JOB_QUEUE_CAPACITY];
+
+    u32 worker_count;
+    JobThread threads[GAME_MAX_JOB_THREADS];
+};
+
+inline void job_semaphore_init(JobSemaphore* semaphore) {
+#ifdef _WIN32
+    semaphore->handle = CreateSemaphoreA(NULL, 0, JOB_QUEUE_CAPACITY, NULL);
+#else
+    pthread_mutex_init(&semaphore->mutex, nullptr);
+    pthread_cond_init(&semaphore->cond, nullptr);
+    semaphore->count = 0;
+#endif
+}
+
+inline void job_semaphore_signal(JobSemaphore* semaphore) {
+#ifdef _WIN32
+    ReleaseSemaphore(semaphore->handle, 1, NULL);
+#else
+    pthread_mutex_lock(&semaphore->mutex);
+    semaphore->count++;
+    pthread_cond_signal(&semaphore->cond);
+    pthread_mutex_unlock(&semaphore->mutex);
+#endif
+}
+
+inline void job_semaphore_wait(JobSemaphore* semaphore) {
+#ifdef _WIN32
+    WaitForSingleObject(semaphore->handle, INFINITE);
+#else
+    pthread_mutex_lock(&semaphore->mutex);
+    while (semaphore->count == 0) {
+        pthread_cond_wait(&semaphore->cond, &semaphore->mutex);
+    }
+    semaphore->count--;
+    pthread_mutex_unlock(&semaphore->mutex);
+#endif
+}
+
+// Only the owning thread may add jobs
+inline PLATFORM_ADD_JOB(platform_add_job) {
+    u32 write = queue->next_entry_to_write;
+    ASSERT(
+        write - __atomic_load_n(&queue->next_entry_to_read, __ATOMIC_ACQUIRE) <
+        JOB_QUEUE_CAPACITY
+    );
+
+    PlatformJob* job = &queue->entries[write & (JOB_QUEUE_CAPACITY - 1)];
+    job->callback = callback;
+    job->data = data;
+
+    queue->completion_goal++;
+    __atomic_store_n(&queue->next_entry_to_write, write + 1, __ATOMIC_RELEASE);
+    job_semaphore_signal(&queue->semaphore);
+}
+
+// Claim and run one job. Returns false if the queue was empty.
+inline b32 job_queue_do_next(PlatformJobQueue* queue, u32 thread_index) {
+    u32 read = __atomic_load_n(&queue->next_entry_to_read, __ATOMIC_ACQUIRE);
+    for (;;) {
+        u32 write =
+            __atomic_load_n(&queue->next_entry_to_write, __ATOMIC_ACQUIRE);
+        if (read == write) {
+            return false;
+        }
+
+        // Copy the entry out before claiming it; once next_entry_to_read
+        // moves past it the owner may overwrite the slot
+        PlatformJob job = queue->entries[read & (JOB_QUEUE_CAPACITY - 1)];
+        if (__atomic_compare_exchange_n(
+                &queue->next_entry_to_read,
+                &read,
+                read + 1,
+                false,
+                __ATOMIC_ACQ_REL,
+                __ATOMIC_ACQUIRE
+            )) {
+            job.callback(queue, job.data, thread_index);
+            __atomic_add_fetch(&queue->completion_count, 1, __ATOMIC_RELEASE);
+            return true;
+        }
+        // Lost the race; read now holds the current value, try again
+    }
+}
+
+// Run jobs on the calling thread (index 0) until every added job is done
+inline PLATFORM_COMPLETE_ALL_JOBS(platform_complete_all_jobs) {
+    while (__atomic_load_n(&queue->completion_count, __ATOMIC_ACQUIRE) !=
+           queue->completion_goal) {
+        job_queue_do_next(queue, 0);
+    }
+}
+
+#ifdef _WIN32
+inline DWORD WINAPI job_thread_proc(LPVOID param) {
+#else
+inline void* job_thread_proc(void* param) {
+#endif
+    JobThread* thread = (JobThread*)param;
+    for (;;) {
+        if (!job_queue_do_next(thread->queue, thread->thread_index)) {
+            job_semaphore_wait(&thread->queue->semaphore);
+        }
+    }
+#ifdef _WIN32
+    return 0;
+#else
+    return nullptr;
+#endif
+}
+
+inline u32 platform_processor_count() {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (u32)info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return (count > 0) ? (u32)count : 1;
+#endif
+}
+
+// Create a queue with up to `worker_count` workers (fewer if threads fail to
+// start). Workers live for the rest of the process, so there is no matching
+// destroy.
+inline PlatformJobQueue* platform_create_worker_queue(u32 worker_count) {
+    PlatformJobQueue* queue =
+        (PlatformJobQueue*)platform_alloc(sizeof(PlatformJobQueue));
+    if (!queue) {
+        return nullptr;
+    }
+
+    job_semaphore_init(&queue->semaphore);
+
+    if (worker_count > GAME_MAX_JOB_THREADS - 1) {
+        worker_count = GAME_MAX_JOB_THREADS - 1;
+    }
+
+    for (u32 i = 0; i < worker_count; i++) {
+        JobThread* thread = &queue->threads[i];
+        thread->queue = queue;
+        thread->thread_index = i + 1;
+#ifdef _WIN32
+        HANDLE handle = CreateThread(NULL, 0, job_thread_proc, thread, 0, NULL);
+        if (!handle) {
+            break;
+        }
+        CloseHandle(handle);
+#else
+        pthread_t handle;
+        if (pthread_create(&handle, nullptr, job_thread_proc, thread) != 0) {
+            break;
+        }
+        pthread_detach(handle);
+#endif
+        queue->worker_count++;
+    }
+
+    return queue;
+}
+
+// The game's queue: one worker per remaining core
+inline PlatformJobQueue* platform_create_job_queue() {
+    return platform_create_worker_queue(platform_processor_count() - 1);
+}
+
+// Hook the queue up to the game
+inline void
+platform_attach_job_queue(GameMemory* memory, PlatformJobQueue* queue) {
+    memory->job_queue = queue;
+    memory->job_thread_count = queue ? queue->worker_count + 1 : 1;
+    memory->add_job = queue ? platform_add_job : nullptr;
+    memory->complete_all_jobs = queue ? platform_complete_all_jobs : nullptr;
+}
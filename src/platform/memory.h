@@ -1,11 +1,28 @@
 #pragma once
 
 #include "lib/def.h"
+#include "lib/memory_arena.h"
 
 // Platform-agnostic memory allocation using virtual memory
 // - Memory is committed and ready to use (read/write)
 // - Memory is zero-initialized by the OS
 // - Returns nullptr on failure
+// - platform_alloc_at places the block at the given address, and fails if
+//   that range is taken
+//
+// Reserved memory (platform_reserve) is address space only: pages must be
+// committed before use and read back as zero once committed. With
+// ARENA_GUARD_PAGES on, every reservation is followed by a page that is never
+// committed, so running off the end of it faults instead of corrupting
+// whatever the OS put next.
+
+#ifndef ARENA_GUARD_PAGES
+#define ARENA_GUARD_PAGES 1
+#endif
+
+// Granularity growable arenas commit in; a multiple of every page size we run
+// on (4K, and 16K on Apple silicon)
+#define PLATFORM_ARENA_COMMIT_CHUNK (64 * 1024)
 
 #ifdef _WIN32
 #include <windows.h>
@@ -19,6 +36,41 @@ inline void platform_free(void* ptr, usize size) {
     VirtualFree(ptr, 0, MEM_RELEASE);
 }
 
+inline void* platform_alloc_at(void* address, usize size) {
+    return VirtualAlloc(
+        address,
+        size,
+        MEM_COMMIT | MEM_RESERVE,
+        PAGE_READWRITE
+    );
+}
+
+inline usize platform_page_size() {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwPageSize;
+}
+
+inline void* platform_reserve(usize size) {
+    if (ARENA_GUARD_PAGES) {
+        size += platform_page_size();
+    }
+    return VirtualAlloc(NULL, size, MEM_RESERVE, PAGE_NOACCESS);
+}
+
+inline ARENA_COMMIT_PAGES(platform_commit_pages) {
+    return VirtualAlloc(base, size, MEM_COMMIT, PAGE_READWRITE) != NULL;
+}
+
+inline ARENA_DECOMMIT_PAGES(platform_decommit_pages) {
+    VirtualFree(base, size, MEM_DECOMMIT);
+}
+
+inline void platform_release(void* ptr, usize size) {
+    (void)size;
+    VirtualFree(ptr, 0, MEM_RELEASE);
+}
+
 #else
 // POSIX (macOS, Linux, BSD, etc.)
 #include <sys/mman.h>
@@ -37,4 +89,105 @@ inline void* platform_alloc(usize size) {
 
 inline void platform_free(void* ptr, usize size) { munmap(ptr, size); }
 
+// Without MAP_FIXED the address is only a hint, which keeps us from mapping
+// over anything already there; a range that is taken comes back elsewhere
+inline void* platform_alloc_at(void* address, usize size) {
+    void* ptr = mmap(
+        address,
+        size,
+        PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS,
+        -1,
+        0
+    );
+    if (ptr == MAP_FAILED) {
+        return nullptr;
+    }
+    if (ptr != address) {
+        munmap(ptr, size);
+        return nullptr;
+    }
+    return ptr;
+}
+
+#include <unistd.h>
+
+inline usize platform_page_size() { return (usize)sysconf(_SC_PAGESIZE); }
+
+inline void* platform_reserve(usize size) {
+    if (ARENA_GUARD_PAGES) {
+        size += platform_page_size();
+    }
+    void* ptr = mmap(
+        nullptr,
+        size,
+        PROT_NONE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+        -1,
+        0
+    );
+    return (ptr == MAP_FAILED) ? nullptr : ptr;
+}
+
+inline ARENA_COMMIT_PAGES(platform_commit_pages) {
+    return mprotect(base, size, PROT_READ | PROT_WRITE) == 0;
+}
+
+// Mapping fresh PROT_NONE pages over the range drops the old ones right away
+// on both Linux and macOS, where madvise would only hint
+inline ARENA_DECOMMIT_PAGES(platform_decommit_pages) {
+    mmap(
+        base,
+        size,
+        PROT_NONE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED,
+        -1,
+        0
+    );
+}
+
+inline void platform_release(void* ptr, usize size) {
+    if (ARENA_GUARD_PAGES) {
+        size += platform_page_size();
+    }
+    munmap(ptr, size);
+}
+
 #endif
+
+// Reserve `reserve_size` bytes of address space for a growable arena that
+// commits PLATFORM_ARENA_COMMIT_CHUNK at a time. Returns false if the
+// reservation fails.
+inline b32 platform_reserve_arena(
+    MemoryArena* arena,
+    usize reserve_size,
+    u32 flags = 0
+) {
+    usize chunk = PLATFORM_ARENA_COMMIT_CHUNK;
+    reserve_size = (reserve_size + chunk - 1) / chunk * chunk;
+    void* base = platform_reserve(reserve_size);
+    if (!base) {
+        *arena = {};
+        return false;
+    }
+    *arena = MemoryArena::make_growable(
+        base,
+        reserve_size,
+        chunk,
+        platform_commit_pages,
+        platform_decommit_pages,
+        flags
+    );
+#if ARENA_TRACK_SITES
+    arena->sites = (ArenaSiteTable*)platform_alloc(sizeof(ArenaSiteTable));
+#endif
+    return true;
+}
+
+inline void platform_release_arena(MemoryArena* arena) {
+    if (arena->sites) {
+        platform_free(arena->sites, sizeof(ArenaSiteTable));
+    }
+    platform_release(arena->base, arena->size);
+    *arena = {};
+}
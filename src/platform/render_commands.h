@@ -0,0 +1,474 @@
+#pragma once
+
+#include "game_interface.h"
+#include "lib/def.h"
+#include "lib/profiler.h"
+#include "renderer.h"
+#include <string.h>
+
+// Platform-side replay of the game's render command stream. Shared by all
+// platform layers so the command decoding lives in one place.
+
+static_assert(
+    RENDER_MAX_STATIC_LAYERS <= RENDERER_MAX_STATIC_LAYERS,
+    "the renderer must hold every static layer the game can name"
+);
+
+// Low-resolution target size for a window: the 320x180 base grows along
+// the window's longer axis, up to 384x216, instead of letterboxing
+inline void platform_target_size(
+    u32 window_width,
+    u32 window_height,
+    u32* target_width,
+    u32* target_height
+) {
+    constexpr u32 BASE_WIDTH = 320;
+    constexpr u32 BASE_HEIGHT = 180;
+    constexpr u32 MAX_TARGET_WIDTH = GAME_MAX_TARGET_WIDTH;
+    constexpr u32 MAX_TARGET_HEIGHT = GAME_MAX_TARGET_HEIGHT;
+
+    if (window_width == 0 || window_height == 0) {
+        *target_width = BASE_WIDTH;
+        *target_height = BASE_HEIGHT;
+        return;
+    }
+
+    f32 base_aspect = (f32)BASE_WIDTH / (f32)BASE_HEIGHT;
+    f32 window_aspect = (f32)window_width / (f32)window_height;
+
+    if (window_aspect > base_aspect) {
+        // Window is wider - expand width (pillarbox -> overscan)
+        *target_height = BASE_HEIGHT;
+        *target_width = (u32)(BASE_HEIGHT * window_aspect);
+        if (*target_width > MAX_TARGET_WIDTH) {
+            *target_width = MAX_TARGET_WIDTH;
+        }
+    } else {
+        // Window is taller - expand height (letterbox -> overscan)
+        *target_width = BASE_WIDTH;
+        *target_height = (u32)(BASE_WIDTH / window_aspect);
+        if (*target_height > MAX_TARGET_HEIGHT) {
+            *target_height = MAX_TARGET_HEIGHT;
+        }
+    }
+}
+
+inline void render_commands_reset(RenderCommands* commands) {
+    commands->arena.used = 0;
+    commands->sorted_layer_mask = 0;
+    commands->sublist_count = 0;
+}
+
+// Size in bytes of a command, used to walk the stream
+inline usize render_command_size(RenderCommandHeader* header) {
+    switch (header->type) {
+        case RenderCommand_Clear:
+            return sizeof(RenderCommandClear);
+        case RenderCommand_Rect:
+            return sizeof(RenderCommandRect);
+        case RenderCommand_Sprite:
+            return sizeof(RenderCommandSprite);
+        case RenderCommand_AtlasSprite:
+            return sizeof(RenderCommandAtlasSprite);
+        case RenderCommand_AtlasSpriteBatch:
+            return ((RenderCommandAtlasSpriteBatch*)header)->size;
+        case RenderCommand_StaticLayer:
+            return ((RenderCommandStaticLayer*)header)->size;
+        case RenderCommand_SubList:
+            return sizeof(RenderCommandSubList);
+    }
+    ASSERT(!"Unknown render command type");
+    return 0;
+}
+
+// Texture a command draws with (0 = the renderer's white texture)
+inline u32 render_command_texture(RenderCommandHeader* header) {
+    switch (header->type) {
+        case RenderCommand_Sprite:
+            return ((RenderCommandSprite*)header)->texture_id;
+        case RenderCommand_AtlasSprite:
+            return ((RenderCommandAtlasSprite*)header)->texture_id;
+        case RenderCommand_AtlasSpriteBatch:
+            return ((RenderCommandAtlasSpriteBatch*)header)->texture_id;
+        case RenderCommand_StaticLayer:
+            return ((RenderCommandStaticLayer*)header)->texture_id;
+        default:
+            return 0;
+    }
+}
+
+inline RendererBlendMode render_blend_mode(u8 blend_mode) {
+    switch (blend_mode) {
+        case RenderBlend_Additive:
+            return RendererBlend_Additive;
+        default:
+            return RendererBlend_Alpha;
+    }
+}
+
+inline void
+execute_render_command(Renderer* renderer, RenderCommandHeader* header) {
+    switch (header->type) {
+        case RenderCommand_Clear: {
+            RenderCommandClear* cmd = (RenderCommandClear*)header;
+            renderer_set_clear_color(renderer, cmd->color);
+        } break;
+
+        case RenderCommand_Rect: {
+            RenderCommandRect* cmd = (RenderCommandRect*)header;
+            renderer_set_blend_mode(
+                renderer,
+                render_blend_mode(header->blend_mode)
+            );
+            renderer_draw_rect(
+                renderer,
+                cmd->x,
+                cmd->y,
+                cmd->w,
+                cmd->h,
+                cmd->color
+            );
+        } break;
+
+        case RenderCommand_Sprite: {
+            RenderCommandSprite* cmd = (RenderCommandSprite*)header;
+            renderer_set_blend_mode(
+                renderer,
+                render_blend_mode(header->blend_mode)
+            );
+            renderer_draw_sprite(
+                renderer,
+                cmd->x,
+                cmd->y,
+                cmd->w,
+                cmd->h,
+                cmd->texture_id,
+                cmd->tint
+            );
+        } break;
+
+        case RenderCommand_AtlasSprite: {
+            RenderCommandAtlasSprite* cmd = (RenderCommandAtlasSprite*)header;
+            renderer_set_blend_mode(
+                renderer,
+                render_blend_mode(header->blend_mode)
+            );
+            renderer_draw_atlas_sprite(
+                renderer,
+                cmd->x,
+                cmd->y,
+                cmd->w,
+                cmd->h,
+                cmd->u0,
+                cmd->v0,
+                cmd->u1,
+                cmd->v1,
+                cmd->texture_id,
+                cmd->tint
+            );
+        } break;
+
+        case RenderCommand_AtlasSpriteBatch: {
+            RenderCommandAtlasSpriteBatch* cmd =
+                (RenderCommandAtlasSpriteBatch*)header;
+            AtlasSpriteBatch batch = atlas_sprite_batch_arrays(cmd);
+            renderer_set_blend_mode(
+                renderer,
+                render_blend_mode(header->blend_mode)
+            );
+            renderer_draw_atlas_sprite_batch(
+                renderer,
+                cmd->texture_id,
+                cmd->w,
+                cmd->h,
+                (const f32*)batch.regions,
+                cmd->region_count,
+                batch.x,
+                batch.y,
+                batch.region,
+                batch.tint,
+                cmd->count
+            );
+        } break;
+
+        case RenderCommand_StaticLayer: {
+            RenderCommandStaticLayer* cmd = (RenderCommandStaticLayer*)header;
+            if (cmd->update_count > 0) {
+                StaticLayerUpdate update = static_layer_update_arrays(cmd);
+                renderer_update_static_layer(
+                    renderer,
+                    cmd->layer_id,
+                    cmd->capacity,
+                    cmd->texture_id,
+                    cmd->w,
+                    cmd->h,
+                    (const f32*)update.regions,
+                    cmd->region_count,
+                    cmd->first,
+                    update.x,
+                    update.y,
+                    update.region,
+                    update.tint,
+                    cmd->update_count
+                );
+            }
+            renderer_set_blend_mode(
+                renderer,
+                render_blend_mode(header->blend_mode)
+            );
+            renderer_draw_static_layer(
+                renderer,
+                cmd->layer_id,
+                cmd->draw_first,
+                cmd->draw_count,
+                cmd->offset_x,
+                cmd->offset_y
+            );
+        } break;
+
+        case RenderCommand_SubList: {
+            // Expanded in place by execute_render_commands
+            ASSERT(!"Sub-lists cannot be nested");
+        } break;
+    }
+}
+
+// Recorded range of a sub-list command
+inline RenderSubList*
+render_sublist(RenderCommands* commands, RenderCommandHeader* header) {
+    RenderCommandSubList* cmd = (RenderCommandSubList*)header;
+    ASSERT(cmd->index < commands->sublist_count);
+    return &commands->sublists[cmd->index];
+}
+
+// Command count with sub-lists expanded
+inline u32 count_render_commands(RenderCommands* commands) {
+    u8* base = (u8*)commands->arena.base;
+    u8* end = base + commands->arena.used;
+    u32 count = 0;
+    for (u8* at = base; at < end;) {
+        RenderCommandHeader* header = (RenderCommandHeader*)at;
+        if (header->type == RenderCommand_SubList) {
+            RenderSubList* sublist = render_sublist(commands, header);
+            u8* sub_end = sublist->base + sublist->used;
+            for (u8* sub = sublist->base; sub < sub_end; count++) {
+                sub += render_command_size((RenderCommandHeader*)sub);
+            }
+        } else {
+            count++;
+        }
+        at += render_command_size(header);
+    }
+    return count;
+}
+
+// Bytes of command memory a frame used, sub-lists included
+inline u64 render_commands_bytes_used(RenderCommands* commands) {
+    u64 result = commands->arena.used;
+    for (u32 i = 0; i < commands->sublist_count; i++) {
+        result += commands->sublists[i].used;
+    }
+    return result;
+}
+
+// Copy the renderer and command counters of a presented frame into the
+// profiler's current frame, and report the command arena
+inline void profile_render_stats(
+    Profiler* profiler,
+    Renderer* renderer,
+    RenderCommands* commands
+) {
+    RendererStats stats;
+    renderer_get_stats(renderer, &stats);
+
+    ProfileFrame* frame = profiler_current_frame(profiler);
+    frame->draw_calls = stats.draw_calls;
+    frame->quads = stats.quads;
+    frame->bytes_uploaded = stats.bytes_uploaded;
+    frame->gpu_draw_ms = stats.gpu_draw_ms;
+    frame->gpu_blit_ms = stats.gpu_blit_ms;
+    frame->command_bytes = render_commands_bytes_used(commands);
+    profiler_report_arena(profiler, "render commands", &commands->arena);
+}
+
+struct RenderSortEntry {
+    u64 key;
+    RenderCommandHeader* command;
+};
+
+// Sort key layout (high to low):
+//   [63:56] layer
+//   [55:48] blend mode   (sorted layers only)
+//   [47:16] texture id   (sorted layers only)
+//   [15:0]  unused
+// Unsorted layers only carry the layer, so the stable sort below keeps their
+// submission order.
+inline u64
+render_sort_key(u32 sorted_layer_mask, RenderCommandHeader* header) {
+    ASSERT(header->layer < RENDER_LAYER_COUNT);
+    u64 key = (u64)header->layer << 56;
+    if (sorted_layer_mask & (1u << header->layer)) {
+        key |= (u64)header->blend_mode << 48;
+        key |= (u64)render_command_texture(header) << 16;
+    }
+    return key;
+}
+
+// Stable LSD radix sort over 64-bit keys, 8 bits per pass. All histograms are
+// built in one read, and passes whose digit is the same for every key are
+// skipped, so the empty low bits and any uniform fields cost nothing.
+inline void radix_sort_render_entries(
+    RenderSortEntry* entries,
+    RenderSortEntry* scratch,
+    u32 count
+) {
+    if (count < 2) {
+        return;
+    }
+
+    u32 histograms[8][256] = {};
+    for (u32 i = 0; i < count; i++) {
+        u64 key = entries[i].key;
+        for (u32 pass = 0; pass < 8; pass++) {
+            histograms[pass][(key >> (pass * 8)) & 0xFF]++;
+        }
+    }
+
+    RenderSortEntry* src = entries;
+    RenderSortEntry* dst = scratch;
+    for (u32 pass = 0; pass < 8; pass++) {
+        u32 shift = pass * 8;
+        u32* histogram = histograms[pass];
+        if (histogram[(src[0].key >> shift) & 0xFF] == count) {
+            continue;
+        }
+
+        u32 offset = 0;
+        for (u32 digit = 0; digit < 256; digit++) {
+            u32 digit_count = histogram[digit];
+            histogram[digit] = offset;
+            offset += digit_count;
+        }
+
+        for (u32 i = 0; i < count; i++) {
+            u32 digit = (src[i].key >> shift) & 0xFF;
+            dst[histogram[digit]++] = src[i];
+        }
+
+        RenderSortEntry* temp = src;
+        src = dst;
+        dst = temp;
+    }
+
+    if (src != entries) {
+        memcpy(entries, src, count * sizeof(RenderSortEntry));
+    }
+}
+
+/**
+ * Executes all render commands stored in the command buffer.
+ *
+ * This function iterates through a linear arena of serialized render commands,
+ * parsing each command header to determine its type, then dispatching to the
+ * appropriate renderer function. Commands are tightly packed in memory with
+ * variable sizes based on their type.
+ *
+ * Sub-list commands are expanded in place: the commands recorded into each
+ * sub-list replay where its placeholder sits in the main stream, so lists
+ * recorded in parallel still execute in a deterministic order.
+ *
+ * If the game opted any layer into sorting (sorted_layer_mask != 0), the
+ * commands are first reordered by a radix sort: by layer, then within sorted
+ * layers by blend mode and texture, so draw calls scale with the number of
+ * textures rather than sprites. The sort entries are scratch memory taken from
+ * the unused tail of the command arena; if it does not fit, commands are
+ * replayed in submission order. With no layer opted in, commands are always
+ * replayed in submission order.
+ *
+ * @param renderer  The renderer instance to execute commands on.
+ * @param commands  The render command buffer containing serialized commands.
+ *                  Commands are stored sequentially starting at arena.base,
+ *                  with arena.used indicating the total bytes of commands.
+ *
+ * Supported command types:
+ *   - RenderCommand_Clear:       Sets the clear color for the frame
+ *   - RenderCommand_Rect:        Draws a colored rectangle
+ *   - RenderCommand_Sprite:      Draws a textured sprite with optional tint
+ *   - RenderCommand_AtlasSprite: Draws a sub-region of an atlas texture
+ *   - RenderCommand_AtlasSpriteBatch: Draws many same-sized atlas sprites
+ *                                     in one dispatch
+ *   - RenderCommand_StaticLayer: Updates the dirty span of a retained
+ *                                sprite layer and draws it
+ *   - RenderCommand_SubList:     Replays a separately recorded command list
+ */
+inline void
+execute_render_commands(Renderer* renderer, RenderCommands* commands) {
+    TIMED_FUNCTION();
+    u8* base = (u8*)commands->arena.base;
+    u8* end = base + commands->arena.used;
+
+    if (commands->sorted_layer_mask == 0) {
+        for (u8* at = base; at < end;) {
+            RenderCommandHeader* header = (RenderCommandHeader*)at;
+            if (header->type == RenderCommand_SubList) {
+                RenderSubList* sublist = render_sublist(commands, header);
+                u8* sub_end = sublist->base + sublist->used;
+                for (u8* sub = sublist->base; sub < sub_end;) {
+                    RenderCommandHeader* sub_header = (RenderCommandHeader*)sub;
+                    execute_render_command(renderer, sub_header);
+                    sub += render_command_size(sub_header);
+                }
+            } else {
+                execute_render_command(renderer, header);
+            }
+            at += render_command_size(header);
+        }
+        return;
+    }
+
+    u32 count = count_render_commands(commands);
+
+    // Sort entries live just past the commands for the rest of the call
+    MemoryArena* arena = &commands->arena;
+    usize needed =
+        2 * count * sizeof(RenderSortEntry) + alignof(RenderSortEntry);
+    if (arena->remaining() < needed) {
+        commands->sorted_layer_mask = 0;
+        execute_render_commands(renderer, commands);
+        return;
+    }
+
+    TemporaryMemory sort_memory = TemporaryMemory::make(arena);
+    RenderSortEntry* entries = arena->push_array<RenderSortEntry>(count);
+    RenderSortEntry* scratch = arena->push_array<RenderSortEntry>(count);
+
+    u32 index = 0;
+    for (u8* at = base; at < end;) {
+        RenderCommandHeader* header = (RenderCommandHeader*)at;
+        if (header->type == RenderCommand_SubList) {
+            RenderSubList* sublist = render_sublist(commands, header);
+            u8* sub_end = sublist->base + sublist->used;
+            for (u8* sub = sublist->base; sub < sub_end; index++) {
+                RenderCommandHeader* sub_header = (RenderCommandHeader*)sub;
+                entries[index].key =
+                    render_sort_key(commands->sorted_layer_mask, sub_header);
+                entries[index].command = sub_header;
+                sub += render_command_size(sub_header);
+            }
+        } else {
+            entries[index].key =
+                render_sort_key(commands->sorted_layer_mask, header);
+            entries[index].command = header;
+            index++;
+        }
+        at += render_command_size(header);
+    }
+
+    radix_sort_render_entries(entries, scratch, count);
+
+    for (u32 i = 0; i < count; i++) {
+        execute_render_command(renderer, entries[i].command);
+    }
+
+    sort_memory.end();
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "game_interface.h"
+#include "lib/def.h"
+#include "lib/profiler.h"
+#include "platform/memory.h"
+
+// Per-frame scratch arenas handed to the game through GameMemory. Each is a
+// growable reservation made once at startup and emptied before every
+// update_and_render, so short-lived allocations never touch the OS allocator
+// and only the pages a frame has actually needed are ever backed.
+
+#define PLATFORM_FRAME_SCRATCH_SIZE MB(256)
+#define PLATFORM_THREAD_SCRATCH_SIZE MB(64)
+
+// Call once the job queue is attached, since there is one thread arena per
+// job thread. The sizes are address space to reserve. Returns false if the
+// reservation fails.
+inline b32 platform_init_scratch(
+    GameMemory* memory,
+    usize frame_size,
+    usize thread_size
+) {
+    if (!platform_reserve_arena(&memory->frame_arena, frame_size)) {
+        return false;
+    }
+    u32 thread_count = memory->job_thread_count ? memory->job_thread_count : 1;
+    for (u32 i = 0; i < thread_count; i++) {
+        if (!platform_reserve_arena(&memory->thread_scratch[i], thread_size)) {
+            return false;
+        }
+    }
+    return true;
+}
+// Empty every scratch arena; call right before update_and_render. What the
+// previous frame used is reported to the profiler first.
+inline void platform_reset_scratch(GameMemory* memory) {
+    u32 thread_count = memory->job_thread_count ? memory->job_thread_count : 1;
+    if (memory->profiler) {
+        profiler_report_arena(
+            memory->profiler,
+            "frame scratch",
+            &memory->frame_arena
+        );
+        profiler_report_arenas(
+            memory->profiler,
+            "thread scratch",
+            memory->thread_scratch,
+            thread_count
+        );
+    }
+
+    memory->frame_arena.clear();
+    for (u32 i = 0; i < thread_count; i++) {
+        memory->thread_scratch[i].clear();
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "lib/def.h"
+#include "platform/file_watcher.h"
+#include "renderer.h"
+#include <stdio.h>
+
+// Shader hot reload for development: the platform watches the renderer's
+// shader files in the source tree and asks the renderer to rebuild its
+// programs when one changes. The renderer must have been created with
+// RendererConfig::shader_source_dir pointing at the same directory.
+
+#define SHADER_WATCH_SOURCE_DIR "src/shaders"
+#define SHADER_WATCH_MAX_FILES 16
+
+struct ShaderWatch {
+    u32 ids[SHADER_WATCH_MAX_FILES];
+    u32 count;
+};
+
+inline void platform_watch_shaders(
+    ShaderWatch* watch,
+    FileWatcher* watcher,
+    const char* directory
+) {
+    watch->count = 0;
+    for (u32 i = 0; i < SHADER_WATCH_MAX_FILES; i++) {
+        const char* file = renderer_shader_file(i);
+        if (!file) {
+            break;
+        }
+        char path[FILE_WATCHER_PATH_SIZE];
+        snprintf(path, sizeof(path), "%s/%s", directory, file);
+        u32 id = file_watcher_add(watcher, path);
+        if (id != FILE_WATCHER_INVALID_ID) {
+            watch->ids[watch->count++] = id;
+        }
+    }
+}
+
+// Note a change reported by the file watcher. Saving several files at once
+// rebuilds once, at the renderer's next frame.
+inline void platform_shader_file_changed(
+    ShaderWatch* watch,
+    Renderer* renderer,
+    u32 watch_id
+) {
+    for (u32 i = 0; i < watch->count; i++) {
+        if (watch->ids[i] == watch_id) {
+            renderer_reload_shaders(renderer);
+            return;
+        }
+    }
+}
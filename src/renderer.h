@@ -4,7 +4,89 @@
 
 struct Renderer;
 
-Renderer* renderer_init(void);
+enum RendererBatchMode {
+    RendererBatchMode_Vertices,  // CPU expands each quad into 4 vertices
+    RendererBatchMode_Instanced, // One instance per quad, expanded in the VS
+};
+
+// Vertex layout used by RendererBatchMode_Vertices
+enum RendererVertexFormat {
+    RendererVertexFormat_Float,   // 32 bytes: f32 pos, f32 uv, f32 color
+    RendererVertexFormat_Compact, // 16 bytes: f32 pos, u16 uv, RGBA8 color
+};
+
+enum RendererBlendMode {
+    RendererBlend_Alpha,    // src * a + dst * (1 - a)
+    RendererBlend_Additive, // src * a + dst
+};
+
+// Default batch capacity when RendererConfig::max_quads is 0
+#define RENDERER_DEFAULT_MAX_QUADS 65536
+
+// Default per-frame texture streaming budget when
+// RendererConfig::texture_upload_budget is 0
+#define RENDERER_DEFAULT_TEXTURE_UPLOAD_BUDGET (4 * 1024 * 1024)
+
+// Default per-frame batch streaming budget when RendererConfig::stream_budget
+// is 0
+#define RENDERER_DEFAULT_STREAM_BUDGET (16 * 1024 * 1024)
+
+struct RendererConfig {
+    RendererBatchMode batch_mode;
+    RendererVertexFormat vertex_format;
+    u32 max_quads; // Quads per draw call before a forced flush (0 = default)
+
+    // Bytes of batches a frame may stream, layer indices included, before
+    // the ring moves on early and waits for the GPU to finish with a region
+    // mid-frame. Raised to one full batch of max_quads if smaller
+    // (0 = default).
+    u32 stream_budget;
+
+    // Pool same-sized textures into array textures and pick the layer per
+    // quad, so only a change of pool (or blend mode) flushes. Rects batch
+    // with any pool.
+    b32 texture_arrays;
+
+    // Pack RGBA textures up to 256x256 into shared 1024x1024 atlas pages
+    // and remap their UVs at draw time, so switching between textures on one
+    // page doesn't flush. With texture_arrays the pages are pool layers.
+    b32 texture_atlas;
+
+    // Bytes of texels renderer_upload_texture_rows may stage per frame
+    // (0 = default)
+    u32 texture_upload_budget;
+
+    // Directory for linked program binaries, created if missing. Entries are
+    // keyed by the shader sources and the driver, so a warm start links
+    // nothing and a driver update just misses. Null always compiles.
+    const char* shader_cache_dir;
+
+    // Read the shader files from this directory instead of the copies built
+    // in, so renderer_reload_shaders picks up edits (null = built in)
+    const char* shader_source_dir;
+};
+
+// Counters for the last completed frame. The GPU times come from timer
+// queries read back without stalling, so they describe the frame from
+// STREAM_REGION_COUNT frames earlier.
+struct RendererStats {
+    u32 draw_calls;
+    u32 quads;
+    u64 bytes_uploaded; // Batches and streamed texels
+    f64 gpu_draw_ms; // Sum over all batch flushes
+    f64 gpu_blit_ms; // Offscreen target to window
+};
+
+Renderer* renderer_init(const RendererConfig* config);
+
+// Shader files read from RendererConfig::shader_source_dir, for the platform
+// to watch. Null past the last one, or if the renderer has no shaders.
+const char* renderer_shader_file(u32 index);
+
+// Rebuild the programs from the source directory at the start of the next
+// frame, keeping the current ones if any shader fails. Safe to call from any
+// thread.
+void renderer_reload_shaders(Renderer* renderer);
 
 void renderer_begin_frame(
     Renderer* renderer,
@@ -14,6 +96,7 @@ void renderer_begin_frame(
     u32 target_height
 );
 void renderer_end_frame(Renderer* renderer);
+void renderer_get_stats(Renderer* renderer, RendererStats* stats);
 
 void renderer_draw_rect(
     Renderer* renderer,
@@ -48,12 +131,104 @@ void renderer_draw_atlas_sprite(
     Color tint
 );
 
+// Draw `count` sprites of size w x h from one atlas. Sprite i is placed at
+// (x[i], y[i]), samples region_uvs[region[i] * 4 ...] (u0, v0, u1, v1) and is
+// tinted with tint[i]. region_uvs holds region_count regions.
+void renderer_draw_atlas_sprite_batch(
+    Renderer* renderer,
+    u32 texture_id,
+    f32 w,
+    f32 h,
+    const f32* region_uvs,
+    u32 region_count,
+    const f32* x,
+    const f32* y,
+    const u16* region,
+    const Color* tint,
+    u32 count
+);
+
+// Retained sprite layers keep their quads resident in a GPU buffer of their
+// own, in the active batch format, so drawing one uploads nothing. Layers are
+// named by the caller; the first update fixes a layer's capacity.
+#define RENDERER_MAX_STATIC_LAYERS 16
+
+// Expand sprites [first, first + count) of a layer and upload just those,
+// with the same arguments as renderer_draw_atlas_sprite_batch. The texture's
+// placement is baked in; the renderer never moves a texture once a layer
+// has been written with it.
+// Returns false, writing nothing, if the range exceeds the layer's capacity,
+// the capacity differs from the one it was created with, or the layer can't
+// be created.
+b32 renderer_update_static_layer(
+    Renderer* renderer,
+    u32 layer_index,
+    u32 capacity,
+    u32 texture_id,
+    f32 w,
+    f32 h,
+    const f32* region_uvs,
+    u32 region_count,
+    u32 first,
+    const f32* x,
+    const f32* y,
+    const u16* region,
+    const Color* tint,
+    u32 count
+);
+
+// Draw sprites [first, first + count) of a layer with offset_x, offset_y
+// subtracted from their positions. Flushes the pending batch; with vertex
+// batches a range larger than the batch capacity takes one draw call per
+// batch's worth.
+void renderer_draw_static_layer(
+    Renderer* renderer,
+    u32 layer_index,
+    u32 first,
+    u32 count,
+    f32 offset_x,
+    f32 offset_y
+);
+
+// Returns the texture id, or 0 (the white texture) if there is no room left.
+// UVs passed to the draw calls are always in the texture's own [0, 1] space,
+// wherever it ends up stored.
 u32 renderer_load_texture(
     Renderer* renderer,
-    void* pixels,
+    const void* pixels,
+    i32 width,
+    i32 height,
+    i32 channels
+);
+
+// Reserve a texture id and its storage without filling it, for streaming
+// its texels in with renderer_upload_texture_rows. Until then it samples as
+// undefined contents; callers draw the white texture (id 0) instead. Returns
+// 0 if there is no room left.
+u32 renderer_create_texture(
+    Renderer* renderer,
     i32 width,
     i32 height,
     i32 channels
 );
 
+// Bytes renderer_upload_texture_rows can still stage this frame
+usize renderer_texture_upload_available(Renderer* renderer);
+
+// Stage `row_count` tightly packed rows starting at `first_row` (top row
+// first) of a texture from renderer_create_texture, without stalling: the
+// rows are copied into this frame's share of a pixel buffer ring and the GPU
+// pulls them in asynchronously. Returns false, uploading nothing, if the
+// rows don't fit in what is left of the frame's budget.
+b32 renderer_upload_texture_rows(
+    Renderer* renderer,
+    u32 texture_id,
+    const void* rows,
+    i32 first_row,
+    i32 row_count
+);
+
 void renderer_set_clear_color(Renderer* renderer, Color color);
+
+// Changing the blend mode flushes the pending batch
+void renderer_set_blend_mode(Renderer* renderer, RendererBlendMode mode);
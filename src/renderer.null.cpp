@@ -0,0 +1,727 @@
+// Null renderer: the renderer.h API without a GPU, for headless runs.
+//
+// Batches are built exactly like the OpenGL renderer builds them, with the
+// same batch modes, vertex formats and kernels, into a CPU buffer that a
+// flush simply discards. Draw call, quad and byte counters match what the GL
+// path would submit, so the CPU cost of each renderer mode can be compared
+// without a window. GPU times are always 0.
+
+#include "platform/memory.h"
+#include "renderer.h"
+#include "util/sprite_vertices.h"
+#include "util/texture_placement.h"
+#include <string.h>
+
+#define MAX_TEXTURES 256
+
+// Same texture upload budget as renderer.opengl.cpp
+#define STREAM_ALIGNMENT 16
+
+// Same layouts as renderer.opengl.cpp
+struct Vertex {
+    f32 pos[2];
+    f32 uv[2];
+    f32 color[4];
+};
+
+struct SpriteInstance {
+    f32 rect[4];
+    u16 uv[4];
+    u32 color;
+};
+
+// Static layer resident in CPU memory instead of a GPU buffer
+struct StaticLayer {
+    u8* quads;
+    u16* layers;
+    u32 capacity;
+    u32 texture_id;
+};
+
+struct TextureExtent {
+    i32 width;
+    i32 height;
+    i32 channels;
+};
+
+struct Renderer {
+    RendererBatchMode batch_mode;
+    RendererVertexFormat vertex_format;
+    b32 texture_arrays;
+    b32 texture_atlas;
+
+    u8* batch_base;
+    u32 max_quads;
+    u32 quad_stride;
+    u32 quad_count;
+    u16* batch_layers;
+    u32 layer_stride;
+
+    u32 texture_count;
+    TextureExtent texture_extents[MAX_TEXTURES];
+    usize texture_upload_budget;
+    usize texture_upload_used; // This frame
+    u32 current_texture;
+    TexturePool pools[MAX_TEXTURE_POOLS];
+    u32 pool_count;
+    PooledTexture pooled_textures[MAX_TEXTURES];
+    u32 current_pool;
+    u16 current_layer;
+
+    // What the GL renderer would bind for each texture id without texture
+    // arrays: its own texture, or MAX_TEXTURES + the atlas page it is on
+    u32 texture_bindings[MAX_TEXTURES];
+    MemoryArena atlas_arena;
+    AtlasPage atlas_pages[MAX_ATLAS_PAGES];
+    u32 atlas_page_count;
+    AtlasEntry atlas_entries[MAX_TEXTURES];
+    f32 atlas_region_uvs[ATLAS_MAX_BATCH_REGIONS * 4];
+    StaticLayer static_layers[RENDERER_MAX_STATIC_LAYERS];
+    RendererBlendMode current_blend_mode;
+
+    RendererStats stats;
+    RendererStats last_stats;
+};
+
+static Renderer global_renderer = {};
+
+Renderer* renderer_init(const RendererConfig* config) {
+    Renderer* r = &global_renderer;
+    *r = {};
+    r->batch_mode = config->batch_mode;
+    r->vertex_format = config->vertex_format;
+    r->texture_arrays = config->texture_arrays;
+    r->texture_atlas = config->texture_atlas;
+    r->current_pool = TEXTURE_POOL_NONE;
+    r->max_quads = config->max_quads ? config->max_quads
+                                     : RENDERER_DEFAULT_MAX_QUADS;
+    r->texture_upload_budget = config->texture_upload_budget
+                                   ? config->texture_upload_budget
+                                   : RENDERER_DEFAULT_TEXTURE_UPLOAD_BUDGET;
+
+    if (r->batch_mode == RendererBatchMode_Instanced) {
+        r->quad_stride = sizeof(SpriteInstance);
+    } else if (r->vertex_format == RendererVertexFormat_Compact) {
+        r->quad_stride = 4 * sizeof(CompactVertex);
+    } else {
+        r->quad_stride = 4 * sizeof(Vertex);
+    }
+    r->batch_base = (u8*)platform_alloc((usize)r->max_quads * r->quad_stride);
+    if (!r->batch_base) {
+        return nullptr;
+    }
+    if (r->texture_arrays) {
+        u32 layers_per_quad =
+            (r->batch_mode == RendererBatchMode_Instanced) ? 1 : 4;
+        r->layer_stride = layers_per_quad * sizeof(u16);
+        r->batch_layers =
+            (u16*)platform_alloc((usize)r->max_quads * r->layer_stride);
+        if (!r->batch_layers) {
+            return nullptr;
+        }
+    }
+
+    if (r->texture_atlas) {
+        void* atlas_memory = platform_alloc(ATLAS_ARENA_SIZE);
+        if (!atlas_memory) {
+            return nullptr;
+        }
+        r->atlas_arena = MemoryArena::make(atlas_memory, ATLAS_ARENA_SIZE);
+    }
+
+    // Texture 0 is the white texture in the GL renderer
+    r->texture_extents[0] = {1, 1, 4};
+    r->atlas_entries[0].page = ATLAS_PAGE_NONE;
+    r->texture_count = 1;
+    return r;
+}
+
+// No shaders to watch or rebuild
+const char* renderer_shader_file(u32 index) {
+    (void)index;
+    return nullptr;
+}
+
+void renderer_reload_shaders(Renderer* renderer) { (void)renderer; }
+
+static void renderer_flush(Renderer* r) {
+    if (r->quad_count == 0) {
+        return;
+    }
+    r->stats.draw_calls++;
+    r->stats.quads += r->quad_count;
+    r->stats.bytes_uploaded +=
+        (u64)r->quad_count * (r->quad_stride + r->layer_stride);
+    r->quad_count = 0;
+}
+
+void renderer_begin_frame(
+    Renderer* renderer,
+    u32 width,
+    u32 height,
+    u32 target_width,
+    u32 target_height
+) {
+    (void)width;
+    (void)height;
+    (void)target_width;
+    (void)target_height;
+    renderer->quad_count = 0;
+    renderer->current_texture = 0;
+    renderer->current_pool = TEXTURE_POOL_NONE;
+    renderer->current_layer = TEXTURE_LAYER_NONE;
+    renderer->current_blend_mode = RendererBlend_Alpha;
+    renderer->texture_upload_used = 0;
+    renderer->stats = {};
+}
+
+void renderer_end_frame(Renderer* renderer) {
+    renderer_flush(renderer);
+    renderer->last_stats = renderer->stats;
+}
+
+void renderer_get_stats(Renderer* renderer, RendererStats* stats) {
+    *stats = renderer->last_stats;
+}
+
+static void renderer_use_texture(Renderer* r, u32 texture_id) {
+    if (r->texture_arrays) {
+        if (texture_id == 0) {
+            r->current_layer = TEXTURE_LAYER_NONE;
+            return;
+        }
+        PooledTexture* pooled = &r->pooled_textures[texture_id];
+        if (r->current_pool != pooled->pool) {
+            renderer_flush(r);
+            r->current_pool = pooled->pool;
+        }
+        r->current_layer = pooled->layer;
+        return;
+    }
+    if (r->current_texture != r->texture_bindings[texture_id]) {
+        renderer_flush(r);
+        r->current_texture = r->texture_bindings[texture_id];
+    }
+}
+
+static AtlasEntry* renderer_atlas_entry(Renderer* r, u32 texture_id) {
+    return r->texture_atlas ? atlas_entry_find(r->atlas_entries, texture_id)
+                            : nullptr;
+}
+
+static void renderer_tag_layers(Renderer* r, u32 first, u32 count) {
+    u32 per_quad = r->layer_stride / sizeof(u16);
+    u16* layers = r->batch_layers + (usize)first * per_quad;
+    u32 layer_count = count * per_quad;
+    for (u32 i = 0; i < layer_count; i++) {
+        layers[i] = r->current_layer;
+    }
+}
+
+static void renderer_push_quad(
+    Renderer* r,
+    f32 x,
+    f32 y,
+    f32 w,
+    f32 h,
+    f32 u0,
+    f32 v0,
+    f32 u1,
+    f32 v1,
+    Color color
+) {
+    if (r->quad_count + 1 > r->max_quads) {
+        renderer_flush(r);
+    }
+
+    if (r->layer_stride) {
+        renderer_tag_layers(r, r->quad_count, 1);
+    }
+
+    switch (r->batch_mode) {
+        case RendererBatchMode_Vertices: {
+            if (r->vertex_format == RendererVertexFormat_Compact) {
+                CompactVertex* v =
+                    (CompactVertex*)r->batch_base + r->quad_count * 4;
+                u16 cu0 = uv_to_unorm16(u0);
+                u16 cv0 = uv_to_unorm16(v0);
+                u16 cu1 = uv_to_unorm16(u1);
+                u16 cv1 = uv_to_unorm16(v1);
+                u32 c = color_to_rgba8(color);
+
+                v[0] = {{x, y}, {cu0, cv0}, c};
+                v[1] = {{x + w, y}, {cu1, cv0}, c};
+                v[2] = {{x + w, y + h}, {cu1, cv1}, c};
+                v[3] = {{x, y + h}, {cu0, cv1}, c};
+                break;
+            }
+
+            Vertex* v = (Vertex*)r->batch_base + r->quad_count * 4;
+            f32 cr = color_r(color);
+            f32 cg = color_g(color);
+            f32 cb = color_b(color);
+            f32 ca = color_a(color);
+
+            v[0] = {{x, y}, {u0, v0}, {cr, cg, cb, ca}};
+            v[1] = {{x + w, y}, {u1, v0}, {cr, cg, cb, ca}};
+            v[2] = {{x + w, y + h}, {u1, v1}, {cr, cg, cb, ca}};
+            v[3] = {{x, y + h}, {u0, v1}, {cr, cg, cb, ca}};
+        } break;
+
+        case RendererBatchMode_Instanced: {
+            SpriteInstance* inst =
+                (SpriteInstance*)r->batch_base + r->quad_count;
+            inst->rect[0] = x;
+            inst->rect[1] = y;
+            inst->rect[2] = w;
+            inst->rect[3] = h;
+            inst->uv[0] = uv_to_unorm16(u0);
+            inst->uv[1] = uv_to_unorm16(v0);
+            inst->uv[2] = uv_to_unorm16(u1);
+            inst->uv[3] = uv_to_unorm16(v1);
+            inst->color = color_to_rgba8(color);
+        } break;
+    }
+
+    r->quad_count++;
+}
+
+void renderer_draw_rect(
+    Renderer* renderer,
+    f32 x,
+    f32 y,
+    f32 w,
+    f32 h,
+    Color color
+) {
+    f32 uv[4] = {0.0f, 0.0f, 1.0f, 1.0f};
+    if (AtlasEntry* entry = renderer_atlas_entry(renderer, 0)) {
+        atlas_entry_remap(entry, uv);
+    }
+    renderer_use_texture(renderer, 0);
+    renderer_push_quad(renderer, x, y, w, h, uv[0], uv[1], uv[2], uv[3], color);
+}
+
+void renderer_draw_sprite(
+    Renderer* renderer,
+    f32 x,
+    f32 y,
+    f32 w,
+    f32 h,
+    u32 texture_id,
+    Color tint
+) {
+    f32 uv[4] = {0.0f, 0.0f, 1.0f, 1.0f};
+    if (AtlasEntry* entry = renderer_atlas_entry(renderer, texture_id)) {
+        atlas_entry_remap(entry, uv);
+    }
+    renderer_use_texture(renderer, texture_id);
+    renderer_push_quad(renderer, x, y, w, h, uv[0], uv[1], uv[2], uv[3], tint);
+}
+
+void renderer_draw_atlas_sprite(
+    Renderer* renderer,
+    f32 x,
+    f32 y,
+    f32 w,
+    f32 h,
+    f32 u0,
+    f32 v0,
+    f32 u1,
+    f32 v1,
+    u32 texture_id,
+    Color tint
+) {
+    f32 uv[4] = {u0, v0, u1, v1};
+    if (AtlasEntry* entry = renderer_atlas_entry(renderer, texture_id)) {
+        atlas_entry_remap(entry, uv);
+    }
+    renderer_use_texture(renderer, texture_id);
+    renderer_push_quad(renderer, x, y, w, h, uv[0], uv[1], uv[2], uv[3], tint);
+}
+
+void renderer_draw_atlas_sprite_batch(
+    Renderer* renderer,
+    u32 texture_id,
+    f32 w,
+    f32 h,
+    const f32* region_uvs,
+    u32 region_count,
+    const f32* x,
+    const f32* y,
+    const u16* region,
+    const Color* tint,
+    u32 count
+) {
+    renderer_use_texture(renderer, texture_id);
+
+    AtlasEntry* remap_entry = renderer_atlas_entry(renderer, texture_id);
+    if (remap_entry && region_count <= ATLAS_MAX_BATCH_REGIONS) {
+        f32* remapped = renderer->atlas_region_uvs;
+        memcpy(remapped, region_uvs, region_count * 4 * sizeof(f32));
+        for (u32 i = 0; i < region_count; i++) {
+            atlas_entry_remap(remap_entry, remapped + i * 4);
+        }
+        region_uvs = remapped;
+        remap_entry = nullptr;
+    }
+
+    if (renderer->batch_mode == RendererBatchMode_Vertices && !remap_entry) {
+        while (count > 0) {
+            if (renderer->quad_count == renderer->max_quads) {
+                renderer_flush(renderer);
+            }
+            u32 run = renderer->max_quads - renderer->quad_count;
+            if (run > count) {
+                run = count;
+            }
+
+            if (renderer->vertex_format == RendererVertexFormat_Compact) {
+                generate_sprite_vertices_compact(
+                    (CompactVertex*)renderer->batch_base +
+                        renderer->quad_count * 4,
+                    w,
+                    h,
+                    region_uvs,
+                    x,
+                    y,
+                    region,
+                    tint,
+                    run
+                );
+            } else {
+                generate_sprite_vertices(
+                    (f32*)((Vertex*)renderer->batch_base +
+                           renderer->quad_count * 4),
+                    w,
+                    h,
+                    region_uvs,
+                    x,
+                    y,
+                    region,
+                    tint,
+                    run
+                );
+            }
+
+            if (renderer->layer_stride) {
+                renderer_tag_layers(renderer, renderer->quad_count, run);
+            }
+            renderer->quad_count += run;
+            x += run;
+            y += run;
+            region += run;
+            tint += run;
+            count -= run;
+        }
+        return;
+    }
+
+    for (u32 i = 0; i < count; i++) {
+        const f32* region_uv = region_uvs + region[i] * 4;
+        f32 uv[4] = {region_uv[0], region_uv[1], region_uv[2], region_uv[3]};
+        if (remap_entry) {
+            atlas_entry_remap(remap_entry, uv);
+        }
+        renderer_push_quad(
+            renderer,
+            x[i],
+            y[i],
+            w,
+            h,
+            uv[0],
+            uv[1],
+            uv[2],
+            uv[3],
+            tint[i]
+        );
+    }
+}
+
+// Expand sprites straight into a static layer's memory by pointing the
+// batch at it, as the GL renderer does with its staging memory
+b32 renderer_update_static_layer(
+    Renderer* renderer,
+    u32 layer_index,
+    u32 capacity,
+    u32 texture_id,
+    f32 w,
+    f32 h,
+    const f32* region_uvs,
+    u32 region_count,
+    u32 first,
+    const f32* x,
+    const f32* y,
+    const u16* region,
+    const Color* tint,
+    u32 count
+) {
+    if (layer_index >= RENDERER_MAX_STATIC_LAYERS) {
+        return false;
+    }
+    StaticLayer* layer = &renderer->static_layers[layer_index];
+    if (!layer->quads && capacity > 0) {
+        layer->quads =
+            (u8*)platform_alloc((usize)capacity * renderer->quad_stride);
+        if (renderer->layer_stride) {
+            layer->layers = (u16*)platform_alloc(
+                (usize)capacity * renderer->layer_stride
+            );
+        }
+        layer->capacity = layer->quads ? capacity : 0;
+    }
+    if (!layer->quads || capacity != layer->capacity ||
+        first > layer->capacity || count > layer->capacity - first) {
+        return false;
+    }
+    layer->texture_id = texture_id;
+    renderer_use_texture(renderer, texture_id);
+
+    u8* batch_base = renderer->batch_base;
+    u16* batch_layers = renderer->batch_layers;
+    u32 max_quads = renderer->max_quads;
+    u32 quad_count = renderer->quad_count;
+    renderer->batch_base =
+        layer->quads + (usize)first * renderer->quad_stride;
+    if (layer->layers) {
+        u32 per_quad = renderer->layer_stride / sizeof(u16);
+        renderer->batch_layers = layer->layers + (usize)first * per_quad;
+    }
+    renderer->max_quads = count;
+    renderer->quad_count = 0;
+
+    renderer_draw_atlas_sprite_batch(
+        renderer,
+        texture_id,
+        w,
+        h,
+        region_uvs,
+        region_count,
+        x,
+        y,
+        region,
+        tint,
+        count
+    );
+    ASSERT(renderer->quad_count == count);
+
+    renderer->batch_base = batch_base;
+    renderer->batch_layers = batch_layers;
+    renderer->max_quads = max_quads;
+    renderer->quad_count = quad_count;
+    renderer->stats.bytes_uploaded +=
+        (u64)count * (renderer->quad_stride + renderer->layer_stride);
+    return true;
+}
+
+void renderer_draw_static_layer(
+    Renderer* renderer,
+    u32 layer_index,
+    u32 first,
+    u32 count,
+    f32 offset_x,
+    f32 offset_y
+) {
+    (void)offset_x;
+    (void)offset_y;
+    if (layer_index >= RENDERER_MAX_STATIC_LAYERS) {
+        return;
+    }
+    StaticLayer* layer = &renderer->static_layers[layer_index];
+    if (first > layer->capacity) {
+        first = layer->capacity;
+    }
+    if (count > layer->capacity - first) {
+        count = layer->capacity - first;
+    }
+    if (!layer->quads || count == 0) {
+        return;
+    }
+    renderer_use_texture(renderer, layer->texture_id);
+    renderer_flush(renderer);
+    if (renderer->batch_mode == RendererBatchMode_Vertices) {
+        renderer->stats.draw_calls +=
+            (count + renderer->max_quads - 1) / renderer->max_quads;
+    } else {
+        renderer->stats.draw_calls++;
+    }
+    renderer->stats.quads += count;
+}
+
+// No driver limit to honor; GL guarantees more layers than a pool takes
+static b32 renderer_pool_texture(
+    Renderer* r,
+    PooledTexture* out,
+    i32 width,
+    i32 height,
+    i32 channels
+) {
+    return texture_pool_place(
+        r->pools,
+        &r->pool_count,
+        TEXTURE_POOL_MAX_LAYERS,
+        width,
+        height,
+        channels,
+        out
+    );
+}
+
+// Whether a static layer has been written with texture_id's placement
+static b32 renderer_static_layers_use(Renderer* r, u32 texture_id) {
+    for (u32 i = 0; i < RENDERER_MAX_STATIC_LAYERS; i++) {
+        StaticLayer* layer = &r->static_layers[i];
+        if (layer->quads && layer->texture_id == texture_id) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static b32 renderer_atlas_texture(
+    Renderer* r,
+    u32 texture_id,
+    i32 width,
+    i32 height
+) {
+    u32 x = 0;
+    u32 y = 0;
+    u32 page_index =
+        atlas_pack(r->atlas_pages, r->atlas_page_count, width, height, &x, &y);
+
+    if (page_index == r->atlas_page_count) {
+        if (r->atlas_page_count >= MAX_ATLAS_PAGES) {
+            return false;
+        }
+        AtlasPage* page = &r->atlas_pages[r->atlas_page_count];
+        *page = {};
+        if (r->texture_arrays &&
+            !renderer_pool_texture(
+                r,
+                &page->pooled,
+                ATLAS_PAGE_SIZE,
+                ATLAS_PAGE_SIZE,
+                4
+            )) {
+            return false;
+        }
+        atlas_page_init(page, &r->atlas_arena);
+        r->atlas_page_count++;
+
+        // The white texture moves onto the first page unless a static layer
+        // draws with it, as in the GL renderer
+        if (!r->texture_arrays && page_index == 0 &&
+            !renderer_static_layers_use(r, 0)) {
+            renderer_atlas_texture(r, 0, 1, 1);
+        }
+
+        b32 packed = atlas_page_pack(page, width, height, &x, &y);
+        ASSERT(packed);
+        (void)packed;
+    }
+
+    r->pooled_textures[texture_id] = r->atlas_pages[page_index].pooled;
+    r->texture_bindings[texture_id] = MAX_TEXTURES + page_index;
+
+    atlas_entry_place(
+        &r->atlas_entries[texture_id],
+        page_index,
+        x,
+        y,
+        width,
+        height
+    );
+    return true;
+}
+
+u32 renderer_create_texture(
+    Renderer* renderer,
+    i32 width,
+    i32 height,
+    i32 channels
+) {
+    if (renderer->texture_count >= MAX_TEXTURES) {
+        return 0;
+    }
+    u32 texture_id = renderer->texture_count;
+    renderer->texture_extents[texture_id] = {width, height, channels};
+    renderer->texture_bindings[texture_id] = texture_id;
+    renderer->atlas_entries[texture_id].page = ATLAS_PAGE_NONE;
+
+    if (renderer->texture_atlas && atlas_accepts(width, height, channels) &&
+        renderer_atlas_texture(renderer, texture_id, width, height)) {
+        renderer->texture_count++;
+        return texture_id;
+    }
+
+    if (renderer->texture_arrays &&
+        !renderer_pool_texture(
+            renderer,
+            &renderer->pooled_textures[texture_id],
+            width,
+            height,
+            channels
+        )) {
+        return 0;
+    }
+
+    renderer->texture_count++;
+    return texture_id;
+}
+
+u32 renderer_load_texture(
+    Renderer* renderer,
+    const void* pixels,
+    i32 width,
+    i32 height,
+    i32 channels
+) {
+    (void)pixels;
+    return renderer_create_texture(renderer, width, height, channels);
+}
+
+usize renderer_texture_upload_available(Renderer* renderer) {
+    usize start = (renderer->texture_upload_used + (STREAM_ALIGNMENT - 1)) &
+                  ~(usize)(STREAM_ALIGNMENT - 1);
+    return (start < renderer->texture_upload_budget)
+               ? renderer->texture_upload_budget - start
+               : 0;
+}
+
+b32 renderer_upload_texture_rows(
+    Renderer* renderer,
+    u32 texture_id,
+    const void* rows,
+    i32 first_row,
+    i32 row_count
+) {
+    (void)rows;
+    ASSERT(texture_id > 0 && texture_id < renderer->texture_count);
+    TextureExtent* extent = &renderer->texture_extents[texture_id];
+    ASSERT(first_row >= 0 && first_row + row_count <= extent->height);
+    usize bytes = (usize)extent->width * (usize)extent->channels *
+                  (usize)row_count;
+    usize available = renderer_texture_upload_available(renderer);
+    if (bytes == 0 || bytes > available) {
+        return false;
+    }
+
+    // Start where the GL ring would, at the aligned end of the last upload
+    renderer->texture_upload_used =
+        renderer->texture_upload_budget - available + bytes;
+    renderer->stats.bytes_uploaded += bytes;
+    return true;
+}
+
+void renderer_set_clear_color(Renderer* renderer, Color color) {
+    (void)renderer;
+    (void)color;
+}
+
+void renderer_set_blend_mode(Renderer* renderer, RendererBlendMode mode) {
+    if (renderer->current_blend_mode == mode) {
+        return;
+    }
+    renderer_flush(renderer);
+    renderer->current_blend_mode = mode;
+}
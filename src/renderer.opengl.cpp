@@ -12,25 +12,58 @@
 #include <GL/glext.h>
 #endif
 
+#include "game_interface.h"
+#include "platform/file_map.h"
+#include "platform/memory.h"
 #include "renderer.h"
 #include "util/loader.opengl.h"
+#include "util/sprite_vertices.h"
+#include "util/texture_placement.h"
 #include <print>
+#include <stdio.h>
+#include <string.h>
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
 
 using std::println;
 
-#define MAX_QUADS 10000
-#define MAX_VERTICES (MAX_QUADS * 4)
-#define MAX_INDICES (MAX_QUADS * 6)
 #define MAX_TEXTURES 256
 
-// Base resolution (safe zone - always visible)
-#define BASE_WIDTH 320
-#define BASE_HEIGHT 180
+// Set to 1 to check the SIMD sprite vertex kernel against the scalar
+// reference on every batch
+#ifndef RENDERER_VALIDATE_KERNELS
+#define RENDERER_VALIDATE_KERNELS 0
+#endif
+
+// Streaming ring: one region per in-flight frame so the CPU never writes into
+// memory the GPU may still be reading
+#define STREAM_REGION_COUNT 3
+#define STREAM_ALIGNMENT 16
+
+// Static layer updates are expanded this many sprites at a time into
+// staging memory and copied into the layer's buffer
+#define STATIC_LAYER_UPLOAD_QUADS 4096
+
+// Program binary cache entries are "<dir>/<program>-<key>.bin": this header,
+// then the driver's binary. The key hashes the driver strings and both
+// shader sources, so edits and driver updates miss instead of loading stale
+// binaries.
+#define SHADER_CACHE_MAGIC 0x48534752 // "RGSH"
+#define SHADER_CACHE_VERSION 1
+#define SHADER_PATH_SIZE 256
+
+struct ShaderCacheHeader {
+    u32 magic;
+    u32 version;
+    u64 key;
+    u32 binary_format;
+    u32 binary_size;
+};
 
-// Max buffer size for overscan (supports up to 1920x1080 at 5x scale)
-// This accommodates various aspect ratios without black bars
-#define MAX_TARGET_WIDTH 384
-#define MAX_TARGET_HEIGHT 216
+// Timer queries per frame. Flushes beyond this many go untimed; the last
+// query is reserved for the blit.
+#define GPU_QUERIES_PER_FRAME 64
 
 struct Vertex {
     f32 pos[2];
@@ -38,37 +71,157 @@ struct Vertex {
     f32 color[4];
 };
 
+static_assert(
+    sizeof(Vertex) == SPRITE_VERTEX_FLOATS * sizeof(f32),
+    "Vertex must match the sprite_vertices.h output layout"
+);
+static_assert(sizeof(CompactVertex) == 16, "CompactVertex must stay packed");
+
+// Per-instance record for the instanced path. The vertex shader expands each
+// instance into a quad from gl_VertexID, so one sprite costs 28 bytes of upload
+// instead of four 32-byte vertices.
+struct SpriteInstance {
+    f32 rect[4]; // x, y, w, h in target pixels
+    u16 uv[4];   // u0, v0, u1, v1 as normalized u16
+    u32 color;   // RGBA8 in memory order
+};
+
+// Ring of STREAM_REGION_COUNT regions in a single GL buffer. With
+// ARB_buffer_storage the buffer is persistently mapped and batches are written
+// straight into it; otherwise batches are staged in CPU memory and copied in
+// through an unsynchronized glMapBufferRange. Either way a fence per region
+// guarantees we only reuse a region once the GPU has finished reading it.
+//
+// The same ring serves as vertex storage (GL_ARRAY_BUFFER) and as the pixel
+// buffer texture uploads are sourced from (GL_PIXEL_UNPACK_BUFFER).
+struct StreamBuffer {
+    GLuint buffer;
+    GLenum target;
+    b32 persistent;
+    u8* mapped;  // Persistent mapping of the whole ring (persistent mode)
+    u8* staging; // CPU-side batch memory (fallback mode)
+    usize region_size;
+    u32 region_index;
+    usize region_used;
+    GLsync fences[STREAM_REGION_COUNT];
+};
+
+// Retained sprite layer: quads [0, capacity) in the batch format, followed by
+// their layer indices in texture array mode, in a buffer of its own
+struct StaticLayer {
+    GLuint buffer;
+    u32 capacity;
+    u32 texture_id; // Of the last update; drawn with
+};
+
+// Size and format of a texture id, for uploads after it is created
+struct TextureExtent {
+    i32 width;
+    i32 height;
+    i32 channels;
+};
+
 struct Renderer {
+    RendererBatchMode batch_mode;
+    RendererVertexFormat vertex_format; // Vertices batch mode only
+    b32 texture_arrays;
+    b32 texture_atlas;
+
+    StreamBuffer stream;
+    u8* batch_base;     // Write pointer for the current batch
+    usize batch_offset; // Byte offset of the current batch in the ring
+    u32 batch_capacity; // Quads that fit in the current batch
+    u32 max_quads;      // Largest batch; a ring region holds at least one
+    u32 quad_stride;    // Bytes per quad in the active batch format
+
+    // Texture array mode: layer indices (u16, per vertex or per instance) are
+    // gathered here and copied in behind the batch's quads at flush
+    u16* batch_layers;
+    u32 layer_stride; // Bytes of layer indices per quad, 0 without arrays
+
     GLuint vao;
-    GLuint vbo;
     GLuint ebo;
     GLuint shader_program;
     GLint u_resolution_loc;
+    GLint u_offset_loc;
     GLint u_texture_loc;
 
+    GLuint instanced_vao;
+    GLuint instanced_shader_program;
+    GLint instanced_u_resolution_loc;
+    GLint instanced_u_offset_loc;
+    GLint instanced_u_texture_loc;
+
     GLuint blit_vao;
     GLuint blit_vbo;
     GLuint blit_shader_program;
     GLint blit_u_texture_loc;
 
+    // Empty when unused. The cache is also off without driver support.
+    char shader_cache_dir[SHADER_PATH_SIZE];
+    char shader_source_dir[SHADER_PATH_SIZE];
+    u64 shader_driver_hash;
+    u32 shader_reload_requested; // Accessed with __atomic builtins
+
     GLuint offscreen_fbo;
     GLuint offscreen_texture;
 
     GLuint textures[MAX_TEXTURES];
+    TextureExtent texture_extents[MAX_TEXTURES];
     u32 texture_count;
 
-    u32 vertex_count;
-    u32 current_texture;
+    // Pixel buffer ring for renderer_upload_texture_rows, one region per
+    // frame in flight. A region is the frame's budget.
+    StreamBuffer uploads;
+
+    TexturePool pools[MAX_TEXTURE_POOLS];
+    GLuint pool_textures[MAX_TEXTURE_POOLS]; // Array texture of each pool
+    u32 pool_count;
+    PooledTexture pooled_textures[MAX_TEXTURES];
+    u32 max_array_layers;
+
+    // Runtime atlas. Without texture arrays an atlased texture's entry in
+    // `textures` is its page's texture, so drawing from any texture on the
+    // same page binds the same name.
+    MemoryArena atlas_arena; // Skyline nodes of every page
+    AtlasPage atlas_pages[MAX_ATLAS_PAGES];
+    GLuint atlas_page_textures[MAX_ATLAS_PAGES]; // Without texture arrays
+    u32 atlas_page_count;
+    AtlasEntry atlas_entries[MAX_TEXTURES];
+    f32 atlas_region_uvs[ATLAS_MAX_BATCH_REGIONS * 4]; // Remapped batch UVs
+
+    // Static layer updates expand through the batch code into staging
+    // memory for STATIC_LAYER_UPLOAD_QUADS quads
+    StaticLayer static_layers[RENDERER_MAX_STATIC_LAYERS];
+    u8* static_staging;
+    u16* static_staging_layers;
+
+    u32 quad_count;
+    GLuint bound_texture; // Without texture arrays
+    u32 current_pool;  // Texture array mode
+    u16 current_layer; // Texture array mode
+    RendererBlendMode current_blend_mode;
 
     f32 clear_color[4];
     u32 width;         // Window width (pixels)
     u32 height;        // Window height (pixels)
     u32 target_width;  // Current render target width (game pixels)
     u32 target_height; // Current render target height (game pixels)
+
+    // Frame counters and GPU timer queries. Frames take turns with
+    // STREAM_REGION_COUNT sets of queries, keyed by frame number rather than
+    // stream region since a busy frame streams into more than one, and read
+    // a set back when its turn comes around again.
+    RendererStats stats;      // Frame being recorded
+    RendererStats last_stats; // Last completed frame
+    u32 frame_index;
+    u32 query_slot; // frame_index % STREAM_REGION_COUNT
+    GLuint gpu_queries[STREAM_REGION_COUNT][GPU_QUERIES_PER_FRAME];
+    u32 gpu_draw_query_count[STREAM_REGION_COUNT];
+    b32 gpu_blit_query_issued[STREAM_REGION_COUNT];
 };
 
 // Static allocations
-static Vertex global_vertex_buffer[MAX_VERTICES];
 static Vertex global_blit_quad[4];
 static Renderer global_renderer = {};
 
@@ -81,6 +234,22 @@ static const char fs_source[] = {
 #embed "shaders/sprite.frag.glsl"
 };
 
+static const char instanced_vs_source[] = {
+#embed "shaders/sprite_instanced.vert.glsl"
+};
+
+static const char array_vs_source[] = {
+#embed "shaders/sprite_array.vert.glsl"
+};
+
+static const char array_fs_source[] = {
+#embed "shaders/sprite_array.frag.glsl"
+};
+
+static const char instanced_array_vs_source[] = {
+#embed "shaders/sprite_instanced_array.vert.glsl"
+};
+
 static const char blit_vs_source[] = {
 #embed "shaders/blit.vert.glsl"
 };
@@ -89,9 +258,68 @@ static const char blit_fs_source[] = {
 #embed "shaders/blit.frag.glsl"
 };
 
-static GLuint compile_shader(GLenum type, const char* source, GLint length) {
+// Every shader file, in the order of embedded_shaders
+enum ShaderFile {
+    ShaderFile_SpriteVS,
+    ShaderFile_SpriteFS,
+    ShaderFile_InstancedVS,
+    ShaderFile_ArrayVS,
+    ShaderFile_ArrayFS,
+    ShaderFile_InstancedArrayVS,
+    ShaderFile_BlitVS,
+    ShaderFile_BlitFS,
+    ShaderFile_Count,
+};
+
+struct ShaderSource {
+    const char* file; // Name under src/shaders and the source directory
+    const char* text; // Not terminated
+    GLint length;
+};
+
+static const ShaderSource embedded_shaders[ShaderFile_Count] = {
+    {"sprite.vert.glsl", vs_source, sizeof(vs_source)},
+    {"sprite.frag.glsl", fs_source, sizeof(fs_source)},
+    {"sprite_instanced.vert.glsl",
+     instanced_vs_source,
+     sizeof(instanced_vs_source)},
+    {"sprite_array.vert.glsl", array_vs_source, sizeof(array_vs_source)},
+    {"sprite_array.frag.glsl", array_fs_source, sizeof(array_fs_source)},
+    {"sprite_instanced_array.vert.glsl",
+     instanced_array_vs_source,
+     sizeof(instanced_array_vs_source)},
+    {"blit.vert.glsl", blit_vs_source, sizeof(blit_vs_source)},
+    {"blit.frag.glsl", blit_fs_source, sizeof(blit_fs_source)},
+};
+
+// Sources for one build of the programs, mapped from the source directory
+// or pointing at the embedded copies
+struct ShaderSources {
+    ShaderSource files[ShaderFile_Count];
+    PlatformFileMap maps[ShaderFile_Count];
+};
+
+// One of each program the batch modes and the blit use
+struct ShaderPrograms {
+    GLuint sprite;
+    GLuint instanced;
+    GLuint blit;
+};
+
+// FNV-1a
+#define SHADER_HASH_SEED 0xCBF29CE484222325ull
+
+static u64 shader_hash(u64 hash, const void* data, usize size) {
+    const u8* bytes = (const u8*)data;
+    for (usize i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+static GLuint compile_shader(GLenum type, const ShaderSource* source) {
     GLuint shader = gl_CreateShader(type);
-    gl_ShaderSource(shader, 1, &source, &length);
+    gl_ShaderSource(shader, 1, &source->text, &source->length);
     gl_CompileShader(shader);
 
     GLint success;
@@ -99,29 +327,42 @@ static GLuint compile_shader(GLenum type, const char* source, GLint length) {
     if (!success) {
         char log[512];
         gl_GetShaderInfoLog(shader, 512, nullptr, log);
-        println("Shader compilation failed: {}", log);
+        println("Shader compilation failed: {}: {}", source->file, log);
+        gl_DeleteShader(shader);
         return 0;
     }
     return shader;
 }
 
+// With `retrievable` the driver is asked to keep the linked binary around
+// for glGetProgramBinary
 static GLuint create_shader_program(
-    const char* vs,
-    GLint vs_len,
-    const char* fs,
-    GLint fs_len
+    const ShaderSource* vs,
+    const ShaderSource* fs,
+    b32 retrievable
 ) {
-    GLuint vertex_shader = compile_shader(GL_VERTEX_SHADER, vs, vs_len);
-    GLuint fragment_shader = compile_shader(GL_FRAGMENT_SHADER, fs, fs_len);
+    GLuint vertex_shader = compile_shader(GL_VERTEX_SHADER, vs);
+    GLuint fragment_shader = compile_shader(GL_FRAGMENT_SHADER, fs);
 
     if (!vertex_shader || !fragment_shader) {
+        gl_DeleteShader(vertex_shader);
+        gl_DeleteShader(fragment_shader);
         return 0;
     }
 
     GLuint program = gl_CreateProgram();
+    if (retrievable) {
+        gl_ProgramParameteri(
+            program,
+            GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+            GL_TRUE
+        );
+    }
     gl_AttachShader(program, vertex_shader);
     gl_AttachShader(program, fragment_shader);
     gl_LinkProgram(program);
+    gl_DeleteShader(vertex_shader);
+    gl_DeleteShader(fragment_shader);
 
     GLint success;
     gl_GetProgramiv(program, GL_LINK_STATUS, &success);
@@ -129,63 +370,497 @@ static GLuint create_shader_program(
         char log[512];
         gl_GetProgramInfoLog(program, 512, nullptr, log);
         println("Shader linking failed: {}", log);
+        gl_DeleteProgram(program);
         return 0;
     }
 
-    gl_DeleteShader(vertex_shader);
-    gl_DeleteShader(fragment_shader);
+    return program;
+}
+
+// Map every shader file from the source directory, falling back to the
+// embedded copy of any that can't be read
+static void renderer_read_shader_sources(
+    Renderer* r,
+    ShaderSources* sources,
+    b32 use_source_dir
+) {
+    for (u32 i = 0; i < ShaderFile_Count; i++) {
+        sources->files[i] = embedded_shaders[i];
+        sources->maps[i] = {};
+        if (!use_source_dir || !r->shader_source_dir[0]) {
+            continue;
+        }
+        char path[SHADER_PATH_SIZE * 2];
+        snprintf(
+            path,
+            sizeof(path),
+            "%s/%s",
+            r->shader_source_dir,
+            embedded_shaders[i].file
+        );
+        PlatformFileMap* map = &sources->maps[i];
+        if (platform_map_file(path, map)) {
+            sources->files[i].text = (const char*)map->data;
+            sources->files[i].length = (GLint)map->size;
+        } else {
+            println("Failed to read {}, using the built-in copy", path);
+        }
+    }
+}
+
+static void renderer_release_shader_sources(ShaderSources* sources) {
+    for (u32 i = 0; i < ShaderFile_Count; i++) {
+        platform_unmap_file(&sources->maps[i]);
+    }
+}
 
+// Link a program from its cache entry. Returns 0 if there is none, it is
+// malformed, or the driver no longer takes the binary.
+static GLuint shader_cache_load(const char* path, u64 key) {
+    PlatformFileMap file;
+    if (!platform_map_file(path, &file)) {
+        return 0;
+    }
+    const ShaderCacheHeader* header = (const ShaderCacheHeader*)file.data;
+    GLuint program = 0;
+    if (file.size >= sizeof(ShaderCacheHeader) &&
+        header->magic == SHADER_CACHE_MAGIC &&
+        header->version == SHADER_CACHE_VERSION && header->key == key &&
+        header->binary_size == file.size - sizeof(ShaderCacheHeader)) {
+        program = gl_CreateProgram();
+        gl_ProgramBinary(
+            program,
+            header->binary_format,
+            header + 1,
+            (GLsizei)header->binary_size
+        );
+        GLint success;
+        gl_GetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success) {
+            gl_DeleteProgram(program);
+            program = 0;
+        }
+    }
+    platform_unmap_file(&file);
     return program;
 }
 
-Renderer* renderer_init(void) {
+// Write a linked program's binary to its cache entry. The entry is written
+// aside and renamed into place, so a reader never sees half of one.
+static void shader_cache_store(const char* path, u64 key, GLuint program) {
+    GLint size = 0;
+    gl_GetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+    if (size <= 0) {
+        return;
+    }
+    usize capacity = sizeof(ShaderCacheHeader) + (usize)size;
+    u8* memory = (u8*)platform_alloc(capacity);
+    if (!memory) {
+        return;
+    }
+    ShaderCacheHeader* header = (ShaderCacheHeader*)memory;
+    GLsizei length = 0;
+    GLenum format = 0;
+    gl_GetProgramBinary(program, size, &length, &format, header + 1);
+    header->magic = SHADER_CACHE_MAGIC;
+    header->version = SHADER_CACHE_VERSION;
+    header->key = key;
+    header->binary_format = format;
+    header->binary_size = (u32)length;
+
+    char temp_path[SHADER_PATH_SIZE * 2 + 4];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+    FILE* file = fopen(temp_path, "wb");
+    b32 written = file && length > 0 &&
+                  fwrite(
+                      memory,
+                      sizeof(ShaderCacheHeader) + (usize)length,
+                      1,
+                      file
+                  ) == 1;
+    if (file && fclose(file) != 0) {
+        written = false;
+    }
+    // rename won't replace an existing file on Windows
+    remove(path);
+    if (!written || rename(temp_path, path) != 0) {
+        remove(temp_path);
+        println("Failed to write shader cache entry {}", path);
+    }
+    platform_free(memory, capacity);
+}
+
+// Link a program from the cache if it has these sources for this driver,
+// and compile and cache it otherwise
+static GLuint renderer_build_program(
+    Renderer* r,
+    const char* name,
+    const ShaderSource* vs,
+    const ShaderSource* fs,
+    u32* cache_hits
+) {
+    b32 cached = r->shader_cache_dir[0] != 0;
+    char path[SHADER_PATH_SIZE * 2];
+    u64 key = r->shader_driver_hash;
+    if (cached) {
+        key = shader_hash(key, &vs->length, sizeof(vs->length));
+        key = shader_hash(key, vs->text, (usize)vs->length);
+        key = shader_hash(key, &fs->length, sizeof(fs->length));
+        key = shader_hash(key, fs->text, (usize)fs->length);
+        snprintf(
+            path,
+            sizeof(path),
+            "%s/%s-%016llx.bin",
+            r->shader_cache_dir,
+            name,
+            (unsigned long long)key
+        );
+        GLuint program = shader_cache_load(path, key);
+        if (program) {
+            (*cache_hits)++;
+            return program;
+        }
+    }
+
+    GLuint program = create_shader_program(vs, fs, cached);
+    if (program && cached) {
+        shader_cache_store(path, key, program);
+    }
+    return program;
+}
+
+// Build every program, all or none. Texture array mode swaps in shader
+// variants that take a layer index at attribute 3 and sample a
+// sampler2DArray; uniforms are the same.
+static b32 renderer_build_programs(
+    Renderer* r,
+    ShaderPrograms* programs,
+    b32 use_source_dir
+) {
+    ShaderSources sources;
+    renderer_read_shader_sources(r, &sources, use_source_dir);
+    const ShaderSource* files = sources.files;
+    b32 arrays = r->texture_arrays;
+    const ShaderSource* sprite_vs =
+        &files[arrays ? ShaderFile_ArrayVS : ShaderFile_SpriteVS];
+    const ShaderSource* instanced_vs =
+        &files[arrays ? ShaderFile_InstancedArrayVS : ShaderFile_InstancedVS];
+    const ShaderSource* sprite_fs =
+        &files[arrays ? ShaderFile_ArrayFS : ShaderFile_SpriteFS];
+
+    // The instanced program shares the sprite fragment shader
+    u32 cache_hits = 0;
+    programs->sprite = renderer_build_program(
+        r,
+        arrays ? "sprite_array" : "sprite",
+        sprite_vs,
+        sprite_fs,
+        &cache_hits
+    );
+    programs->instanced = renderer_build_program(
+        r,
+        arrays ? "sprite_instanced_array" : "sprite_instanced",
+        instanced_vs,
+        sprite_fs,
+        &cache_hits
+    );
+    programs->blit = renderer_build_program(
+        r,
+        "blit",
+        &files[ShaderFile_BlitVS],
+        &files[ShaderFile_BlitFS],
+        &cache_hits
+    );
+    renderer_release_shader_sources(&sources);
+
+    if (!programs->sprite || !programs->instanced || !programs->blit) {
+        gl_DeleteProgram(programs->sprite);
+        gl_DeleteProgram(programs->instanced);
+        gl_DeleteProgram(programs->blit);
+        *programs = {};
+        return false;
+    }
+    if (r->shader_cache_dir[0]) {
+        println("Shader programs: {} of 3 from the cache", cache_hits);
+    }
+    return true;
+}
+
+// Replace the current programs and look up their uniforms
+static void
+renderer_use_programs(Renderer* r, const ShaderPrograms* programs) {
+    gl_DeleteProgram(r->shader_program);
+    gl_DeleteProgram(r->instanced_shader_program);
+    gl_DeleteProgram(r->blit_shader_program);
+
+    r->shader_program = programs->sprite;
+    r->u_resolution_loc =
+        gl_GetUniformLocation(r->shader_program, "u_resolution");
+    r->u_offset_loc = gl_GetUniformLocation(r->shader_program, "u_offset");
+    r->u_texture_loc = gl_GetUniformLocation(r->shader_program, "u_texture");
+
+    r->instanced_shader_program = programs->instanced;
+    r->instanced_u_resolution_loc =
+        gl_GetUniformLocation(r->instanced_shader_program, "u_resolution");
+    r->instanced_u_offset_loc =
+        gl_GetUniformLocation(r->instanced_shader_program, "u_offset");
+    r->instanced_u_texture_loc =
+        gl_GetUniformLocation(r->instanced_shader_program, "u_texture");
+
+    r->blit_shader_program = programs->blit;
+    r->blit_u_texture_loc =
+        gl_GetUniformLocation(r->blit_shader_program, "u_texture");
+}
+
+// Turn on the program cache if the driver can hand out binaries, keyed by
+// its identity
+static void renderer_init_shader_cache(Renderer* r, const char* directory) {
+    r->shader_cache_dir[0] = 0;
+    GLint formats = 0;
+    if (gl_ProgramBinary && gl_GetProgramBinary && gl_ProgramParameteri) {
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    }
+    if (!directory || strlen(directory) >= SHADER_PATH_SIZE) {
+        return;
+    }
+    if (formats <= 0) {
+        println("Shader cache off: the driver has no program binaries");
+        return;
+    }
+    strcpy(r->shader_cache_dir, directory);
+#ifdef _WIN32
+    CreateDirectoryA(directory, nullptr);
+#else
+    mkdir(directory, 0755);
+#endif
+
+    const GLenum names[] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+    u64 hash = SHADER_HASH_SEED;
+    for (u32 i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        const char* string = (const char*)glGetString(names[i]);
+        if (string) {
+            hash = shader_hash(hash, string, strlen(string) + 1);
+        }
+    }
+    r->shader_driver_hash = hash;
+}
+
+static void stream_buffer_init(
+    StreamBuffer* sb,
+    GLenum target,
+    usize region_size,
+    const char* name
+) {
+    *sb = {};
+    sb->target = target;
+    sb->region_size = region_size;
+    usize total_size = region_size * STREAM_REGION_COUNT;
+
+    gl_GenBuffers(1, &sb->buffer);
+    gl_BindBuffer(target, sb->buffer);
+
+    if (gl_BufferStorage && gl_has_extension("GL_ARB_buffer_storage")) {
+        GLbitfield flags =
+            GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        gl_BufferStorage(target, total_size, nullptr, flags);
+        sb->mapped = (u8*)gl_MapBufferRange(target, 0, total_size, flags);
+        sb->persistent = (sb->mapped != nullptr);
+    }
+
+    if (!sb->persistent) {
+        gl_BufferData(target, total_size, nullptr, GL_STREAM_DRAW);
+        sb->staging = (u8*)platform_alloc(region_size);
+    }
+
+    // A bound unpack buffer would turn client pointers into offsets
+    if (target == GL_PIXEL_UNPACK_BUFFER) {
+        gl_BindBuffer(target, 0);
+    }
+
+    println(
+        "{}: {} x {} KB ({})",
+        name,
+        STREAM_REGION_COUNT,
+        region_size / 1024,
+        sb->persistent ? "persistent mapped" : "unsynchronized map"
+    );
+}
+
+// Fence the region we are leaving and move to the next one, waiting until the
+// GPU is done with whatever the ring last put there
+static void stream_buffer_next_region(StreamBuffer* sb) {
+    if (sb->region_used > 0) {
+        sb->fences[sb->region_index] =
+            gl_FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    sb->region_index = (sb->region_index + 1) % STREAM_REGION_COUNT;
+    sb->region_used = 0;
+
+    GLsync fence = sb->fences[sb->region_index];
+    if (fence) {
+        GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        for (;;) {
+            GLenum status = gl_ClientWaitSync(fence, flags, 1000000);
+            if (status == GL_ALREADY_SIGNALED ||
+                status == GL_CONDITION_SATISFIED || status == GL_WAIT_FAILED) {
+                break;
+            }
+            flags = 0;
+        }
+        gl_DeleteSync(fence);
+        sb->fences[sb->region_index] = nullptr;
+    }
+}
+
+// Start a batch in the current region, moving on if less than one quad fits.
+// Returns the write pointer and the batch's byte offset in the ring.
+static u8* stream_buffer_begin_batch(
+    StreamBuffer* sb,
+    usize min_bytes,
+    usize* out_offset,
+    usize* out_available
+) {
+    usize start = (sb->region_used + (STREAM_ALIGNMENT - 1)) &
+                  ~(usize)(STREAM_ALIGNMENT - 1);
+    if (start + min_bytes > sb->region_size) {
+        stream_buffer_next_region(sb);
+        start = 0;
+    }
+
+    usize offset = sb->region_index * sb->region_size + start;
+    *out_offset = offset;
+    *out_available = sb->region_size - start;
+    sb->region_used = start;
+
+    return sb->persistent ? sb->mapped + offset : sb->staging;
+}
+
+// Make `bytes` written at the batch pointer visible to the GPU
+static void
+stream_buffer_end_batch(StreamBuffer* sb, usize offset, usize bytes) {
+    if (!sb->persistent) {
+        gl_BindBuffer(sb->target, sb->buffer);
+        GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+                            GL_MAP_UNSYNCHRONIZED_BIT;
+        void* dest = gl_MapBufferRange(sb->target, offset, bytes, access);
+        if (dest) {
+            memcpy(dest, sb->staging, bytes);
+            gl_UnmapBuffer(sb->target);
+        }
+    }
+    sb->region_used += bytes;
+}
+
+Renderer* renderer_init(const RendererConfig* config) {
     Renderer* r = &global_renderer;
 
-    r->vertex_count = 0;
-    r->current_texture = 0;
+    r->batch_mode = config->batch_mode;
+    r->vertex_format = config->vertex_format;
+    r->texture_arrays = config->texture_arrays;
+    r->texture_atlas = config->texture_atlas;
+    r->max_quads = config->max_quads ? config->max_quads
+                                     : RENDERER_DEFAULT_MAX_QUADS;
+    r->quad_count = 0;
+    r->bound_texture = 0;
+    r->current_pool = TEXTURE_POOL_NONE;
     r->texture_count = 0;
     r->clear_color[0] = 0.0f;
     r->clear_color[1] = 0.0f;
     r->clear_color[2] = 0.0f;
     r->clear_color[3] = 1.0f;
 
-    // Create main shader program
-    r->shader_program = create_shader_program(
-        vs_source,
-        sizeof(vs_source),
-        fs_source,
-        sizeof(fs_source)
-    );
-    r->u_resolution_loc =
-        gl_GetUniformLocation(r->shader_program, "u_resolution");
-    r->u_texture_loc = gl_GetUniformLocation(r->shader_program, "u_texture");
+    if (r->texture_arrays) {
+        GLint max_layers = 0;
+        glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &max_layers);
+        r->max_array_layers = (max_layers > 0) ? (u32)max_layers : 256;
+    }
 
-    // Create blit shader program
-    r->blit_shader_program = create_shader_program(
-        blit_vs_source,
-        sizeof(blit_vs_source),
-        blit_fs_source,
-        sizeof(blit_fs_source)
+    // Build the shader programs, falling back to the built-in sources if
+    // the source directory's don't compile
+    renderer_init_shader_cache(r, config->shader_cache_dir);
+    r->shader_source_dir[0] = 0;
+    if (config->shader_source_dir &&
+        strlen(config->shader_source_dir) < SHADER_PATH_SIZE) {
+        strcpy(r->shader_source_dir, config->shader_source_dir);
+    }
+    ShaderPrograms programs = {};
+    if (!renderer_build_programs(r, &programs, true) &&
+        r->shader_source_dir[0]) {
+        println("Shader sources failed, using the built-in copies");
+        renderer_build_programs(r, &programs, false);
+    }
+    renderer_use_programs(r, &programs);
+
+    // Streaming ring shared by both batch formats; each region holds a
+    // frame's budget of batches, layer indices included, and at least one
+    // full batch. Attribute pointers are set per batch in renderer_flush.
+    if (r->batch_mode == RendererBatchMode_Instanced) {
+        r->quad_stride = sizeof(SpriteInstance);
+    } else if (r->vertex_format == RendererVertexFormat_Compact) {
+        r->quad_stride = 4 * sizeof(CompactVertex);
+    } else {
+        r->quad_stride = 4 * sizeof(Vertex);
+    }
+    if (r->texture_arrays) {
+        u32 layers_per_quad =
+            (r->batch_mode == RendererBatchMode_Instanced) ? 1 : 4;
+        r->layer_stride = layers_per_quad * sizeof(u16);
+        r->batch_layers =
+            (u16*)platform_alloc((usize)r->max_quads * r->layer_stride);
+        r->static_staging_layers = (u16*)platform_alloc(
+            (usize)STATIC_LAYER_UPLOAD_QUADS * r->layer_stride
+        );
+    }
+    r->static_staging = (u8*)platform_alloc(
+        (usize)STATIC_LAYER_UPLOAD_QUADS * r->quad_stride
+    );
+    usize batch_bytes =
+        (usize)r->max_quads * (r->quad_stride + r->layer_stride);
+    usize stream_budget = config->stream_budget
+                              ? config->stream_budget
+                              : RENDERER_DEFAULT_STREAM_BUDGET;
+    stream_buffer_init(
+        &r->stream,
+        GL_ARRAY_BUFFER,
+        (stream_budget > batch_bytes) ? stream_budget : batch_bytes,
+        "Stream buffer"
+    );
+    stream_buffer_init(
+        &r->uploads,
+        GL_PIXEL_UNPACK_BUFFER,
+        config->texture_upload_budget ? config->texture_upload_budget
+                                      : RENDERER_DEFAULT_TEXTURE_UPLOAD_BUDGET,
+        "Texture upload buffer"
     );
-    r->blit_u_texture_loc =
-        gl_GetUniformLocation(r->blit_shader_program, "u_texture");
+
+    // Texture rows are tightly packed, whatever their width and format
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    if (r->texture_atlas) {
+        void* atlas_memory = platform_alloc(ATLAS_ARENA_SIZE);
+        if (!atlas_memory) {
+            return nullptr;
+        }
+        r->atlas_arena = MemoryArena::make(atlas_memory, ATLAS_ARENA_SIZE);
+    }
+
+    for (u32 i = 0; i < STREAM_REGION_COUNT; i++) {
+        gl_GenQueries(GPU_QUERIES_PER_FRAME, r->gpu_queries[i]);
+    }
 
     // Create VAO and buffers for sprite rendering
     gl_GenVertexArrays(1, &r->vao);
     gl_BindVertexArray(r->vao);
 
-    gl_GenBuffers(1, &r->vbo);
-    gl_BindBuffer(GL_ARRAY_BUFFER, r->vbo);
-    gl_BufferData(
-        GL_ARRAY_BUFFER,
-        MAX_VERTICES * sizeof(Vertex),
-        nullptr,
-        GL_DYNAMIC_DRAW
-    );
-
-    // Build index buffer
-    u16 indices[MAX_INDICES];
-    for (u32 i = 0; i < MAX_QUADS; i++) {
+    // Build a 32-bit index buffer so a batch is not capped at 16k quads. The
+    // instanced path draws without indices; it only needs the first quad for
+    // the blit.
+    u32 index_quads =
+        (r->batch_mode == RendererBatchMode_Vertices) ? r->max_quads : 1;
+    usize indices_size = (usize)index_quads * 6 * sizeof(u32);
+    u32* indices = (u32*)platform_alloc(indices_size);
+    for (u32 i = 0; i < index_quads; i++) {
         indices[i * 6 + 0] = i * 4 + 0;
         indices[i * 6 + 1] = i * 4 + 1;
         indices[i * 6 + 2] = i * 4 + 2;
@@ -198,39 +873,38 @@ Renderer* renderer_init(void) {
     gl_BindBuffer(GL_ELEMENT_ARRAY_BUFFER, r->ebo);
     gl_BufferData(
         GL_ELEMENT_ARRAY_BUFFER,
-        sizeof(indices),
+        indices_size,
         indices,
         GL_STATIC_DRAW
     );
+    platform_free(indices, indices_size);
 
-    // Vertex attributes: pos, uv, color
-    gl_VertexAttribPointer(
-        0,
-        2,
-        GL_FLOAT,
-        GL_FALSE,
-        sizeof(Vertex),
-        (void*)offsetof(Vertex, pos)
-    );
+    // Vertex attributes: pos, uv, color (and layer)
     gl_EnableVertexAttribArray(0);
-    gl_VertexAttribPointer(
-        1,
-        2,
-        GL_FLOAT,
-        GL_FALSE,
-        sizeof(Vertex),
-        (void*)offsetof(Vertex, uv)
-    );
     gl_EnableVertexAttribArray(1);
-    gl_VertexAttribPointer(
-        2,
-        4,
-        GL_FLOAT,
-        GL_FALSE,
-        sizeof(Vertex),
-        (void*)offsetof(Vertex, color)
-    );
     gl_EnableVertexAttribArray(2);
+    if (r->texture_arrays) {
+        gl_EnableVertexAttribArray(3);
+    }
+
+    gl_BindVertexArray(0);
+
+    // Create VAO and buffers for instanced sprite rendering. No index buffer:
+    // each instance is drawn as a 4-vertex triangle strip.
+    gl_GenVertexArrays(1, &r->instanced_vao);
+    gl_BindVertexArray(r->instanced_vao);
+
+    // Instance attributes: rect, uv rect, color (advance once per instance)
+    gl_EnableVertexAttribArray(0);
+    gl_VertexAttribDivisor(0, 1);
+    gl_EnableVertexAttribArray(1);
+    gl_VertexAttribDivisor(1, 1);
+    gl_EnableVertexAttribArray(2);
+    gl_VertexAttribDivisor(2, 1);
+    if (r->texture_arrays) {
+        gl_EnableVertexAttribArray(3);
+        gl_VertexAttribDivisor(3, 1);
+    }
 
     gl_BindVertexArray(0);
 
@@ -299,9 +973,12 @@ Renderer* renderer_init(void) {
         GL_UNSIGNED_BYTE,
         &white_pixel
     );
+    r->texture_extents[0] = {1, 1, 4};
+    r->atlas_entries[0].page = ATLAS_PAGE_NONE;
     r->texture_count = 1;
 
-    // Create offscreen render target at max size for overscan
+    // Create offscreen render target at the largest size
+    // platform_target_size picks; frames render into its top-left corner
     glGenTextures(1, &r->offscreen_texture);
     glBindTexture(GL_TEXTURE_2D, r->offscreen_texture);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -312,8 +989,8 @@ Renderer* renderer_init(void) {
         GL_TEXTURE_2D,
         0,
         GL_RGBA8,
-        MAX_TARGET_WIDTH,
-        MAX_TARGET_HEIGHT,
+        GAME_MAX_TARGET_WIDTH,
+        GAME_MAX_TARGET_HEIGHT,
         0,
         GL_RGBA,
         GL_UNSIGNED_BYTE,
@@ -345,6 +1022,182 @@ Renderer* renderer_init(void) {
     return r;
 }
 
+const char* renderer_shader_file(u32 index) {
+    return (index < ShaderFile_Count) ? embedded_shaders[index].file : nullptr;
+}
+
+void renderer_reload_shaders(Renderer* renderer) {
+    __atomic_store_n(&renderer->shader_reload_requested, 1u, __ATOMIC_RELEASE);
+}
+
+static void renderer_begin_batch(Renderer* r) {
+    usize available = 0;
+    u32 quad_bytes = r->quad_stride + r->layer_stride;
+    r->batch_base = stream_buffer_begin_batch(
+        &r->stream,
+        quad_bytes,
+        &r->batch_offset,
+        &available
+    );
+    r->batch_capacity = (u32)(available / quad_bytes);
+    if (r->batch_capacity > r->max_quads) {
+        r->batch_capacity = r->max_quads;
+    }
+    r->quad_count = 0;
+}
+
+// Point the bound VAO's attributes at quads in the batch format starting at
+// byte `base` of `buffer`, with their layer indices (if any) at layer_base
+static void renderer_bind_quad_attributes(
+    Renderer* r,
+    GLuint buffer,
+    usize base,
+    usize layer_base
+) {
+    gl_BindBuffer(GL_ARRAY_BUFFER, buffer);
+
+    switch (r->batch_mode) {
+        case RendererBatchMode_Vertices: {
+            if (r->vertex_format == RendererVertexFormat_Compact) {
+                gl_VertexAttribPointer(
+                    0,
+                    2,
+                    GL_FLOAT,
+                    GL_FALSE,
+                    sizeof(CompactVertex),
+                    (void*)(base + offsetof(CompactVertex, pos))
+                );
+                gl_VertexAttribPointer(
+                    1,
+                    2,
+                    GL_UNSIGNED_SHORT,
+                    GL_TRUE,
+                    sizeof(CompactVertex),
+                    (void*)(base + offsetof(CompactVertex, uv))
+                );
+                gl_VertexAttribPointer(
+                    2,
+                    4,
+                    GL_UNSIGNED_BYTE,
+                    GL_TRUE,
+                    sizeof(CompactVertex),
+                    (void*)(base + offsetof(CompactVertex, color))
+                );
+                break;
+            }
+
+            gl_VertexAttribPointer(
+                0,
+                2,
+                GL_FLOAT,
+                GL_FALSE,
+                sizeof(Vertex),
+                (void*)(base + offsetof(Vertex, pos))
+            );
+            gl_VertexAttribPointer(
+                1,
+                2,
+                GL_FLOAT,
+                GL_FALSE,
+                sizeof(Vertex),
+                (void*)(base + offsetof(Vertex, uv))
+            );
+            gl_VertexAttribPointer(
+                2,
+                4,
+                GL_FLOAT,
+                GL_FALSE,
+                sizeof(Vertex),
+                (void*)(base + offsetof(Vertex, color))
+            );
+        } break;
+
+        case RendererBatchMode_Instanced: {
+            gl_VertexAttribPointer(
+                0,
+                4,
+                GL_FLOAT,
+                GL_FALSE,
+                sizeof(SpriteInstance),
+                (void*)(base + offsetof(SpriteInstance, rect))
+            );
+            gl_VertexAttribPointer(
+                1,
+                4,
+                GL_UNSIGNED_SHORT,
+                GL_TRUE,
+                sizeof(SpriteInstance),
+                (void*)(base + offsetof(SpriteInstance, uv))
+            );
+            gl_VertexAttribPointer(
+                2,
+                4,
+                GL_UNSIGNED_BYTE,
+                GL_TRUE,
+                sizeof(SpriteInstance),
+                (void*)(base + offsetof(SpriteInstance, color))
+            );
+        } break;
+    }
+
+    if (r->layer_stride) {
+        gl_VertexAttribIPointer(
+            3,
+            1,
+            GL_UNSIGNED_SHORT,
+            sizeof(u16),
+            (void*)layer_base
+        );
+    }
+}
+
+// Point the attributes at the current batch inside the ring, whose layer
+// indices follow its quads
+static void renderer_bind_batch_attributes(Renderer* r) {
+    usize base = r->batch_offset;
+    renderer_bind_quad_attributes(
+        r,
+        r->stream.buffer,
+        base,
+        base + (usize)r->quad_count * r->quad_stride
+    );
+}
+
+// Read back the timer queries a slot's previous frame issued. That frame is
+// STREAM_REGION_COUNT frames old, so the results are normally in; if not,
+// the times are skipped rather than stalling.
+static void renderer_collect_gpu_times(Renderer* r, u32 slot) {
+    GLuint* queries = r->gpu_queries[slot];
+    u32 draw_count = r->gpu_draw_query_count[slot];
+    b32 blit_issued = r->gpu_blit_query_issued[slot];
+    r->gpu_draw_query_count[slot] = 0;
+    r->gpu_blit_query_issued[slot] = false;
+
+    if (!blit_issued) {
+        return;
+    }
+
+    // Queries complete in order, so the blit (issued last) stands for all
+    GLuint blit_query = queries[GPU_QUERIES_PER_FRAME - 1];
+    GLint available = 0;
+    gl_GetQueryObjectiv(blit_query, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+        return;
+    }
+
+    GLuint64 draw_ns = 0;
+    for (u32 i = 0; i < draw_count; i++) {
+        GLuint64 elapsed = 0;
+        gl_GetQueryObjectui64v(queries[i], GL_QUERY_RESULT, &elapsed);
+        draw_ns += elapsed;
+    }
+    GLuint64 blit_ns = 0;
+    gl_GetQueryObjectui64v(blit_query, GL_QUERY_RESULT, &blit_ns);
+
+    r->last_stats.gpu_draw_ms = (f64)draw_ns / 1000000.0;
+    r->last_stats.gpu_blit_ms = (f64)blit_ns / 1000000.0;
+}
+
 void renderer_begin_frame(
     Renderer* renderer,
     u32 width,
@@ -352,12 +1205,41 @@ void renderer_begin_frame(
     u32 target_width,
     u32 target_height
 ) {
+    if (__atomic_exchange_n(
+            &renderer->shader_reload_requested,
+            0u,
+            __ATOMIC_ACQUIRE
+        )) {
+        ShaderPrograms programs;
+        if (renderer_build_programs(renderer, &programs, true)) {
+            renderer_use_programs(renderer, &programs);
+            println("Shaders reloaded");
+        } else {
+            println("Shader reload failed, keeping the current programs");
+        }
+    }
+
+    ASSERT(target_width <= GAME_MAX_TARGET_WIDTH);
+    ASSERT(target_height <= GAME_MAX_TARGET_HEIGHT);
     renderer->width = width;
     renderer->height = height;
     renderer->target_width = target_width;
     renderer->target_height = target_height;
-    renderer->vertex_count = 0;
-    renderer->current_texture = 0;
+    renderer->quad_count = 0;
+    renderer->bound_texture = renderer->textures[0];
+    renderer->current_pool = TEXTURE_POOL_NONE;
+    renderer->current_layer = TEXTURE_LAYER_NONE;
+    renderer->current_blend_mode = RendererBlend_Alpha;
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    // Each frame starts in a fresh ring region, and a fresh upload budget
+    stream_buffer_next_region(&renderer->stream);
+    stream_buffer_next_region(&renderer->uploads);
+    renderer->frame_index++;
+    renderer->query_slot = renderer->frame_index % STREAM_REGION_COUNT;
+    renderer_collect_gpu_times(renderer, renderer->query_slot);
+    renderer_begin_batch(renderer);
+    renderer->stats = {};
 
     // Render to offscreen target (using only the portion we need)
     gl_BindFramebuffer(GL_FRAMEBUFFER, renderer->offscreen_fbo);
@@ -370,45 +1252,206 @@ void renderer_begin_frame(
     );
     glClear(GL_COLOR_BUFFER_BIT);
 
-    gl_UseProgram(renderer->shader_program);
-    gl_Uniform2f(
-        renderer->u_resolution_loc,
-        (f32)target_width,
-        (f32)target_height
-    );
-    gl_Uniform1i(renderer->u_texture_loc, 0);
+    switch (renderer->batch_mode) {
+        case RendererBatchMode_Vertices: {
+            gl_UseProgram(renderer->shader_program);
+            gl_Uniform2f(
+                renderer->u_resolution_loc,
+                (f32)target_width,
+                (f32)target_height
+            );
+            gl_Uniform1i(renderer->u_texture_loc, 0);
+            gl_BindVertexArray(renderer->vao);
+        } break;
+
+        case RendererBatchMode_Instanced: {
+            gl_UseProgram(renderer->instanced_shader_program);
+            gl_Uniform2f(
+                renderer->instanced_u_resolution_loc,
+                (f32)target_width,
+                (f32)target_height
+            );
+            gl_Uniform1i(renderer->instanced_u_texture_loc, 0);
+            gl_BindVertexArray(renderer->instanced_vao);
+        } break;
+    }
 
     gl_ActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, renderer->textures[0]);
+    if (!renderer->texture_arrays) {
+        glBindTexture(GL_TEXTURE_2D, renderer->textures[0]);
+    }
+}
 
-    gl_BindVertexArray(renderer->vao);
+// Time the draws up to the matching end, if the frame has a query left.
+// Returns whether it did.
+static b32 renderer_begin_draw_query(Renderer* r) {
+    u32 slot = r->query_slot;
+    u32 query_index = r->gpu_draw_query_count[slot];
+    if (query_index >= GPU_QUERIES_PER_FRAME - 1) {
+        return false;
+    }
+    gl_BeginQuery(GL_TIME_ELAPSED, r->gpu_queries[slot][query_index]);
+    r->gpu_draw_query_count[slot]++;
+    return true;
 }
 
 static void renderer_flush(Renderer* r) {
-    if (r->vertex_count == 0) {
+    if (r->quad_count == 0) {
         return;
     }
 
-    gl_BindBuffer(GL_ARRAY_BUFFER, r->vbo);
-    gl_BufferSubData(
-        GL_ARRAY_BUFFER,
-        0,
-        r->vertex_count * sizeof(Vertex),
-        global_vertex_buffer
-    );
+    b32 timed = renderer_begin_draw_query(r);
+
+    usize bytes = (usize)r->quad_count * r->quad_stride;
+    if (r->layer_stride) {
+        usize layer_bytes = (usize)r->quad_count * r->layer_stride;
+        memcpy(r->batch_base + bytes, r->batch_layers, layer_bytes);
+        bytes += layer_bytes;
+    }
+    stream_buffer_end_batch(&r->stream, r->batch_offset, bytes);
+    renderer_bind_batch_attributes(r);
+
+    switch (r->batch_mode) {
+        case RendererBatchMode_Vertices: {
+            u32 index_count = r->quad_count * 6;
+            glDrawElements(GL_TRIANGLES, index_count, GL_UNSIGNED_INT, 0);
+        } break;
+
+        case RendererBatchMode_Instanced: {
+            gl_DrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, r->quad_count);
+        } break;
+    }
+
+    if (timed) {
+        gl_EndQuery(GL_TIME_ELAPSED);
+    }
+
+    r->stats.draw_calls++;
+    r->stats.quads += r->quad_count;
+    r->stats.bytes_uploaded += bytes;
+
+    renderer_begin_batch(r);
+}
+
+// Switch the bound texture, flushing the pending batch if it changes. With
+// texture arrays only a change of pool flushes; the white texture (id 0)
+// needs no pool at all.
+static void renderer_use_texture(Renderer* r, u32 texture_id) {
+    if (r->texture_arrays) {
+        if (texture_id == 0) {
+            r->current_layer = TEXTURE_LAYER_NONE;
+            return;
+        }
+        PooledTexture* pooled = &r->pooled_textures[texture_id];
+        if (r->current_pool != pooled->pool) {
+            renderer_flush(r);
+            r->current_pool = pooled->pool;
+            glBindTexture(
+                GL_TEXTURE_2D_ARRAY,
+                r->pool_textures[pooled->pool]
+            );
+        }
+        r->current_layer = pooled->layer;
+        return;
+    }
+    if (r->bound_texture != r->textures[texture_id]) {
+        renderer_flush(r);
+        r->bound_texture = r->textures[texture_id];
+        glBindTexture(GL_TEXTURE_2D, r->bound_texture);
+    }
+}
+
+// The texture's atlas entry, or null if it is not in the runtime atlas
+static AtlasEntry* renderer_atlas_entry(Renderer* r, u32 texture_id) {
+    return r->texture_atlas ? atlas_entry_find(r->atlas_entries, texture_id)
+                            : nullptr;
+}
+
+// Texture array mode: give `count` quads from `first` the current layer
+static void renderer_tag_layers(Renderer* r, u32 first, u32 count) {
+    u32 per_quad = r->layer_stride / sizeof(u16);
+    u16* layers = r->batch_layers + (usize)first * per_quad;
+    u32 layer_count = count * per_quad;
+    for (u32 i = 0; i < layer_count; i++) {
+        layers[i] = r->current_layer;
+    }
+}
+
+// Append one textured quad to the current batch in the active batch format
+static void renderer_push_quad(
+    Renderer* r,
+    f32 x,
+    f32 y,
+    f32 w,
+    f32 h,
+    f32 u0,
+    f32 v0,
+    f32 u1,
+    f32 v1,
+    Color color
+) {
+    if (r->quad_count + 1 > r->batch_capacity) {
+        renderer_flush(r);
+    }
 
-    u32 index_count = (r->vertex_count / 4) * 6;
-    glDrawElements(GL_TRIANGLES, index_count, GL_UNSIGNED_SHORT, 0);
+    if (r->layer_stride) {
+        renderer_tag_layers(r, r->quad_count, 1);
+    }
 
-    r->vertex_count = 0;
+    switch (r->batch_mode) {
+        case RendererBatchMode_Vertices: {
+            if (r->vertex_format == RendererVertexFormat_Compact) {
+                CompactVertex* v =
+                    (CompactVertex*)r->batch_base + r->quad_count * 4;
+                u16 cu0 = uv_to_unorm16(u0);
+                u16 cv0 = uv_to_unorm16(v0);
+                u16 cu1 = uv_to_unorm16(u1);
+                u16 cv1 = uv_to_unorm16(v1);
+                u32 c = color_to_rgba8(color);
+
+                v[0] = {{x, y}, {cu0, cv0}, c};
+                v[1] = {{x + w, y}, {cu1, cv0}, c};
+                v[2] = {{x + w, y + h}, {cu1, cv1}, c};
+                v[3] = {{x, y + h}, {cu0, cv1}, c};
+                break;
+            }
+
+            Vertex* v = (Vertex*)r->batch_base + r->quad_count * 4;
+            f32 cr = color_r(color);
+            f32 cg = color_g(color);
+            f32 cb = color_b(color);
+            f32 ca = color_a(color);
+
+            v[0] = {{x, y}, {u0, v0}, {cr, cg, cb, ca}};
+            v[1] = {{x + w, y}, {u1, v0}, {cr, cg, cb, ca}};
+            v[2] = {{x + w, y + h}, {u1, v1}, {cr, cg, cb, ca}};
+            v[3] = {{x, y + h}, {u0, v1}, {cr, cg, cb, ca}};
+        } break;
+
+        case RendererBatchMode_Instanced: {
+            SpriteInstance* inst =
+                (SpriteInstance*)r->batch_base + r->quad_count;
+            inst->rect[0] = x;
+            inst->rect[1] = y;
+            inst->rect[2] = w;
+            inst->rect[3] = h;
+            inst->uv[0] = uv_to_unorm16(u0);
+            inst->uv[1] = uv_to_unorm16(v0);
+            inst->uv[2] = uv_to_unorm16(u1);
+            inst->uv[3] = uv_to_unorm16(v1);
+            inst->color = color_to_rgba8(color);
+        } break;
+    }
+
+    r->quad_count++;
 }
 
 void renderer_end_frame(Renderer* renderer) {
     renderer_flush(renderer);
 
     // Calculate UV coordinates for the portion of the FBO we actually used
-    f32 u_max = (f32)renderer->target_width / (f32)MAX_TARGET_WIDTH;
-    f32 v_max = (f32)renderer->target_height / (f32)MAX_TARGET_HEIGHT;
+    f32 u_max = (f32)renderer->target_width / (f32)GAME_MAX_TARGET_WIDTH;
+    f32 v_max = (f32)renderer->target_height / (f32)GAME_MAX_TARGET_HEIGHT;
 
     // Build blit quad vertices in NDC (full screen, no black bars with
     // overscan)
@@ -422,6 +1465,13 @@ void renderer_end_frame(Renderer* renderer) {
         {{-1.0f, 1.0f}, {0.0f, v_max}, {1.0f, 1.0f, 1.0f, 1.0f}};
 
     // Blit to default framebuffer
+    u32 slot = renderer->query_slot;
+    gl_BeginQuery(
+        GL_TIME_ELAPSED,
+        renderer->gpu_queries[slot][GPU_QUERIES_PER_FRAME - 1]
+    );
+    renderer->gpu_blit_query_issued[slot] = true;
+
     gl_BindFramebuffer(GL_FRAMEBUFFER, 0);
     glViewport(0, 0, renderer->width, renderer->height);
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
@@ -442,9 +1492,22 @@ void renderer_end_frame(Renderer* renderer) {
         global_blit_quad
     );
 
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, 0);
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
 
     gl_BindVertexArray(0);
+    gl_EndQuery(GL_TIME_ELAPSED);
+
+    renderer->stats.draw_calls++;
+    renderer->stats.bytes_uploaded += sizeof(global_blit_quad);
+
+    // Publish the counters; the GPU times are filled in by readback
+    renderer->last_stats.draw_calls = renderer->stats.draw_calls;
+    renderer->last_stats.quads = renderer->stats.quads;
+    renderer->last_stats.bytes_uploaded = renderer->stats.bytes_uploaded;
+}
+
+void renderer_get_stats(Renderer* renderer, RendererStats* stats) {
+    *stats = renderer->last_stats;
 }
 
 void renderer_draw_rect(
@@ -455,29 +1518,12 @@ void renderer_draw_rect(
     f32 h,
     Color color
 ) {
-    if (renderer->vertex_count + 4 > MAX_VERTICES) {
-        renderer_flush(renderer);
+    f32 uv[4] = {0.0f, 0.0f, 1.0f, 1.0f};
+    if (AtlasEntry* entry = renderer_atlas_entry(renderer, 0)) {
+        atlas_entry_remap(entry, uv);
     }
-
-    if (renderer->current_texture != 0) {
-        renderer_flush(renderer);
-        renderer->current_texture = 0;
-        glBindTexture(GL_TEXTURE_2D, renderer->textures[0]);
-    }
-
-    u32 idx = renderer->vertex_count;
-    f32 r = color_r(color);
-    f32 g = color_g(color);
-    f32 b = color_b(color);
-    f32 a = color_a(color);
-
-    global_vertex_buffer[idx + 0] = {{x, y}, {0.0f, 0.0f}, {r, g, b, a}};
-    global_vertex_buffer[idx + 1] = {{x + w, y}, {1.0f, 0.0f}, {r, g, b, a}};
-    global_vertex_buffer[idx + 2] =
-        {{x + w, y + h}, {1.0f, 1.0f}, {r, g, b, a}};
-    global_vertex_buffer[idx + 3] = {{x, y + h}, {0.0f, 1.0f}, {r, g, b, a}};
-
-    renderer->vertex_count += 4;
+    renderer_use_texture(renderer, 0);
+    renderer_push_quad(renderer, x, y, w, h, uv[0], uv[1], uv[2], uv[3], color);
 }
 
 void renderer_draw_sprite(
@@ -489,29 +1535,12 @@ void renderer_draw_sprite(
     u32 texture_id,
     Color tint
 ) {
-    if (renderer->vertex_count + 4 > MAX_VERTICES) {
-        renderer_flush(renderer);
-    }
-
-    if (renderer->current_texture != texture_id) {
-        renderer_flush(renderer);
-        renderer->current_texture = texture_id;
-        glBindTexture(GL_TEXTURE_2D, renderer->textures[texture_id]);
+    f32 uv[4] = {0.0f, 0.0f, 1.0f, 1.0f};
+    if (AtlasEntry* entry = renderer_atlas_entry(renderer, texture_id)) {
+        atlas_entry_remap(entry, uv);
     }
-
-    u32 idx = renderer->vertex_count;
-    f32 r = color_r(tint);
-    f32 g = color_g(tint);
-    f32 b = color_b(tint);
-    f32 a = color_a(tint);
-
-    global_vertex_buffer[idx + 0] = {{x, y}, {0.0f, 0.0f}, {r, g, b, a}};
-    global_vertex_buffer[idx + 1] = {{x + w, y}, {1.0f, 0.0f}, {r, g, b, a}};
-    global_vertex_buffer[idx + 2] =
-        {{x + w, y + h}, {1.0f, 1.0f}, {r, g, b, a}};
-    global_vertex_buffer[idx + 3] = {{x, y + h}, {0.0f, 1.0f}, {r, g, b, a}};
-
-    renderer->vertex_count += 4;
+    renderer_use_texture(renderer, texture_id);
+    renderer_push_quad(renderer, x, y, w, h, uv[0], uv[1], uv[2], uv[3], tint);
 }
 
 void renderer_draw_atlas_sprite(
@@ -527,33 +1556,584 @@ void renderer_draw_atlas_sprite(
     u32 texture_id,
     Color tint
 ) {
-    if (renderer->vertex_count + 4 > MAX_VERTICES) {
-        renderer_flush(renderer);
+    f32 uv[4] = {u0, v0, u1, v1};
+    if (AtlasEntry* entry = renderer_atlas_entry(renderer, texture_id)) {
+        atlas_entry_remap(entry, uv);
+    }
+    renderer_use_texture(renderer, texture_id);
+    renderer_push_quad(renderer, x, y, w, h, uv[0], uv[1], uv[2], uv[3], tint);
+}
+
+#if RENDERER_VALIDATE_KERNELS
+// Debug check: the SIMD kernel must match the scalar reference bit for bit
+static void validate_sprite_vertices(
+    const Vertex* simd_out,
+    f32 w,
+    f32 h,
+    const f32* region_uvs,
+    const f32* x,
+    const f32* y,
+    const u16* region,
+    const Color* tint,
+    u32 count
+) {
+    static Vertex reference[256 * 4];
+    for (u32 start = 0; start < count; start += 256) {
+        u32 run = (count - start < 256) ? count - start : 256;
+        generate_sprite_vertices_scalar(
+            (f32*)reference,
+            w,
+            h,
+            region_uvs,
+            x + start,
+            y + start,
+            region + start,
+            tint + start,
+            run
+        );
+        usize bytes = run * 4 * sizeof(Vertex);
+        ASSERT(memcmp(reference, simd_out + start * 4, bytes) == 0);
     }
+}
+#endif
 
-    if (renderer->current_texture != texture_id) {
-        renderer_flush(renderer);
-        renderer->current_texture = texture_id;
-        glBindTexture(GL_TEXTURE_2D, renderer->textures[texture_id]);
+void renderer_draw_atlas_sprite_batch(
+    Renderer* renderer,
+    u32 texture_id,
+    f32 w,
+    f32 h,
+    const f32* region_uvs,
+    u32 region_count,
+    const f32* x,
+    const f32* y,
+    const u16* region,
+    const Color* tint,
+    u32 count
+) {
+    renderer_use_texture(renderer, texture_id);
+
+    // An atlased texture's UV table is remapped once into its page, unless
+    // it is too big to copy; then each quad's UVs are remapped as it goes
+    AtlasEntry* remap_entry = renderer_atlas_entry(renderer, texture_id);
+    if (remap_entry && region_count <= ATLAS_MAX_BATCH_REGIONS) {
+        f32* remapped = renderer->atlas_region_uvs;
+        memcpy(remapped, region_uvs, region_count * 4 * sizeof(f32));
+        for (u32 i = 0; i < region_count; i++) {
+            atlas_entry_remap(remap_entry, remapped + i * 4);
+        }
+        region_uvs = remapped;
+        remap_entry = nullptr;
     }
 
-    u32 idx = renderer->vertex_count;
-    f32 r = color_r(tint);
-    f32 g = color_g(tint);
-    f32 b = color_b(tint);
-    f32 a = color_a(tint);
+    if (renderer->batch_mode == RendererBatchMode_Vertices && !remap_entry) {
+        // Expand whole runs with the SIMD kernel, up to the batch capacity
+        while (count > 0) {
+            if (renderer->quad_count == renderer->batch_capacity) {
+                renderer_flush(renderer);
+            }
+            u32 run = renderer->batch_capacity - renderer->quad_count;
+            if (run > count) {
+                run = count;
+            }
+
+            if (renderer->vertex_format == RendererVertexFormat_Compact) {
+                CompactVertex* out = (CompactVertex*)renderer->batch_base +
+                                     renderer->quad_count * 4;
+                generate_sprite_vertices_compact(
+                    out,
+                    w,
+                    h,
+                    region_uvs,
+                    x,
+                    y,
+                    region,
+                    tint,
+                    run
+                );
+            } else {
+                Vertex* out =
+                    (Vertex*)renderer->batch_base + renderer->quad_count * 4;
+                generate_sprite_vertices(
+                    (f32*)out,
+                    w,
+                    h,
+                    region_uvs,
+                    x,
+                    y,
+                    region,
+                    tint,
+                    run
+                );
+#if RENDERER_VALIDATE_KERNELS
+                validate_sprite_vertices(
+                    out,
+                    w,
+                    h,
+                    region_uvs,
+                    x,
+                    y,
+                    region,
+                    tint,
+                    run
+                );
+#endif
+            }
+
+            if (renderer->layer_stride) {
+                renderer_tag_layers(renderer, renderer->quad_count, run);
+            }
+            renderer->quad_count += run;
+            x += run;
+            y += run;
+            region += run;
+            tint += run;
+            count -= run;
+        }
+        return;
+    }
+
+    for (u32 i = 0; i < count; i++) {
+        const f32* region_uv = region_uvs + region[i] * 4;
+        f32 uv[4] = {region_uv[0], region_uv[1], region_uv[2], region_uv[3]};
+        if (remap_entry) {
+            atlas_entry_remap(remap_entry, uv);
+        }
+        renderer_push_quad(
+            renderer,
+            x[i],
+            y[i],
+            w,
+            h,
+            uv[0],
+            uv[1],
+            uv[2],
+            uv[3],
+            tint[i]
+        );
+    }
+}
 
-    global_vertex_buffer[idx + 0] = {{x, y}, {u0, v0}, {r, g, b, a}};
-    global_vertex_buffer[idx + 1] = {{x + w, y}, {u1, v0}, {r, g, b, a}};
-    global_vertex_buffer[idx + 2] = {{x + w, y + h}, {u1, v1}, {r, g, b, a}};
-    global_vertex_buffer[idx + 3] = {{x, y + h}, {u0, v1}, {r, g, b, a}};
+// Expand `count` sprites (at most STATIC_LAYER_UPLOAD_QUADS) into the static
+// staging memory by pointing the batch at it for the duration. Binding the
+// texture first flushes the real batch if it has to, so the batch code finds
+// nothing to flush while it writes into staging.
+static void renderer_expand_static_quads(
+    Renderer* r,
+    u32 texture_id,
+    f32 w,
+    f32 h,
+    const f32* region_uvs,
+    u32 region_count,
+    const f32* x,
+    const f32* y,
+    const u16* region,
+    const Color* tint,
+    u32 count
+) {
+    ASSERT(count <= STATIC_LAYER_UPLOAD_QUADS);
+    renderer_use_texture(r, texture_id);
+
+    u8* batch_base = r->batch_base;
+    u16* batch_layers = r->batch_layers;
+    u32 batch_capacity = r->batch_capacity;
+    u32 quad_count = r->quad_count;
+    r->batch_base = r->static_staging;
+    r->batch_layers = r->static_staging_layers;
+    r->batch_capacity = count;
+    r->quad_count = 0;
+
+    renderer_draw_atlas_sprite_batch(
+        r,
+        texture_id,
+        w,
+        h,
+        region_uvs,
+        region_count,
+        x,
+        y,
+        region,
+        tint,
+        count
+    );
+    ASSERT(r->quad_count == count);
 
-    renderer->vertex_count += 4;
+    r->batch_base = batch_base;
+    r->batch_layers = batch_layers;
+    r->batch_capacity = batch_capacity;
+    r->quad_count = quad_count;
 }
 
-u32 renderer_load_texture(
+b32 renderer_update_static_layer(
+    Renderer* renderer,
+    u32 layer_index,
+    u32 capacity,
+    u32 texture_id,
+    f32 w,
+    f32 h,
+    const f32* region_uvs,
+    u32 region_count,
+    u32 first,
+    const f32* x,
+    const f32* y,
+    const u16* region,
+    const Color* tint,
+    u32 count
+) {
+    if (layer_index >= RENDERER_MAX_STATIC_LAYERS) {
+        return false;
+    }
+    StaticLayer* layer = &renderer->static_layers[layer_index];
+    u32 quad_bytes = renderer->quad_stride + renderer->layer_stride;
+    if (!layer->buffer && capacity > 0) {
+        gl_GenBuffers(1, &layer->buffer);
+        gl_BindBuffer(GL_ARRAY_BUFFER, layer->buffer);
+        gl_BufferData(
+            GL_ARRAY_BUFFER,
+            (usize)capacity * quad_bytes,
+            nullptr,
+            GL_STATIC_DRAW
+        );
+        layer->capacity = capacity;
+    }
+    if (!layer->buffer || capacity != layer->capacity ||
+        first > layer->capacity || count > layer->capacity - first) {
+        return false;
+    }
+    layer->texture_id = texture_id;
+
+    usize layer_base = (usize)layer->capacity * renderer->quad_stride;
+    while (count > 0) {
+        u32 run = (count < STATIC_LAYER_UPLOAD_QUADS)
+                      ? count
+                      : STATIC_LAYER_UPLOAD_QUADS;
+        renderer_expand_static_quads(
+            renderer,
+            texture_id,
+            w,
+            h,
+            region_uvs,
+            region_count,
+            x,
+            y,
+            region,
+            tint,
+            run
+        );
+
+        // Expanding may have flushed, which binds the stream buffer
+        gl_BindBuffer(GL_ARRAY_BUFFER, layer->buffer);
+        gl_BufferSubData(
+            GL_ARRAY_BUFFER,
+            (usize)first * renderer->quad_stride,
+            (usize)run * renderer->quad_stride,
+            renderer->static_staging
+        );
+        if (renderer->layer_stride) {
+            gl_BufferSubData(
+                GL_ARRAY_BUFFER,
+                layer_base + (usize)first * renderer->layer_stride,
+                (usize)run * renderer->layer_stride,
+                renderer->static_staging_layers
+            );
+        }
+        renderer->stats.bytes_uploaded += (u64)run * quad_bytes;
+
+        first += run;
+        x += run;
+        y += run;
+        region += run;
+        tint += run;
+        count -= run;
+    }
+    return true;
+}
+
+void renderer_draw_static_layer(
+    Renderer* renderer,
+    u32 layer_index,
+    u32 first,
+    u32 count,
+    f32 offset_x,
+    f32 offset_y
+) {
+    if (layer_index >= RENDERER_MAX_STATIC_LAYERS) {
+        return;
+    }
+    StaticLayer* layer = &renderer->static_layers[layer_index];
+    if (first > layer->capacity) {
+        first = layer->capacity;
+    }
+    if (count > layer->capacity - first) {
+        count = layer->capacity - first;
+    }
+    if (!layer->buffer || count == 0) {
+        return;
+    }
+
+    // Whatever was batched before the layer draws first
+    renderer_use_texture(renderer, layer->texture_id);
+    renderer_flush(renderer);
+
+    GLint offset_loc = (renderer->batch_mode == RendererBatchMode_Instanced)
+                           ? renderer->instanced_u_offset_loc
+                           : renderer->u_offset_loc;
+    gl_Uniform2f(offset_loc, offset_x, offset_y);
+    b32 timed = renderer_begin_draw_query(renderer);
+
+    usize layer_base = (usize)layer->capacity * renderer->quad_stride;
+    switch (renderer->batch_mode) {
+        case RendererBatchMode_Vertices: {
+            // The index buffer covers one batch's worth of quads
+            u32 end = first + count;
+            for (u32 run_first = first; run_first < end;
+                 run_first += renderer->max_quads) {
+                u32 run = end - run_first;
+                if (run > renderer->max_quads) {
+                    run = renderer->max_quads;
+                }
+                renderer_bind_quad_attributes(
+                    renderer,
+                    layer->buffer,
+                    (usize)run_first * renderer->quad_stride,
+                    layer_base + (usize)run_first * renderer->layer_stride
+                );
+                glDrawElements(GL_TRIANGLES, run * 6, GL_UNSIGNED_INT, 0);
+                renderer->stats.draw_calls++;
+            }
+        } break;
+
+        case RendererBatchMode_Instanced: {
+            renderer_bind_quad_attributes(
+                renderer,
+                layer->buffer,
+                (usize)first * renderer->quad_stride,
+                layer_base + (usize)first * renderer->layer_stride
+            );
+            gl_DrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+            renderer->stats.draw_calls++;
+        } break;
+    }
+
+    if (timed) {
+        gl_EndQuery(GL_TIME_ELAPSED);
+    }
+    gl_Uniform2f(offset_loc, 0.0f, 0.0f);
+    renderer->stats.quads += count;
+}
+
+// Texture array mode: place the texture with texture_pool_place, creating
+// the array texture if that started a new pool
+static b32 renderer_alloc_pooled_texture(
+    Renderer* r,
+    PooledTexture* out,
+    i32 width,
+    i32 height,
+    i32 channels
+) {
+    u32 pool_count = r->pool_count;
+    if (!texture_pool_place(
+            r->pools,
+            &r->pool_count,
+            r->max_array_layers,
+            width,
+            height,
+            channels,
+            out
+        )) {
+        return false;
+    }
+    if (r->pool_count == pool_count) {
+        return true;
+    }
+
+    TexturePool* pool = &r->pools[out->pool];
+    GLuint* texture = &r->pool_textures[out->pool];
+    glGenTextures(1, texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, *texture);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    gl_TexImage3D(
+        GL_TEXTURE_2D_ARRAY,
+        0,
+        (channels == 4) ? GL_RGBA8 : GL_R8,
+        width,
+        height,
+        pool->layer_capacity,
+        0,
+        (channels == 4) ? GL_RGBA : GL_RED,
+        GL_UNSIGNED_BYTE,
+        nullptr
+    );
+
+    // Loading mid-frame must not disturb the pool being drawn with
+    if (r->current_pool != TEXTURE_POOL_NONE) {
+        glBindTexture(GL_TEXTURE_2D_ARRAY, r->pool_textures[r->current_pool]);
+    }
+    return true;
+}
+
+// Write rows [first_row, first_row + row_count) of a texture wherever it is
+// stored. `rows` is a client pointer, or an offset into the bound pixel
+// unpack buffer.
+static void renderer_write_texture(
+    Renderer* r,
+    u32 texture_id,
+    const void* rows,
+    i32 first_row,
+    i32 row_count
+) {
+    TextureExtent* extent = &r->texture_extents[texture_id];
+    GLenum format = (extent->channels == 4) ? GL_RGBA : GL_RED;
+    GLint x = 0;
+    GLint y = first_row;
+    if (AtlasEntry* entry = renderer_atlas_entry(r, texture_id)) {
+        x += (GLint)entry->x;
+        y += (GLint)entry->y;
+    }
+
+    if (r->texture_arrays) {
+        PooledTexture* pooled = &r->pooled_textures[texture_id];
+        glBindTexture(GL_TEXTURE_2D_ARRAY, r->pool_textures[pooled->pool]);
+        gl_TexSubImage3D(
+            GL_TEXTURE_2D_ARRAY,
+            0,
+            x,
+            y,
+            pooled->layer,
+            extent->width,
+            row_count,
+            1,
+            format,
+            GL_UNSIGNED_BYTE,
+            rows
+        );
+        if (r->current_pool != TEXTURE_POOL_NONE) {
+            glBindTexture(
+                GL_TEXTURE_2D_ARRAY,
+                r->pool_textures[r->current_pool]
+            );
+        }
+    } else {
+        glBindTexture(GL_TEXTURE_2D, r->textures[texture_id]);
+        glTexSubImage2D(
+            GL_TEXTURE_2D,
+            0,
+            x,
+            y,
+            extent->width,
+            row_count,
+            format,
+            GL_UNSIGNED_BYTE,
+            rows
+        );
+        glBindTexture(GL_TEXTURE_2D, r->bound_texture);
+    }
+}
+
+// Whether a static layer has been written with texture_id's placement
+static b32 renderer_static_layers_use(Renderer* r, u32 texture_id) {
+    for (u32 i = 0; i < RENDERER_MAX_STATIC_LAYERS; i++) {
+        StaticLayer* layer = &r->static_layers[i];
+        if (layer->buffer && layer->texture_id == texture_id) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Runtime atlas: pack an RGBA texture into the first page with room for it,
+// starting a new page if there is none. Without pixels the space is only
+// reserved.
+static b32 renderer_load_atlas_texture(
+    Renderer* r,
+    u32 texture_id,
+    const void* pixels,
+    i32 width,
+    i32 height
+) {
+    u32 x = 0;
+    u32 y = 0;
+    u32 page_index =
+        atlas_pack(r->atlas_pages, r->atlas_page_count, width, height, &x, &y);
+
+    if (page_index == r->atlas_page_count) {
+        if (r->atlas_page_count >= MAX_ATLAS_PAGES) {
+            return false;
+        }
+        AtlasPage* page = &r->atlas_pages[r->atlas_page_count];
+        *page = {};
+        if (r->texture_arrays) {
+            if (!renderer_alloc_pooled_texture(
+                    r,
+                    &page->pooled,
+                    ATLAS_PAGE_SIZE,
+                    ATLAS_PAGE_SIZE,
+                    4
+                )) {
+                return false;
+            }
+        } else {
+            GLuint* texture = &r->atlas_page_textures[page_index];
+            glGenTextures(1, texture);
+            glBindTexture(GL_TEXTURE_2D, *texture);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexImage2D(
+                GL_TEXTURE_2D,
+                0,
+                GL_RGBA8,
+                ATLAS_PAGE_SIZE,
+                ATLAS_PAGE_SIZE,
+                0,
+                GL_RGBA,
+                GL_UNSIGNED_BYTE,
+                nullptr
+            );
+        }
+        atlas_page_init(page, &r->atlas_arena);
+        r->atlas_page_count++;
+
+        // Without texture arrays rects sample the white texture, so move it
+        // onto the first page to let them batch with the atlased sprites.
+        // Static layers bake in its placement and only the game can resend
+        // them, so it stays put if one already draws with it.
+        if (!r->texture_arrays && page_index == 0 &&
+            !renderer_static_layers_use(r, 0)) {
+            u32 white_pixel = 0xFFFFFFFF;
+            renderer_load_atlas_texture(r, 0, &white_pixel, 1, 1);
+        }
+
+        b32 packed = atlas_page_pack(page, width, height, &x, &y);
+        ASSERT(packed);
+        (void)packed;
+    }
+
+    if (r->texture_arrays) {
+        r->pooled_textures[texture_id] = r->atlas_pages[page_index].pooled;
+    } else {
+        r->textures[texture_id] = r->atlas_page_textures[page_index];
+    }
+    atlas_entry_place(
+        &r->atlas_entries[texture_id],
+        page_index,
+        x,
+        y,
+        width,
+        height
+    );
+
+    if (pixels) {
+        renderer_write_texture(r, texture_id, pixels, 0, height);
+    }
+    return true;
+}
+
+u32 renderer_create_texture(
     Renderer* renderer,
-    void* pixels,
     i32 width,
     i32 height,
     i32 channels
@@ -566,6 +2146,35 @@ u32 renderer_load_texture(
     GLenum format = (channels == 4) ? GL_RGBA : GL_RED;
 
     u32 texture_id = renderer->texture_count;
+    renderer->texture_extents[texture_id] = {width, height, channels};
+    renderer->atlas_entries[texture_id].page = ATLAS_PAGE_NONE;
+
+    // Small RGBA textures go in the runtime atlas while it has room
+    if (renderer->texture_atlas && atlas_accepts(width, height, channels) &&
+        renderer_load_atlas_texture(
+            renderer,
+            texture_id,
+            nullptr,
+            width,
+            height
+        )) {
+        renderer->texture_count++;
+        return texture_id;
+    }
+
+    if (renderer->texture_arrays) {
+        if (!renderer_alloc_pooled_texture(
+                renderer,
+                &renderer->pooled_textures[texture_id],
+                width,
+                height,
+                channels
+            )) {
+            return 0;
+        }
+        renderer->texture_count++;
+        return texture_id;
+    }
 
     glGenTextures(1, &renderer->textures[texture_id]);
     glBindTexture(GL_TEXTURE_2D, renderer->textures[texture_id]);
@@ -582,16 +2191,99 @@ u32 renderer_load_texture(
         0,
         format,
         GL_UNSIGNED_BYTE,
-        pixels
+        nullptr
     );
+    glBindTexture(GL_TEXTURE_2D, renderer->bound_texture);
 
     renderer->texture_count++;
     return texture_id;
 }
 
+u32 renderer_load_texture(
+    Renderer* renderer,
+    const void* pixels,
+    i32 width,
+    i32 height,
+    i32 channels
+) {
+    u32 texture_id = renderer_create_texture(renderer, width, height, channels);
+    if (texture_id) {
+        renderer_write_texture(renderer, texture_id, pixels, 0, height);
+    }
+    return texture_id;
+}
+
+usize renderer_texture_upload_available(Renderer* renderer) {
+    StreamBuffer* sb = &renderer->uploads;
+    usize start = (sb->region_used + (STREAM_ALIGNMENT - 1)) &
+                  ~(usize)(STREAM_ALIGNMENT - 1);
+    return (start < sb->region_size) ? sb->region_size - start : 0;
+}
+
+b32 renderer_upload_texture_rows(
+    Renderer* renderer,
+    u32 texture_id,
+    const void* rows,
+    i32 first_row,
+    i32 row_count
+) {
+    ASSERT(texture_id > 0 && texture_id < renderer->texture_count);
+    TextureExtent* extent = &renderer->texture_extents[texture_id];
+    ASSERT(first_row >= 0 && first_row + row_count <= extent->height);
+    usize bytes = (usize)extent->width * (usize)extent->channels *
+                  (usize)row_count;
+    if (bytes == 0 || bytes > renderer_texture_upload_available(renderer)) {
+        return false;
+    }
+
+    // Fits in the current region, so this never moves on to the next one
+    usize offset = 0;
+    usize available = 0;
+    u8* dest = stream_buffer_begin_batch(
+        &renderer->uploads,
+        bytes,
+        &offset,
+        &available
+    );
+    memcpy(dest, rows, bytes);
+    stream_buffer_end_batch(&renderer->uploads, offset, bytes);
+
+    gl_BindBuffer(GL_PIXEL_UNPACK_BUFFER, renderer->uploads.buffer);
+    renderer_write_texture(
+        renderer,
+        texture_id,
+        (const void*)offset,
+        first_row,
+        row_count
+    );
+    gl_BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    renderer->stats.bytes_uploaded += bytes;
+    return true;
+}
+
 void renderer_set_clear_color(Renderer* renderer, Color color) {
     renderer->clear_color[0] = color_r(color);
     renderer->clear_color[1] = color_g(color);
     renderer->clear_color[2] = color_b(color);
     renderer->clear_color[3] = color_a(color);
 }
+
+void renderer_set_blend_mode(Renderer* renderer, RendererBlendMode mode) {
+    if (renderer->current_blend_mode == mode) {
+        return;
+    }
+
+    renderer_flush(renderer);
+    renderer->current_blend_mode = mode;
+
+    switch (mode) {
+        case RendererBlend_Alpha: {
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        } break;
+
+        case RendererBlend_Additive: {
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+        } break;
+    }
+}
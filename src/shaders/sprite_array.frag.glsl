@@ -0,0 +1,17 @@
+#version 330 core
+in vec2 v_uv;
+in vec4 v_color;
+flat in uint v_layer;
+
+uniform sampler2DArray u_texture;
+
+out vec4 frag_color;
+
+void main() {
+    // The last layer index marks untextured quads, so rects share the batch
+    vec4 texel = vec4(1.0);
+    if (v_layer != 0xFFFFu) {
+        texel = texture(u_texture, vec3(v_uv, float(v_layer)));
+    }
+    frag_color = texel * v_color;
+}
@@ -0,0 +1,21 @@
+#version 330 core
+layout(location = 0) in vec2 a_pos;
+layout(location = 1) in vec2 a_uv;
+layout(location = 2) in vec4 a_color;
+layout(location = 3) in uint a_layer;
+
+uniform vec2 u_resolution;
+uniform vec2 u_offset; // Subtracted from positions (static layers)
+
+out vec2 v_uv;
+out vec4 v_color;
+flat out uint v_layer;
+
+void main() {
+    vec2 ndc = ((a_pos - u_offset) / u_resolution) * 2.0 - 1.0;
+    ndc.y = -ndc.y;
+    gl_Position = vec4(ndc, 0.0, 1.0);
+    v_uv = a_uv;
+    v_color = a_color;
+    v_layer = a_layer;
+}
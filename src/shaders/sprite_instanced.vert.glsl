@@ -0,0 +1,22 @@
+#version 330 core
+layout(location = 0) in vec4 a_rect;    // x, y, w, h
+layout(location = 1) in vec4 a_uv_rect; // u0, v0, u1, v1
+layout(location = 2) in vec4 a_color;
+
+uniform vec2 u_resolution;
+uniform vec2 u_offset; // Subtracted from positions (static layers)
+
+out vec2 v_uv;
+out vec4 v_color;
+
+void main() {
+    // Triangle strip corners: 0 = (0,0), 1 = (1,0), 2 = (0,1), 3 = (1,1)
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    vec2 pos = a_rect.xy + corner * a_rect.zw;
+
+    vec2 ndc = ((pos - u_offset) / u_resolution) * 2.0 - 1.0;
+    ndc.y = -ndc.y;
+    gl_Position = vec4(ndc, 0.0, 1.0);
+    v_uv = mix(a_uv_rect.xy, a_uv_rect.zw, corner);
+    v_color = a_color;
+}
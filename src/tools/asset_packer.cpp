@@ -0,0 +1,202 @@
+// Offline asset packer - converts source images into one asset pack (see
+// platform/asset_pack.h) that the platform layer maps at startup
+//
+//   out/asset_packer <pack.rpak> <image>...
+//
+// Images are decoded with stb_image (BMP, PNG, TGA, JPEG, ...). Single
+// channel images are stored as R8, everything else as RGBA8, both top row
+// first as renderer_load_texture takes them. Each asset is named after its
+// file without directory or extension: "assets/ravioli_atlas.bmp" is
+// "ravioli_atlas".
+//
+// Only uncompressed formats are written. Our textures are small pixel art
+// drawn with nearest filtering, where BC/ETC block artifacts would show and
+// would save little.
+
+#include <print>
+
+using std::println;
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_FAILURE_USERMSG
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-but-set-variable"
+#include "stb/stb_image.h"
+#pragma GCC diagnostic pop
+
+#include "platform/asset_pack.h"
+#include "platform/memory.h"
+
+struct SourceImage {
+    const char* path;
+    AssetPackEntry entry;
+};
+
+// "assets/ravioli_atlas.bmp" -> "ravioli_atlas". Returns false if the name
+// does not fit.
+static b32 asset_name_from_path(const char* path, char* out, usize size) {
+    const char* base = path;
+    for (const char* c = path; *c; c++) {
+        if (*c == '/' || *c == '\\') {
+            base = c + 1;
+        }
+    }
+    const char* end = strrchr(base, '.');
+    usize length = end ? (usize)(end - base) : strlen(base);
+    if (length == 0 || length >= size) {
+        return false;
+    }
+    memcpy(out, base, length);
+    out[length] = 0;
+    return true;
+}
+
+static u64 align_up(u64 value, u64 alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+static b32 write_padding(FILE* file, u64 from, u64 to) {
+    static const u8 zeros[ASSET_PACK_ALIGNMENT] = {};
+    ASSERT(to - from <= ASSET_PACK_ALIGNMENT);
+    return to == from || fwrite(zeros, (usize)(to - from), 1, file) == 1;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        println("Usage: asset_packer <pack.rpak> <image>...");
+        return 1;
+    }
+    const char* pack_path = argv[1];
+    u32 count = (u32)(argc - 2);
+
+    usize images_size = count * sizeof(SourceImage);
+    SourceImage* images = (SourceImage*)platform_alloc(images_size);
+    if (!images) {
+        println("Failed to allocate packer memory");
+        return 1;
+    }
+
+    // Read every header first to lay out the pack; the pixels are decoded
+    // one image at a time while writing
+    for (u32 i = 0; i < count; i++) {
+        SourceImage* image = &images[i];
+        image->path = argv[2 + i];
+        AssetPackEntry* entry = &image->entry;
+        if (!asset_name_from_path(
+                image->path,
+                entry->name,
+                ASSET_PACK_NAME_SIZE
+            )) {
+            println("Bad asset name for {}", image->path);
+            return 1;
+        }
+        i32 width;
+        i32 height;
+        i32 channels;
+        if (!stbi_info(image->path, &width, &height, &channels)) {
+            println(
+                "Failed to read {}: {}",
+                image->path,
+                stbi_failure_reason()
+            );
+            return 1;
+        }
+        entry->format = (channels == 1) ? AssetPackFormat_R8
+                                        : AssetPackFormat_RGBA8;
+        entry->width = (u32)width;
+        entry->height = (u32)height;
+        entry->size = (u64)width * (u64)height *
+                      asset_pack_format_channels(entry->format);
+
+        // Insertion sort by name, which is the order lookups search in
+        u32 j = i;
+        for (; j > 0; j--) {
+            i32 order = strcmp(images[j - 1].entry.name, entry->name);
+            if (order == 0) {
+                println("Duplicate asset name {}", entry->name);
+                return 1;
+            }
+            if (order < 0) {
+                break;
+            }
+        }
+        SourceImage sorted = *image;
+        memmove(&images[j + 1], &images[j], (i - j) * sizeof(SourceImage));
+        images[j] = sorted;
+    }
+
+    u64 offset = sizeof(AssetPackHeader) + count * sizeof(AssetPackEntry);
+    for (u32 i = 0; i < count; i++) {
+        offset = align_up(offset, ASSET_PACK_ALIGNMENT);
+        images[i].entry.offset = offset;
+        offset += images[i].entry.size;
+    }
+
+    AssetPackHeader header = {};
+    header.magic = ASSET_PACK_MAGIC;
+    header.version = ASSET_PACK_VERSION;
+    header.entry_count = count;
+    header.file_size = offset;
+
+    FILE* file = fopen(pack_path, "wb");
+    if (!file) {
+        println("Failed to create {}", pack_path);
+        return 1;
+    }
+    b32 ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    for (u32 i = 0; ok && i < count; i++) {
+        ok = fwrite(&images[i].entry, sizeof(AssetPackEntry), 1, file) == 1;
+    }
+
+    u64 written = sizeof(AssetPackHeader) + count * sizeof(AssetPackEntry);
+    for (u32 i = 0; ok && i < count; i++) {
+        SourceImage* image = &images[i];
+        AssetPackEntry* entry = &image->entry;
+        i32 width;
+        i32 height;
+        i32 channels;
+        u8* pixels = stbi_load(
+            image->path,
+            &width,
+            &height,
+            &channels,
+            (i32)asset_pack_format_channels(entry->format)
+        );
+        if (!pixels) {
+            println(
+                "Failed to decode {}: {}",
+                image->path,
+                stbi_failure_reason()
+            );
+            ok = false;
+            break;
+        }
+        if ((u32)width != entry->width || (u32)height != entry->height) {
+            println("{} changed while packing", image->path);
+            stbi_image_free(pixels);
+            ok = false;
+            break;
+        }
+        ok = write_padding(file, written, entry->offset) &&
+             fwrite(pixels, (usize)entry->size, 1, file) == 1;
+        written = entry->offset + entry->size;
+        stbi_image_free(pixels);
+    }
+
+    if (fclose(file) != 0 || !ok) {
+        println("Failed to write {}", pack_path);
+        remove(pack_path);
+        return 1;
+    }
+
+    println(
+        "Packed {} textures into {} ({} bytes)",
+        count,
+        pack_path,
+        written
+    );
+    return 0;
+}
@@ -0,0 +1,327 @@
+// Offline atlas packer - packs sprite BMPs into one atlas BMP and writes a
+// header with the UV rectangle of each sprite
+//
+//   out/atlas_packer [--padding N] [--max-size N]
+//                    <name> <atlas.bmp> <header.h> <sprite.bmp>...
+//
+// Sprites are packed tallest first with the skyline packer into the smallest
+// power-of-two atlas they fit, trying square before twice as wide. <name> is
+// the snake_case atlas name: "ravioli_atlas" gives RAVIOLI_ATLAS_REGIONS,
+// indexed by enum RavioliAtlasRegion in input order, with one entry per
+// sprite named after its file (green_happy.bmp -> RavioliAtlas_GreenHappy).
+//
+// Padding is left empty below and right of each sprite. Sprites drawn with
+// nearest filtering at whole-pixel sizes, like the game's, need none.
+
+#include <print>
+
+using std::println;
+#include <stdlib.h>
+#include <string.h>
+
+#include "lib/skyline_packer.h"
+#include "platform/memory.h"
+#include "util/bmp_loader.h"
+
+#define ATLAS_PACKER_MAX_SPRITES 1024
+#define ATLAS_PACKER_NAME_SIZE 128
+#define ATLAS_PACKER_MIN_SIZE 16
+
+struct PackedSprite {
+    BMPImage image;
+    char name[ATLAS_PACKER_NAME_SIZE]; // PascalCase, from the file name
+    u32 x;
+    u32 y;
+};
+
+// File name without directory and extension, in PascalCase:
+// "assets/ravioli/green_happy.bmp" -> "GreenHappy"
+static void pascal_case_name(const char* path, char* out, usize size) {
+    const char* base = path;
+    for (const char* c = path; *c; c++) {
+        if (*c == '/' || *c == '\\') {
+            base = c + 1;
+        }
+    }
+
+    usize length = 0;
+    b32 upper = true;
+    for (const char* c = base; *c && *c != '.' && length + 1 < size; c++) {
+        char ch = *c;
+        if (ch == '_' || ch == '-' || ch == ' ') {
+            upper = true;
+            continue;
+        }
+        if (upper && ch >= 'a' && ch <= 'z') {
+            ch = (char)(ch - 'a' + 'A');
+        }
+        upper = false;
+        out[length++] = ch;
+    }
+    out[length] = 0;
+}
+
+// "ravioli_atlas" -> "RAVIOLI_ATLAS"
+static void upper_case_name(const char* name, char* out, usize size) {
+    usize length = 0;
+    for (const char* c = name; *c && length + 1 < size; c++) {
+        char ch = *c;
+        if (ch >= 'a' && ch <= 'z') {
+            ch = (char)(ch - 'a' + 'A');
+        } else if (ch == '-' || ch == ' ') {
+            ch = '_';
+        }
+        out[length++] = ch;
+    }
+    out[length] = 0;
+}
+
+// Shortest float literal that reads back as the same f32, always with a
+// decimal point so it reads as a float ("0.0f", "0.25f")
+static void format_uv(f32 value, char* out, usize size) {
+    for (i32 precision = 1; precision <= 9; precision++) {
+        snprintf(out, size, "%.*g", precision, (f64)value);
+        if ((f32)strtod(out, nullptr) == value) {
+            break;
+        }
+    }
+    if (!strchr(out, '.') && !strchr(out, 'e')) {
+        strncat(out, ".0", size - strlen(out) - 1);
+    }
+    strncat(out, "f", size - strlen(out) - 1);
+}
+
+// Pack every sprite into a width x height atlas, or return false
+static b32 try_pack(
+    MemoryArena* arena,
+    PackedSprite** order,
+    u32 count,
+    u32 width,
+    u32 height,
+    u32 padding
+) {
+    TemporaryMemory temp = TemporaryMemory::make(arena);
+    SkylinePacker packer = SkylinePacker::make(arena, width, height);
+    b32 result = true;
+    for (u32 i = 0; i < count && result; i++) {
+        PackedSprite* sprite = order[i];
+        result = packer.pack(
+            (u32)sprite->image.width + padding,
+            (u32)sprite->image.height + padding,
+            &sprite->x,
+            &sprite->y
+        );
+    }
+    temp.end();
+    return result;
+}
+
+static b32 write_header(
+    const char* path,
+    const char* name,
+    PackedSprite* sprites,
+    u32 count,
+    u32 width,
+    u32 height
+) {
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        return false;
+    }
+
+    char pascal[ATLAS_PACKER_NAME_SIZE];
+    char upper[ATLAS_PACKER_NAME_SIZE];
+    pascal_case_name(name, pascal, sizeof(pascal));
+    upper_case_name(name, upper, sizeof(upper));
+
+    fprintf(file, "// Generated by atlas_packer - do not edit\n");
+    fprintf(file, "#pragma once\n\n");
+    fprintf(file, "#include \"game_interface.h\"\n\n");
+    fprintf(file, "#define %s_WIDTH %u\n", upper, width);
+    fprintf(file, "#define %s_HEIGHT %u\n\n", upper, height);
+
+    fprintf(file, "enum %sRegion {\n", pascal);
+    for (u32 i = 0; i < count; i++) {
+        PackedSprite* sprite = &sprites[i];
+        fprintf(
+            file,
+            "    %s_%s, // %dx%d at (%u, %u)\n",
+            pascal,
+            sprite->name,
+            sprite->image.width,
+            sprite->image.height,
+            sprite->x,
+            sprite->y
+        );
+    }
+    fprintf(file, "    %s_Count,\n", pascal);
+    fprintf(file, "};\n\n");
+
+    fprintf(
+        file,
+        "static const AtlasRegion %s_REGIONS[%s_Count] = {\n",
+        upper,
+        pascal
+    );
+    for (u32 i = 0; i < count; i++) {
+        PackedSprite* sprite = &sprites[i];
+        char uv[4][32];
+        format_uv((f32)sprite->x / (f32)width, uv[0], sizeof(uv[0]));
+        format_uv((f32)sprite->y / (f32)height, uv[1], sizeof(uv[1]));
+        format_uv(
+            (f32)(sprite->x + sprite->image.width) / (f32)width,
+            uv[2],
+            sizeof(uv[2])
+        );
+        format_uv(
+            (f32)(sprite->y + sprite->image.height) / (f32)height,
+            uv[3],
+            sizeof(uv[3])
+        );
+        fprintf(
+            file,
+            "    {%s, %s, %s, %s}, // %s\n",
+            uv[0],
+            uv[1],
+            uv[2],
+            uv[3],
+            sprite->name
+        );
+    }
+    fprintf(file, "};\n");
+
+    return fclose(file) == 0;
+}
+
+static void print_usage() {
+    println(
+        "Usage: atlas_packer [--padding N] [--max-size N] "
+        "<name> <atlas.bmp> <header.h> <sprite.bmp>..."
+    );
+}
+
+int main(int argc, char** argv) {
+    u32 padding = 0;
+    u32 max_size = 4096;
+    i32 arg = 1;
+    for (; arg < argc && argv[arg][0] == '-'; arg++) {
+        if (strcmp(argv[arg], "--padding") == 0 && arg + 1 < argc) {
+            padding = (u32)atoi(argv[++arg]);
+        } else if (strcmp(argv[arg], "--max-size") == 0 && arg + 1 < argc) {
+            max_size = (u32)atoi(argv[++arg]);
+        } else {
+            println("Unknown argument: {}", argv[arg]);
+            print_usage();
+            return 1;
+        }
+    }
+    if (argc - arg < 4) {
+        print_usage();
+        return 1;
+    }
+    const char* name = argv[arg++];
+    const char* atlas_path = argv[arg++];
+    const char* header_path = argv[arg++];
+    u32 count = (u32)(argc - arg);
+    if (count > ATLAS_PACKER_MAX_SPRITES) {
+        println(
+            "Too many sprites: {} (max {})",
+            count,
+            ATLAS_PACKER_MAX_SPRITES
+        );
+        return 1;
+    }
+
+    usize arena_size = 256 * 1024 * 1024;
+    void* arena_memory = platform_alloc(arena_size);
+    if (!arena_memory) {
+        println("Failed to allocate packer memory");
+        return 1;
+    }
+    MemoryArena arena = MemoryArena::make(arena_memory, arena_size);
+
+    PackedSprite* sprites = arena.push_array<PackedSprite>(count);
+    PackedSprite** order = arena.push_array<PackedSprite*>(count);
+    u64 total_area = 0;
+    for (u32 i = 0; i < count; i++) {
+        PackedSprite* sprite = &sprites[i];
+        *sprite = {};
+        sprite->image = bmp_load(argv[arg + i], &arena);
+        if (!sprite->image.valid) {
+            println("Failed to load {}", argv[arg + i]);
+            return 1;
+        }
+        pascal_case_name(argv[arg + i], sprite->name, sizeof(sprite->name));
+        total_area += (u64)(sprite->image.width + padding) *
+                      (u64)(sprite->image.height + padding);
+
+        // Insertion sort, tallest then widest first; equal sprites keep
+        // their input order so the layout is stable
+        u32 j = i;
+        for (; j > 0; j--) {
+            BMPImage* prev = &order[j - 1]->image;
+            if (prev->height > sprite->image.height ||
+                (prev->height == sprite->image.height &&
+                 prev->width >= sprite->image.width)) {
+                break;
+            }
+            order[j] = order[j - 1];
+        }
+        order[j] = sprite;
+    }
+
+    u32 width = 0;
+    u32 height = 0;
+    for (u32 size = ATLAS_PACKER_MIN_SIZE; size <= max_size; size *= 2) {
+        if ((u64)size * size >= total_area &&
+            try_pack(&arena, order, count, size, size, padding)) {
+            width = size;
+            height = size;
+            break;
+        }
+        if (size * 2 <= max_size && (u64)size * size * 2 >= total_area &&
+            try_pack(&arena, order, count, size * 2, size, padding)) {
+            width = size * 2;
+            height = size;
+            break;
+        }
+    }
+    if (width == 0) {
+        println("Sprites do not fit in a {}x{} atlas", max_size, max_size);
+        return 1;
+    }
+
+    // Blit each sprite into the cleared atlas
+    u8* pixels = arena.push_array<u8>((usize)width * height * 4);
+    memset(pixels, 0, (usize)width * height * 4);
+    for (u32 i = 0; i < count; i++) {
+        PackedSprite* sprite = &sprites[i];
+        usize row_bytes = (usize)sprite->image.width * 4;
+        for (i32 y = 0; y < sprite->image.height; y++) {
+            memcpy(
+                pixels + ((usize)(sprite->y + y) * width + sprite->x) * 4,
+                sprite->image.pixels + (usize)y * row_bytes,
+                row_bytes
+            );
+        }
+    }
+
+    if (!bmp_write(atlas_path, pixels, (i32)width, (i32)height)) {
+        println("Failed to write {}", atlas_path);
+        return 1;
+    }
+    if (!write_header(header_path, name, sprites, count, width, height)) {
+        println("Failed to write {}", header_path);
+        return 1;
+    }
+
+    u64 atlas_area = (u64)width * height;
+    println(
+        "Packed {} sprites into {}x{} ({}% used)",
+        count,
+        width,
+        height,
+        (u32)(total_area * 100 / atlas_area)
+    );
+    return 0;
+}
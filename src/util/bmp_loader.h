@@ -38,54 +38,88 @@ struct BMPImage {
     b32 valid;
 };
 
-// Load BMP file, allocating pixel data from the provided arena
-// The row_buffer for temporary decoding also comes from the arena
-inline BMPImage bmp_load(const char* filepath, MemoryArena* arena) {
-    BMPImage result = {};
-
-    FILE* file = fopen(filepath, "rb");
-    if (!file) {
-        return result;
-    }
-
-    BMPFileHeader file_header;
-    if (fread(&file_header, sizeof(file_header), 1, file) != 1) {
-        fclose(file);
-        return result;
+// Read and check the headers of a BMP that bmp_load can decode, leaving the
+// file positioned after them
+inline b32 bmp_read_headers(
+    FILE* file,
+    BMPFileHeader* file_header,
+    BMPInfoHeader* info_header
+) {
+    if (fread(file_header, sizeof(*file_header), 1, file) != 1) {
+        return false;
     }
 
     // Check magic number 'BM'
-    if (file_header.type != 0x4D42) {
-        fclose(file);
-        return result;
+    if (file_header->type != 0x4D42) {
+        return false;
     }
 
     // Read just the header size first to determine format
     u32 header_size;
     if (fread(&header_size, sizeof(header_size), 1, file) != 1) {
-        fclose(file);
-        return result;
+        return false;
     }
 
     // Seek back and read the standard info header portion
     fseek(file, sizeof(BMPFileHeader), SEEK_SET);
 
-    BMPInfoHeader info_header = {};
+    *info_header = {};
     u32 bytes_to_read = (header_size < sizeof(BMPInfoHeader))
                             ? header_size
                             : sizeof(BMPInfoHeader);
-    if (fread(&info_header, bytes_to_read, 1, file) != 1) {
-        fclose(file);
-        return result;
+    if (fread(info_header, bytes_to_read, 1, file) != 1) {
+        return false;
     }
-    info_header.size = header_size;
+    info_header->size = header_size;
 
     // Support uncompressed (0) and BI_BITFIELDS (3) for 32-bit BMPs
     b32 valid_compression =
-        (info_header.compression == 0) ||
-        (info_header.compression == 3 && info_header.bits_per_pixel == 32);
-    if (!valid_compression || (info_header.bits_per_pixel != 24 &&
-                               info_header.bits_per_pixel != 32)) {
+        (info_header->compression == 0) ||
+        (info_header->compression == 3 && info_header->bits_per_pixel == 32);
+    return valid_compression && (info_header->bits_per_pixel == 24 ||
+                                 info_header->bits_per_pixel == 32);
+}
+
+// Size of a BMP without decoding it. Returns false if bmp_load would fail on
+// its headers.
+inline b32 bmp_info(const char* filepath, i32* width, i32* height) {
+    FILE* file = fopen(filepath, "rb");
+    if (!file) {
+        return false;
+    }
+    BMPFileHeader file_header;
+    BMPInfoHeader info_header;
+    b32 valid = bmp_read_headers(file, &file_header, &info_header);
+    fclose(file);
+    if (!valid) {
+        return false;
+    }
+    *width = info_header.width;
+    *height = (info_header.height < 0) ? -info_header.height
+                                       : info_header.height;
+    return true;
+}
+
+// Arena bytes bmp_load needs for an image, alignment included
+inline u64 bmp_load_size(i32 width, i32 height) {
+    u64 pixels = (u64)width * (u64)height * 4;
+    u64 row_buffer = (u64)width * 4 + 3;
+    return pixels + row_buffer + 2 * alignof(max_align_t);
+}
+
+// Load BMP file, allocating pixel data from the provided arena
+// The row_buffer for temporary decoding also comes from the arena
+inline BMPImage bmp_load(const char* filepath, MemoryArena* arena) {
+    BMPImage result = {};
+
+    FILE* file = fopen(filepath, "rb");
+    if (!file) {
+        return result;
+    }
+
+    BMPFileHeader file_header;
+    BMPInfoHeader info_header;
+    if (!bmp_read_headers(file, &file_header, &info_header)) {
         fclose(file);
         return result;
     }
@@ -137,3 +171,70 @@ inline BMPImage bmp_load(const char* filepath, MemoryArena* arena) {
 
     return result;
 }
+
+// Write RGBA pixels (top row first) as a 32-bit BMP. The V4 header's
+// channel masks keep the alpha channel for image editors; bmp_load only
+// needs the 40-byte part of it.
+inline b32 bmp_write(
+    const char* filepath,
+    const u8* pixels,
+    i32 width,
+    i32 height
+) {
+    FILE* file = fopen(filepath, "wb");
+    if (!file) {
+        return false;
+    }
+
+    // BITMAPV4HEADER: the info header, four channel masks, the color space
+    // tag and 48 bytes of endpoints and gamma that sRGB leaves unused
+    u32 v4_extra[4 + 1 + 12] = {
+        0x00FF0000, // R
+        0x0000FF00, // G
+        0x000000FF, // B
+        0xFF000000, // A
+        0x73524742, // 'sRGB'
+    };
+    u32 header_size = sizeof(BMPInfoHeader) + sizeof(v4_extra);
+    u32 offset = sizeof(BMPFileHeader) + header_size;
+    u32 image_size = (u32)width * (u32)height * 4;
+
+    BMPFileHeader file_header = {};
+    file_header.type = 0x4D42;
+    file_header.size = offset + image_size;
+    file_header.offset = offset;
+
+    BMPInfoHeader info_header = {};
+    info_header.size = header_size;
+    info_header.width = width;
+    info_header.height = height; // Bottom-up
+    info_header.planes = 1;
+    info_header.bits_per_pixel = 32;
+    info_header.compression = 3; // BI_BITFIELDS
+    info_header.image_size = image_size;
+    info_header.x_pixels_per_m = 2835; // 72 DPI
+    info_header.y_pixels_per_m = 2835;
+
+    b32 ok = fwrite(&file_header, sizeof(file_header), 1, file) == 1 &&
+             fwrite(&info_header, sizeof(info_header), 1, file) == 1 &&
+             fwrite(v4_extra, sizeof(v4_extra), 1, file) == 1;
+
+    // BGRA rows need no padding
+    u8 row[4 * 4096];
+    for (i32 y = height - 1; ok && y >= 0; y--) {
+        const u8* src_row = pixels + (usize)y * width * 4;
+        for (i32 x0 = 0; ok && x0 < width; x0 += 4096) {
+            i32 run = (width - x0 < 4096) ? width - x0 : 4096;
+            for (i32 x = 0; x < run; x++) {
+                const u8* src = src_row + (usize)(x0 + x) * 4;
+                row[x * 4 + 0] = src[2];
+                row[x * 4 + 1] = src[1];
+                row[x * 4 + 2] = src[0];
+                row[x * 4 + 3] = src[3];
+            }
+            ok = fwrite(row, (usize)run * 4, 1, file) == 1;
+        }
+    }
+
+    return (fclose(file) == 0) && ok;
+}
@@ -1,18 +1,39 @@
 #include "util/loader.opengl.h"
 
+#include <string.h>
+
 // Define extension function pointers
 GL_PFNGLGENBUFFERSPROC gl_GenBuffers = nullptr;
 GL_PFNGLDELETEBUFFERSPROC gl_DeleteBuffers = nullptr;
 GL_PFNGLBINDBUFFERPROC gl_BindBuffer = nullptr;
 GL_PFNGLBUFFERDATAPROC gl_BufferData = nullptr;
 GL_PFNGLBUFFERSUBDATAPROC gl_BufferSubData = nullptr;
+GL_PFNGLMAPBUFFERRANGEPROC gl_MapBufferRange = nullptr;
+GL_PFNGLUNMAPBUFFERPROC gl_UnmapBuffer = nullptr;
+GL_PFNGLBUFFERSTORAGEPROC gl_BufferStorage = nullptr;
+
+GL_PFNGLFENCESYNCPROC gl_FenceSync = nullptr;
+GL_PFNGLDELETESYNCPROC gl_DeleteSync = nullptr;
+GL_PFNGLCLIENTWAITSYNCPROC gl_ClientWaitSync = nullptr;
+
+GL_PFNGLGETSTRINGIPROC gl_GetStringi = nullptr;
+
+GL_PFNGLGENQUERIESPROC gl_GenQueries = nullptr;
+GL_PFNGLDELETEQUERIESPROC gl_DeleteQueries = nullptr;
+GL_PFNGLBEGINQUERYPROC gl_BeginQuery = nullptr;
+GL_PFNGLENDQUERYPROC gl_EndQuery = nullptr;
+GL_PFNGLGETQUERYOBJECTIVPROC gl_GetQueryObjectiv = nullptr;
+GL_PFNGLGETQUERYOBJECTUI64VPROC gl_GetQueryObjectui64v = nullptr;
 
 GL_PFNGLGENVERTEXARRAYSPROC gl_GenVertexArrays = nullptr;
 GL_PFNGLDELETEVERTEXARRAYSPROC gl_DeleteVertexArrays = nullptr;
 GL_PFNGLBINDVERTEXARRAYPROC gl_BindVertexArray = nullptr;
 GL_PFNGLVERTEXATTRIBPOINTERPROC gl_VertexAttribPointer = nullptr;
+GL_PFNGLVERTEXATTRIBIPOINTERPROC gl_VertexAttribIPointer = nullptr;
 GL_PFNGLENABLEVERTEXATTRIBARRAYPROC gl_EnableVertexAttribArray = nullptr;
 GL_PFNGLDISABLEVERTEXATTRIBARRAYPROC gl_DisableVertexAttribArray = nullptr;
+GL_PFNGLVERTEXATTRIBDIVISORPROC gl_VertexAttribDivisor = nullptr;
+GL_PFNGLDRAWARRAYSINSTANCEDPROC gl_DrawArraysInstanced = nullptr;
 
 GL_PFNGLCREATESHADERPROC gl_CreateShader = nullptr;
 GL_PFNGLDELETESHADERPROC gl_DeleteShader = nullptr;
@@ -29,6 +50,9 @@ GL_PFNGLLINKPROGRAMPROC gl_LinkProgram = nullptr;
 GL_PFNGLUSEPROGRAMPROC gl_UseProgram = nullptr;
 GL_PFNGLGETPROGRAMIVPROC gl_GetProgramiv = nullptr;
 GL_PFNGLGETPROGRAMINFOLOGPROC gl_GetProgramInfoLog = nullptr;
+GL_PFNGLPROGRAMPARAMETERIPROC gl_ProgramParameteri = nullptr;
+GL_PFNGLGETPROGRAMBINARYPROC gl_GetProgramBinary = nullptr;
+GL_PFNGLPROGRAMBINARYPROC gl_ProgramBinary = nullptr;
 GL_PFNGLGETUNIFORMLOCATIONPROC gl_GetUniformLocation = nullptr;
 GL_PFNGLUNIFORM1IPROC gl_Uniform1i = nullptr;
 GL_PFNGLUNIFORM1FPROC gl_Uniform1f = nullptr;
@@ -37,6 +61,8 @@ GL_PFNGLUNIFORM3FPROC gl_Uniform3f = nullptr;
 GL_PFNGLUNIFORM4FPROC gl_Uniform4f = nullptr;
 
 GL_PFNGLACTIVETEXTUREPROC gl_ActiveTexture = nullptr;
+GL_PFNGLTEXIMAGE3DPROC gl_TexImage3D = nullptr;
+GL_PFNGLTEXSUBIMAGE3DPROC gl_TexSubImage3D = nullptr;
 
 GL_PFNGLGENFRAMEBUFFERSPROC gl_GenFramebuffers = nullptr;
 GL_PFNGLDELETEFRAMEBUFFERSPROC gl_DeleteFramebuffers = nullptr;
@@ -48,6 +74,8 @@ b32 gl_load_functions(void* (*get_proc_address)(const char*)) {
 #define LOAD_GL(var, name)                                                     \
     var = (decltype(var))get_proc_address(name);                               \
     if (!var) return false;
+#define LOAD_GL_OPTIONAL(var, name)                                            \
+    var = (decltype(var))get_proc_address(name);
 
     // Buffer functions (GL 1.5+)
     LOAD_GL(gl_GenBuffers, "glGenBuffers");
@@ -56,14 +84,38 @@ b32 gl_load_functions(void* (*get_proc_address)(const char*)) {
     LOAD_GL(gl_BufferData, "glBufferData");
     LOAD_GL(gl_BufferSubData, "glBufferSubData");
 
+    // Buffer mapping and sync functions (GL 3.0+ / 3.2+)
+    LOAD_GL(gl_MapBufferRange, "glMapBufferRange");
+    LOAD_GL(gl_UnmapBuffer, "glUnmapBuffer");
+    LOAD_GL(gl_FenceSync, "glFenceSync");
+    LOAD_GL(gl_DeleteSync, "glDeleteSync");
+    LOAD_GL(gl_ClientWaitSync, "glClientWaitSync");
+    LOAD_GL(gl_GetStringi, "glGetStringi");
+
+    // Query objects (GL 1.5+); 64-bit results and GL_TIME_ELAPSED are 3.3
+    LOAD_GL(gl_GenQueries, "glGenQueries");
+    LOAD_GL(gl_DeleteQueries, "glDeleteQueries");
+    LOAD_GL(gl_BeginQuery, "glBeginQuery");
+    LOAD_GL(gl_EndQuery, "glEndQuery");
+    LOAD_GL(gl_GetQueryObjectiv, "glGetQueryObjectiv");
+    LOAD_GL(gl_GetQueryObjectui64v, "glGetQueryObjectui64v");
+
+    // Immutable storage (GL 4.4 / ARB_buffer_storage), used when present
+    LOAD_GL_OPTIONAL(gl_BufferStorage, "glBufferStorage");
+
     // VAO functions (GL 3.0+)
     LOAD_GL(gl_GenVertexArrays, "glGenVertexArrays");
     LOAD_GL(gl_DeleteVertexArrays, "glDeleteVertexArrays");
     LOAD_GL(gl_BindVertexArray, "glBindVertexArray");
     LOAD_GL(gl_VertexAttribPointer, "glVertexAttribPointer");
+    LOAD_GL(gl_VertexAttribIPointer, "glVertexAttribIPointer");
     LOAD_GL(gl_EnableVertexAttribArray, "glEnableVertexAttribArray");
     LOAD_GL(gl_DisableVertexAttribArray, "glDisableVertexAttribArray");
 
+    // Instancing functions (GL 3.1+ / 3.3+)
+    LOAD_GL(gl_VertexAttribDivisor, "glVertexAttribDivisor");
+    LOAD_GL(gl_DrawArraysInstanced, "glDrawArraysInstanced");
+
     // Shader functions (GL 2.0+)
     LOAD_GL(gl_CreateShader, "glCreateShader");
     LOAD_GL(gl_DeleteShader, "glDeleteShader");
@@ -88,8 +140,15 @@ b32 gl_load_functions(void* (*get_proc_address)(const char*)) {
     LOAD_GL(gl_Uniform3f, "glUniform3f");
     LOAD_GL(gl_Uniform4f, "glUniform4f");
 
-    // Texture functions (GL 1.3+)
+    // Program binaries (GL 4.1 / ARB_get_program_binary), cached when present
+    LOAD_GL_OPTIONAL(gl_ProgramParameteri, "glProgramParameteri");
+    LOAD_GL_OPTIONAL(gl_GetProgramBinary, "glGetProgramBinary");
+    LOAD_GL_OPTIONAL(gl_ProgramBinary, "glProgramBinary");
+
+    // Texture functions (GL 1.3+; array textures 3.0+)
     LOAD_GL(gl_ActiveTexture, "glActiveTexture");
+    LOAD_GL(gl_TexImage3D, "glTexImage3D");
+    LOAD_GL(gl_TexSubImage3D, "glTexSubImage3D");
 
     // Framebuffer functions (GL 3.0+)
     LOAD_GL(gl_GenFramebuffers, "glGenFramebuffers");
@@ -98,7 +157,20 @@ b32 gl_load_functions(void* (*get_proc_address)(const char*)) {
     LOAD_GL(gl_FramebufferTexture2D, "glFramebufferTexture2D");
     LOAD_GL(gl_CheckFramebufferStatus, "glCheckFramebufferStatus");
 
+#undef LOAD_GL_OPTIONAL
 #undef LOAD_GL
 
     return true;
 }
+
+b32 gl_has_extension(const char* name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++) {
+        const char* ext = (const char*)gl_GetStringi(GL_EXTENSIONS, i);
+        if (ext && strcmp(ext, name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -30,6 +30,11 @@ typedef ptrdiff_t GLsizeiptr;
 typedef ptrdiff_t GLintptr;
 #endif
 
+#ifndef GL_VERSION_3_2
+typedef struct __GLsync* GLsync;
+typedef uint64_t GLuint64;
+#endif
+
 // OpenGL constants for features beyond GL 1.1
 #ifndef GL_FRAGMENT_SHADER
 #define GL_FRAGMENT_SHADER 0x8B30
@@ -69,6 +74,50 @@ typedef ptrdiff_t GLintptr;
 #define GL_RGBA8 0x8058
 #endif
 
+#ifndef GL_NUM_EXTENSIONS
+#define GL_NUM_EXTENSIONS 0x821D
+#endif
+
+#ifndef GL_MAP_WRITE_BIT
+#define GL_MAP_WRITE_BIT 0x0002
+#define GL_MAP_INVALIDATE_RANGE_BIT 0x0004
+#define GL_MAP_UNSYNCHRONIZED_BIT 0x0020
+#endif
+
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+#ifndef GL_TEXTURE_2D_ARRAY
+#define GL_TEXTURE_2D_ARRAY 0x8C1A
+#define GL_MAX_ARRAY_TEXTURE_LAYERS 0x88FF
+#endif
+
+#ifndef GL_TIME_ELAPSED
+#define GL_TIME_ELAPSED 0x88BF
+#endif
+
+#ifndef GL_QUERY_RESULT
+#define GL_QUERY_RESULT 0x8866
+#define GL_QUERY_RESULT_AVAILABLE 0x8867
+#endif
+
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#define GL_SYNC_FLUSH_COMMANDS_BIT 0x00000001
+#define GL_ALREADY_SIGNALED 0x911A
+#define GL_TIMEOUT_EXPIRED 0x911B
+#define GL_CONDITION_SATISFIED 0x911C
+#define GL_WAIT_FAILED 0x911D
+#endif
+
 // On Windows, we need our own function pointers
 // On Linux, these are already defined in glext.h but we use different names
 // to avoid conflicts and for consistency
@@ -90,6 +139,45 @@ typedef void (*GL_PFNGLBUFFERSUBDATAPROC)(
     const void* data
 );
 
+typedef void* (*GL_PFNGLMAPBUFFERRANGEPROC)(
+    GLenum target,
+    GLintptr offset,
+    GLsizeiptr length,
+    GLbitfield access
+);
+typedef GLboolean (*GL_PFNGLUNMAPBUFFERPROC)(GLenum target);
+typedef void (*GL_PFNGLBUFFERSTORAGEPROC)(
+    GLenum target,
+    GLsizeiptr size,
+    const void* data,
+    GLbitfield flags
+);
+
+typedef GLsync (*GL_PFNGLFENCESYNCPROC)(GLenum condition, GLbitfield flags);
+typedef void (*GL_PFNGLDELETESYNCPROC)(GLsync sync);
+typedef GLenum (*GL_PFNGLCLIENTWAITSYNCPROC)(
+    GLsync sync,
+    GLbitfield flags,
+    GLuint64 timeout
+);
+
+typedef const GLubyte* (*GL_PFNGLGETSTRINGIPROC)(GLenum name, GLuint index);
+
+typedef void (*GL_PFNGLGENQUERIESPROC)(GLsizei n, GLuint* ids);
+typedef void (*GL_PFNGLDELETEQUERIESPROC)(GLsizei n, const GLuint* ids);
+typedef void (*GL_PFNGLBEGINQUERYPROC)(GLenum target, GLuint id);
+typedef void (*GL_PFNGLENDQUERYPROC)(GLenum target);
+typedef void (*GL_PFNGLGETQUERYOBJECTIVPROC)(
+    GLuint id,
+    GLenum pname,
+    GLint* params
+);
+typedef void (*GL_PFNGLGETQUERYOBJECTUI64VPROC)(
+    GLuint id,
+    GLenum pname,
+    GLuint64* params
+);
+
 typedef void (*GL_PFNGLGENVERTEXARRAYSPROC)(GLsizei n, GLuint* arrays);
 typedef void (*GL_PFNGLDELETEVERTEXARRAYSPROC)(GLsizei n, const GLuint* arrays);
 typedef void (*GL_PFNGLBINDVERTEXARRAYPROC)(GLuint array);
@@ -101,8 +189,22 @@ typedef void (*GL_PFNGLVERTEXATTRIBPOINTERPROC)(
     GLsizei stride,
     const void* pointer
 );
+typedef void (*GL_PFNGLVERTEXATTRIBIPOINTERPROC)(
+    GLuint index,
+    GLint size,
+    GLenum type,
+    GLsizei stride,
+    const void* pointer
+);
 typedef void (*GL_PFNGLENABLEVERTEXATTRIBARRAYPROC)(GLuint index);
 typedef void (*GL_PFNGLDISABLEVERTEXATTRIBARRAYPROC)(GLuint index);
+typedef void (*GL_PFNGLVERTEXATTRIBDIVISORPROC)(GLuint index, GLuint divisor);
+typedef void (*GL_PFNGLDRAWARRAYSINSTANCEDPROC)(
+    GLenum mode,
+    GLint first,
+    GLsizei count,
+    GLsizei instancecount
+);
 
 typedef GLuint (*GL_PFNGLCREATESHADERPROC)(GLenum type);
 typedef void (*GL_PFNGLDELETESHADERPROC)(GLuint shader);
@@ -142,6 +244,24 @@ typedef void (*GL_PFNGLGETPROGRAMINFOLOGPROC)(
     GLsizei* length,
     GLchar* infoLog
 );
+typedef void (*GL_PFNGLPROGRAMPARAMETERIPROC)(
+    GLuint program,
+    GLenum pname,
+    GLint value
+);
+typedef void (*GL_PFNGLGETPROGRAMBINARYPROC)(
+    GLuint program,
+    GLsizei bufSize,
+    GLsizei* length,
+    GLenum* binaryFormat,
+    void* binary
+);
+typedef void (*GL_PFNGLPROGRAMBINARYPROC)(
+    GLuint program,
+    GLenum binaryFormat,
+    const void* binary,
+    GLsizei length
+);
 typedef GLint (*GL_PFNGLGETUNIFORMLOCATIONPROC)(
     GLuint program,
     const GLchar* name
@@ -164,6 +284,31 @@ typedef void (*GL_PFNGLUNIFORM4FPROC)(
 );
 
 typedef void (*GL_PFNGLACTIVETEXTUREPROC)(GLenum texture);
+typedef void (*GL_PFNGLTEXIMAGE3DPROC)(
+    GLenum target,
+    GLint level,
+    GLint internalformat,
+    GLsizei width,
+    GLsizei height,
+    GLsizei depth,
+    GLint border,
+    GLenum format,
+    GLenum type,
+    const void* pixels
+);
+typedef void (*GL_PFNGLTEXSUBIMAGE3DPROC)(
+    GLenum target,
+    GLint level,
+    GLint xoffset,
+    GLint yoffset,
+    GLint zoffset,
+    GLsizei width,
+    GLsizei height,
+    GLsizei depth,
+    GLenum format,
+    GLenum type,
+    const void* pixels
+);
 
 typedef void (*GL_PFNGLGENFRAMEBUFFERSPROC)(GLsizei n, GLuint* framebuffers);
 typedef void (*GL_PFNGLDELETEFRAMEBUFFERSPROC)(
@@ -186,13 +331,32 @@ extern GL_PFNGLDELETEBUFFERSPROC gl_DeleteBuffers;
 extern GL_PFNGLBINDBUFFERPROC gl_BindBuffer;
 extern GL_PFNGLBUFFERDATAPROC gl_BufferData;
 extern GL_PFNGLBUFFERSUBDATAPROC gl_BufferSubData;
+extern GL_PFNGLMAPBUFFERRANGEPROC gl_MapBufferRange;
+extern GL_PFNGLUNMAPBUFFERPROC gl_UnmapBuffer;
+extern GL_PFNGLBUFFERSTORAGEPROC gl_BufferStorage; // Optional (GL 4.4)
+
+extern GL_PFNGLFENCESYNCPROC gl_FenceSync;
+extern GL_PFNGLDELETESYNCPROC gl_DeleteSync;
+extern GL_PFNGLCLIENTWAITSYNCPROC gl_ClientWaitSync;
+
+extern GL_PFNGLGETSTRINGIPROC gl_GetStringi;
+
+extern GL_PFNGLGENQUERIESPROC gl_GenQueries;
+extern GL_PFNGLDELETEQUERIESPROC gl_DeleteQueries;
+extern GL_PFNGLBEGINQUERYPROC gl_BeginQuery;
+extern GL_PFNGLENDQUERYPROC gl_EndQuery;
+extern GL_PFNGLGETQUERYOBJECTIVPROC gl_GetQueryObjectiv;
+extern GL_PFNGLGETQUERYOBJECTUI64VPROC gl_GetQueryObjectui64v; // GL 3.3
 
 extern GL_PFNGLGENVERTEXARRAYSPROC gl_GenVertexArrays;
 extern GL_PFNGLDELETEVERTEXARRAYSPROC gl_DeleteVertexArrays;
 extern GL_PFNGLBINDVERTEXARRAYPROC gl_BindVertexArray;
 extern GL_PFNGLVERTEXATTRIBPOINTERPROC gl_VertexAttribPointer;
+extern GL_PFNGLVERTEXATTRIBIPOINTERPROC gl_VertexAttribIPointer;
 extern GL_PFNGLENABLEVERTEXATTRIBARRAYPROC gl_EnableVertexAttribArray;
 extern GL_PFNGLDISABLEVERTEXATTRIBARRAYPROC gl_DisableVertexAttribArray;
+extern GL_PFNGLVERTEXATTRIBDIVISORPROC gl_VertexAttribDivisor;
+extern GL_PFNGLDRAWARRAYSINSTANCEDPROC gl_DrawArraysInstanced;
 
 extern GL_PFNGLCREATESHADERPROC gl_CreateShader;
 extern GL_PFNGLDELETESHADERPROC gl_DeleteShader;
@@ -209,6 +373,9 @@ extern GL_PFNGLLINKPROGRAMPROC gl_LinkProgram;
 extern GL_PFNGLUSEPROGRAMPROC gl_UseProgram;
 extern GL_PFNGLGETPROGRAMIVPROC gl_GetProgramiv;
 extern GL_PFNGLGETPROGRAMINFOLOGPROC gl_GetProgramInfoLog;
+extern GL_PFNGLPROGRAMPARAMETERIPROC gl_ProgramParameteri; // Optional (4.1)
+extern GL_PFNGLGETPROGRAMBINARYPROC gl_GetProgramBinary;   // Optional (4.1)
+extern GL_PFNGLPROGRAMBINARYPROC gl_ProgramBinary;         // Optional (4.1)
 extern GL_PFNGLGETUNIFORMLOCATIONPROC gl_GetUniformLocation;
 extern GL_PFNGLUNIFORM1IPROC gl_Uniform1i;
 extern GL_PFNGLUNIFORM1FPROC gl_Uniform1f;
@@ -217,6 +384,8 @@ extern GL_PFNGLUNIFORM3FPROC gl_Uniform3f;
 extern GL_PFNGLUNIFORM4FPROC gl_Uniform4f;
 
 extern GL_PFNGLACTIVETEXTUREPROC gl_ActiveTexture;
+extern GL_PFNGLTEXIMAGE3DPROC gl_TexImage3D;
+extern GL_PFNGLTEXSUBIMAGE3DPROC gl_TexSubImage3D;
 
 extern GL_PFNGLGENFRAMEBUFFERSPROC gl_GenFramebuffers;
 extern GL_PFNGLDELETEFRAMEBUFFERSPROC gl_DeleteFramebuffers;
@@ -226,3 +395,6 @@ extern GL_PFNGLCHECKFRAMEBUFFERSTATUSPROC gl_CheckFramebufferStatus;
 
 // Load extension functions
 b32 gl_load_functions(void* (*get_proc_address)(const char*));
+
+// Check the GL_EXTENSIONS list of the current context
+b32 gl_has_extension(const char* name);
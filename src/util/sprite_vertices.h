@@ -0,0 +1,337 @@
+#pragma once
+
+#include "lib/def.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SPRITE_VERTICES_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define SPRITE_VERTICES_NEON 1
+#endif
+
+// Quad expansion for batches of same-sized atlas sprites on the CPU vertex
+// path. Each sprite becomes 4 vertices of 8 floats (pos.xy, uv.xy, color.rgba)
+// in the order (x0,y0) (x1,y0) (x1,y1) (x0,y1), matching the renderer's index
+// buffer. Colors are unpacked from 0xRRGGBBAA and divided by 255 exactly like
+// color_r() etc., so the SIMD kernels produce bit-identical output to the
+// scalar reference.
+
+#define SPRITE_VERTEX_FLOATS 8
+#define SPRITE_QUAD_FLOATS (4 * SPRITE_VERTEX_FLOATS)
+
+// Compact 16-byte vertex: normalized u16 UVs and RGBA8 color
+struct CompactVertex {
+    f32 pos[2];
+    u16 uv[2];
+    u32 color; // RGBA8 in memory order
+};
+
+// Color is 0xRRGGBBAA; GL reads normalized u8 attributes in memory order, so
+// swap to get R,G,B,A bytes on little-endian targets.
+inline u32 color_to_rgba8(Color c) { return __builtin_bswap32(c); }
+
+inline u16 uv_to_unorm16(f32 uv) { return (u16)(uv * 65535.0f + 0.5f); }
+
+// Scalar reference implementation
+inline void generate_sprite_vertices_scalar(
+    f32* out,
+    f32 w,
+    f32 h,
+    const f32* region_uvs,
+    const f32* x,
+    const f32* y,
+    const u16* region,
+    const Color* tint,
+    u32 count
+) {
+    for (u32 i = 0; i < count; i++) {
+        const f32* uv = region_uvs + region[i] * 4;
+        f32 x0 = x[i];
+        f32 y0 = y[i];
+        f32 x1 = x0 + w;
+        f32 y1 = y0 + h;
+        f32 r = color_r(tint[i]);
+        f32 g = color_g(tint[i]);
+        f32 b = color_b(tint[i]);
+        f32 a = color_a(tint[i]);
+
+        f32 quad[SPRITE_QUAD_FLOATS] = {
+            x0, y0, uv[0], uv[1], r, g, b, a, // Top-left
+            x1, y0, uv[2], uv[1], r, g, b, a, // Top-right
+            x1, y1, uv[2], uv[3], r, g, b, a, // Bottom-right
+            x0, y1, uv[0], uv[3], r, g, b, a, // Bottom-left
+        };
+        for (u32 j = 0; j < SPRITE_QUAD_FLOATS; j++) {
+            out[j] = quad[j];
+        }
+        out += SPRITE_QUAD_FLOATS;
+    }
+}
+
+#if SPRITE_VERTICES_SSE2
+
+// 4 sprites per iteration. Positions and colors are computed lane-wise and
+// transposed to one vector per sprite; UV rects are gathered per sprite.
+inline void generate_sprite_vertices_sse2(
+    f32* out,
+    f32 w,
+    f32 h,
+    const f32* region_uvs,
+    const f32* x,
+    const f32* y,
+    const u16* region,
+    const Color* tint,
+    u32 count
+) {
+    __m128 size_w = _mm_set1_ps(w);
+    __m128 size_h = _mm_set1_ps(h);
+    __m128i byte_mask = _mm_set1_epi32(0xFF);
+    __m128 inv_scale = _mm_set1_ps(255.0f);
+
+    u32 simd_count = count & ~3u;
+    for (u32 i = 0; i < simd_count; i += 4) {
+        // Positions: rows x0, y0, x1, y1 -> per-sprite (x0, y0, x1, y1)
+        __m128 p0 = _mm_loadu_ps(x + i);
+        __m128 p1 = _mm_loadu_ps(y + i);
+        __m128 p2 = _mm_add_ps(p0, size_w);
+        __m128 p3 = _mm_add_ps(p1, size_h);
+        _MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+
+        // Colors: unpack 0xRRGGBBAA lanes -> per-sprite (r, g, b, a)
+        __m128i packed = _mm_loadu_si128((const __m128i*)(tint + i));
+        __m128 c0 = _mm_cvtepi32_ps(_mm_srli_epi32(packed, 24));
+        __m128 c1 = _mm_cvtepi32_ps(
+            _mm_and_si128(_mm_srli_epi32(packed, 16), byte_mask)
+        );
+        __m128 c2 = _mm_cvtepi32_ps(
+            _mm_and_si128(_mm_srli_epi32(packed, 8), byte_mask)
+        );
+        __m128 c3 = _mm_cvtepi32_ps(_mm_and_si128(packed, byte_mask));
+        c0 = _mm_div_ps(c0, inv_scale);
+        c1 = _mm_div_ps(c1, inv_scale);
+        c2 = _mm_div_ps(c2, inv_scale);
+        c3 = _mm_div_ps(c3, inv_scale);
+        _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+        __m128 pos[4] = {p0, p1, p2, p3};
+        __m128 color[4] = {c0, c1, c2, c3};
+        for (u32 lane = 0; lane < 4; lane++) {
+            __m128 q = pos[lane];
+            __m128 uv = _mm_loadu_ps(region_uvs + region[i + lane] * 4);
+            __m128 c = color[lane];
+
+            // (x0,y0,u0,v0) (x1,y0,u1,v0) (x1,y1,u1,v1) (x0,y1,u0,v1)
+            __m128 tl = _mm_movelh_ps(q, uv);
+            __m128 tr = _mm_shuffle_ps(q, uv, _MM_SHUFFLE(1, 2, 1, 2));
+            __m128 br = _mm_movehl_ps(uv, q);
+            __m128 bl = _mm_shuffle_ps(q, uv, _MM_SHUFFLE(3, 0, 3, 0));
+
+            _mm_storeu_ps(out + 0, tl);
+            _mm_storeu_ps(out + 4, c);
+            _mm_storeu_ps(out + 8, tr);
+            _mm_storeu_ps(out + 12, c);
+            _mm_storeu_ps(out + 16, br);
+            _mm_storeu_ps(out + 20, c);
+            _mm_storeu_ps(out + 24, bl);
+            _mm_storeu_ps(out + 28, c);
+            out += SPRITE_QUAD_FLOATS;
+        }
+    }
+
+    generate_sprite_vertices_scalar(
+        out,
+        w,
+        h,
+        region_uvs,
+        x + simd_count,
+        y + simd_count,
+        region + simd_count,
+        tint + simd_count,
+        count - simd_count
+    );
+}
+
+#endif
+
+#if SPRITE_VERTICES_NEON
+
+inline void generate_sprite_vertices_neon(
+    f32* out,
+    f32 w,
+    f32 h,
+    const f32* region_uvs,
+    const f32* x,
+    const f32* y,
+    const u16* region,
+    const Color* tint,
+    u32 count
+) {
+    float32x4_t size_w = vdupq_n_f32(w);
+    float32x4_t size_h = vdupq_n_f32(h);
+    uint32x4_t byte_mask = vdupq_n_u32(0xFF);
+    float32x4_t inv_scale = vdupq_n_f32(255.0f);
+
+    u32 simd_count = count & ~3u;
+    for (u32 i = 0; i < simd_count; i += 4) {
+        // Positions: zip rows x0/y0 and x1/y1, then recombine per sprite
+        float32x4_t x0 = vld1q_f32(x + i);
+        float32x4_t y0 = vld1q_f32(y + i);
+        float32x4_t x1 = vaddq_f32(x0, size_w);
+        float32x4_t y1 = vaddq_f32(y0, size_h);
+        float32x4x2_t xy0 = vzipq_f32(x0, y0);
+        float32x4x2_t xy1 = vzipq_f32(x1, y1);
+
+        // Colors: unpack 0xRRGGBBAA lanes, then transpose the same way
+        uint32x4_t packed = vld1q_u32(tint + i);
+        float32x4_t r = vcvtq_f32_u32(vshrq_n_u32(packed, 24));
+        float32x4_t g =
+            vcvtq_f32_u32(vandq_u32(vshrq_n_u32(packed, 16), byte_mask));
+        float32x4_t b =
+            vcvtq_f32_u32(vandq_u32(vshrq_n_u32(packed, 8), byte_mask));
+        float32x4_t a = vcvtq_f32_u32(vandq_u32(packed, byte_mask));
+        r = vdivq_f32(r, inv_scale);
+        g = vdivq_f32(g, inv_scale);
+        b = vdivq_f32(b, inv_scale);
+        a = vdivq_f32(a, inv_scale);
+        float32x4x2_t rg = vzipq_f32(r, g);
+        float32x4x2_t ba = vzipq_f32(b, a);
+
+        for (u32 lane = 0; lane < 4; lane++) {
+            u32 half = lane >> 1;
+            b32 high = lane & 1;
+            float32x2_t p_lo = high ? vget_high_f32(xy0.val[half])
+                                    : vget_low_f32(xy0.val[half]);
+            float32x2_t p_hi = high ? vget_high_f32(xy1.val[half])
+                                    : vget_low_f32(xy1.val[half]);
+            float32x4_t c = high ? vcombine_f32(
+                                       vget_high_f32(rg.val[half]),
+                                       vget_high_f32(ba.val[half])
+                                   )
+                                 : vcombine_f32(
+                                       vget_low_f32(rg.val[half]),
+                                       vget_low_f32(ba.val[half])
+                                   );
+
+            float32x4_t uv = vld1q_f32(region_uvs + region[i + lane] * 4);
+            float32x2_t uv_lo = vget_low_f32(uv);  // (u0, v0)
+            float32x2_t uv_hi = vget_high_f32(uv); // (u1, v1)
+
+            // (x1, y0, u1, v0) and (x0, y1, u0, v1)
+            float32x2_t p_tr = vset_lane_f32(vget_lane_f32(p_hi, 0), p_lo, 0);
+            float32x2_t uv_tr =
+                vset_lane_f32(vget_lane_f32(uv_hi, 0), uv_lo, 0);
+            float32x2_t p_bl = vset_lane_f32(vget_lane_f32(p_lo, 0), p_hi, 0);
+            float32x2_t uv_bl =
+                vset_lane_f32(vget_lane_f32(uv_lo, 0), uv_hi, 0);
+
+            vst1q_f32(out + 0, vcombine_f32(p_lo, uv_lo));
+            vst1q_f32(out + 4, c);
+            vst1q_f32(out + 8, vcombine_f32(p_tr, uv_tr));
+            vst1q_f32(out + 12, c);
+            vst1q_f32(out + 16, vcombine_f32(p_hi, uv_hi));
+            vst1q_f32(out + 20, c);
+            vst1q_f32(out + 24, vcombine_f32(p_bl, uv_bl));
+            vst1q_f32(out + 28, c);
+            out += SPRITE_QUAD_FLOATS;
+        }
+    }
+
+    generate_sprite_vertices_scalar(
+        out,
+        w,
+        h,
+        region_uvs,
+        x + simd_count,
+        y + simd_count,
+        region + simd_count,
+        tint + simd_count,
+        count - simd_count
+    );
+}
+
+#endif
+
+// Compact vertex expansion. No float color math at all: the tint is only
+// byte-swapped and the UVs are quantized to u16.
+inline void generate_sprite_vertices_compact(
+    CompactVertex* out,
+    f32 w,
+    f32 h,
+    const f32* region_uvs,
+    const f32* x,
+    const f32* y,
+    const u16* region,
+    const Color* tint,
+    u32 count
+) {
+    for (u32 i = 0; i < count; i++) {
+        const f32* uv = region_uvs + region[i] * 4;
+        u16 u0 = uv_to_unorm16(uv[0]);
+        u16 v0 = uv_to_unorm16(uv[1]);
+        u16 u1 = uv_to_unorm16(uv[2]);
+        u16 v1 = uv_to_unorm16(uv[3]);
+        f32 x0 = x[i];
+        f32 y0 = y[i];
+        f32 x1 = x0 + w;
+        f32 y1 = y0 + h;
+        u32 c = color_to_rgba8(tint[i]);
+
+        out[0] = {{x0, y0}, {u0, v0}, c};
+        out[1] = {{x1, y0}, {u1, v0}, c};
+        out[2] = {{x1, y1}, {u1, v1}, c};
+        out[3] = {{x0, y1}, {u0, v1}, c};
+        out += 4;
+    }
+}
+
+// Best available kernel for the target
+inline void generate_sprite_vertices(
+    f32* out,
+    f32 w,
+    f32 h,
+    const f32* region_uvs,
+    const f32* x,
+    const f32* y,
+    const u16* region,
+    const Color* tint,
+    u32 count
+) {
+#if SPRITE_VERTICES_SSE2
+    generate_sprite_vertices_sse2(
+        out,
+        w,
+        h,
+        region_uvs,
+        x,
+        y,
+        region,
+        tint,
+        count
+    );
+#elif SPRITE_VERTICES_NEON
+    generate_sprite_vertices_neon(
+        out,
+        w,
+        h,
+        region_uvs,
+        x,
+        y,
+        region,
+        tint,
+        count
+    );
+#else
+    generate_sprite_vertices_scalar(
+        out,
+        w,
+        h,
+        region_uvs,
+        x,
+        y,
+        region,
+        tint,
+        count
+    );
+#endif
+}
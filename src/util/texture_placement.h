@@ -0,0 +1,196 @@
+#pragma once
+
+#include "lib/def.h"
+#include "lib/memory_arena.h"
+#include "lib/skyline_packer.h"
+
+// Texture placement shared by the OpenGL and null renderers. Where a texture
+// lands decides how often a frame rebinds, so both renderers place textures
+// with this code and the null renderer's draw call counts stay the GL
+// renderer's. Only the bookkeeping lives here; each renderer creates its own
+// storage (or none) for what gets placed.
+
+// Texture arrays: textures of one size and format share an array texture of
+// up to TEXTURE_POOL_BUDGET bytes, so a pool holds more small textures than
+// large ones
+#define MAX_TEXTURE_POOLS 32
+#define TEXTURE_POOL_BUDGET (16 * 1024 * 1024)
+#define TEXTURE_POOL_MAX_LAYERS 64
+#define TEXTURE_POOL_NONE 0xFFFFFFFFu
+
+// Layer of untextured quads; the array shaders use white instead of sampling
+#define TEXTURE_LAYER_NONE 0xFFFF
+
+// Size, format and fill of an array texture
+struct TexturePool {
+    i32 width;
+    i32 height;
+    i32 channels; // 4 for RGBA8, 1 for R8
+    u32 layer_count;
+    u32 layer_capacity;
+};
+
+// Where a texture id lives in texture array mode
+struct PooledTexture {
+    u16 pool;
+    u16 layer;
+};
+
+// Reserve a layer of the first pool with the texture's size and format and
+// room to spare, starting a new one if there is none. Pools hold at most
+// max_layers layers, the driver's limit. A new pool grows *pool_count, and
+// the caller creates its storage. Returns false if every pool is taken.
+inline b32 texture_pool_place(
+    TexturePool* pools,
+    u32* pool_count,
+    u32 max_layers,
+    i32 width,
+    i32 height,
+    i32 channels,
+    PooledTexture* out
+) {
+    u32 pool_index = 0;
+    for (; pool_index < *pool_count; pool_index++) {
+        TexturePool* pool = &pools[pool_index];
+        if (pool->width == width && pool->height == height &&
+            pool->channels == channels &&
+            pool->layer_count < pool->layer_capacity) {
+            break;
+        }
+    }
+
+    if (pool_index == *pool_count) {
+        if (*pool_count >= MAX_TEXTURE_POOLS) {
+            return false;
+        }
+        usize texel_bytes = (channels == 4) ? 4 : 1;
+        usize layer_bytes = (usize)width * (usize)height * texel_bytes;
+        usize capacity = TEXTURE_POOL_BUDGET / layer_bytes;
+        if (capacity > TEXTURE_POOL_MAX_LAYERS) {
+            capacity = TEXTURE_POOL_MAX_LAYERS;
+        }
+        if (capacity > max_layers) {
+            capacity = max_layers;
+        }
+        if (capacity < 1) {
+            capacity = 1;
+        }
+
+        TexturePool* pool = &pools[(*pool_count)++];
+        *pool = {};
+        pool->width = width;
+        pool->height = height;
+        pool->channels = channels;
+        pool->layer_capacity = (u32)capacity;
+    }
+
+    TexturePool* pool = &pools[pool_index];
+    out->pool = (u16)pool_index;
+    out->layer = (u16)pool->layer_count++;
+    return true;
+}
+
+// Runtime atlas: RGBA textures up to ATLAS_MAX_ENTRY_SIZE on a side are
+// packed into shared pages, ATLAS_PADDING texels apart. Batches remap the
+// UV tables of up to ATLAS_MAX_BATCH_REGIONS regions in one go.
+#define MAX_ATLAS_PAGES 8
+#define ATLAS_PAGE_SIZE 1024
+#define ATLAS_MAX_ENTRY_SIZE 256
+#define ATLAS_PADDING 1
+#define ATLAS_MAX_BATCH_REGIONS 1024
+#define ATLAS_PAGE_NONE 0xFFFFFFFFu
+
+// Skyline nodes of every page
+#define ATLAS_ARENA_SIZE                                                       \
+    (MAX_ATLAS_PAGES * (ATLAS_PAGE_SIZE + 1) * sizeof(SkylineNode))
+
+// Runtime atlas page; its storage is a 2D texture, or a pool layer in
+// texture array mode
+struct AtlasPage {
+    SkylinePacker packer;
+    PooledTexture pooled;
+};
+
+// Where a texture id lives in the runtime atlas: the offset and scale that
+// map its own [0, 1] UVs into its page
+struct AtlasEntry {
+    u32 page; // ATLAS_PAGE_NONE if the texture has its own storage
+    u32 x;    // Texel offset in the page
+    u32 y;
+    f32 u0;
+    f32 v0;
+    f32 du;
+    f32 dv;
+};
+
+// Small RGBA textures go in the atlas; the rest get storage of their own
+inline b32 atlas_accepts(i32 width, i32 height, i32 channels) {
+    return channels == 4 && width <= ATLAS_MAX_ENTRY_SIZE &&
+           height <= ATLAS_MAX_ENTRY_SIZE;
+}
+
+inline void atlas_page_init(AtlasPage* page, MemoryArena* arena) {
+    page->packer =
+        SkylinePacker::make(arena, ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE);
+}
+
+// Place a texture on `page`, padding included. Returns false if it is full.
+inline b32
+atlas_page_pack(AtlasPage* page, i32 width, i32 height, u32* x, u32* y) {
+    return page->packer.pack(
+        (u32)width + ATLAS_PADDING,
+        (u32)height + ATLAS_PADDING,
+        x,
+        y
+    );
+}
+
+// Place a texture on the first page with room. Returns that page's index,
+// or page_count if the caller has to start a new page for it.
+inline u32 atlas_pack(
+    AtlasPage* pages,
+    u32 page_count,
+    i32 width,
+    i32 height,
+    u32* x,
+    u32* y
+) {
+    u32 page_index = 0;
+    for (; page_index < page_count; page_index++) {
+        if (atlas_page_pack(&pages[page_index], width, height, x, y)) {
+            break;
+        }
+    }
+    return page_index;
+}
+
+inline void atlas_entry_place(
+    AtlasEntry* entry,
+    u32 page,
+    u32 x,
+    u32 y,
+    i32 width,
+    i32 height
+) {
+    entry->page = page;
+    entry->x = x;
+    entry->y = y;
+    entry->u0 = (f32)x / ATLAS_PAGE_SIZE;
+    entry->v0 = (f32)y / ATLAS_PAGE_SIZE;
+    entry->du = (f32)width / ATLAS_PAGE_SIZE;
+    entry->dv = (f32)height / ATLAS_PAGE_SIZE;
+}
+
+// The texture's entry, or null if it is not in the atlas
+inline AtlasEntry* atlas_entry_find(AtlasEntry* entries, u32 texture_id) {
+    AtlasEntry* entry = &entries[texture_id];
+    return (entry->page != ATLAS_PAGE_NONE) ? entry : nullptr;
+}
+
+// Map u0, v0, u1, v1 in the texture's own space to its page
+inline void atlas_entry_remap(const AtlasEntry* entry, f32* uv) {
+    uv[0] = entry->u0 + uv[0] * entry->du;
+    uv[1] = entry->v0 + uv[1] * entry->dv;
+    uv[2] = entry->u0 + uv[2] * entry->du;
+    uv[3] = entry->v0 + uv[3] * entry->dv;
+}
@@ -0,0 +1,356 @@
+#pragma once
+
+#include "lib/def.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define XORSHIFT_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define XORSHIFT_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define XORSHIFT_NEON 1
+#endif
+
+// xorshift32 random numbers, one at a time or XORSHIFT_LANES streams at once.
+//
+// The fill kernels draw element i from stream i % XORSHIFT_LANES, so a fill
+// gives the same result with AVX2 (one 8-lane vector), SSE2 and NEON (two
+// 4-lane vectors) or the scalar reference. Floats come from the top 24 bits,
+// which convert to f32 exactly, and are scaled with a separate multiply and
+// add so no kernel can fuse them differently.
+
+#define XORSHIFT_LANES 8
+
+struct XorshiftLanes {
+    alignas(32) u32 state[XORSHIFT_LANES];
+};
+
+inline u32 xorshift32(u32* state) {
+    u32 x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+// Uniform in [min, max)
+inline f32 xorshift_range(u32* state, f32 min, f32 max) {
+    f32 scale = (max - min) * (1.0f / 16777216.0f);
+    f32 offset = (f32)(xorshift32(state) >> 8) * scale;
+    return min + offset;
+}
+
+// Seed every stream from one scalar stream. `seed` must be nonzero.
+inline XorshiftLanes xorshift_seed_lanes(u32 seed) {
+    XorshiftLanes result;
+    for (u32 i = 0; i < XORSHIFT_LANES; i++) {
+        result.state[i] = xorshift32(&seed);
+    }
+    return result;
+}
+
+// Scalar reference implementations. `first` is the element the call starts
+// at, which picks the stream; the SIMD kernels use them for their tails.
+inline void xorshift_fill_range_scalar(
+    XorshiftLanes* lanes,
+    f32* out,
+    u32 first,
+    u32 count,
+    f32 min,
+    f32 max
+) {
+    f32 scale = (max - min) * (1.0f / 16777216.0f);
+    for (u32 i = first; i < first + count; i++) {
+        u32 bits = xorshift32(&lanes->state[i % XORSHIFT_LANES]);
+        f32 offset = (f32)(bits >> 8) * scale;
+        out[i - first] = min + offset;
+    }
+}
+
+inline void xorshift_fill_mask_scalar(
+    XorshiftLanes* lanes,
+    u16* out,
+    u32 first,
+    u32 count,
+    u16 mask
+) {
+    for (u32 i = first; i < first + count; i++) {
+        u32 bits = xorshift32(&lanes->state[i % XORSHIFT_LANES]);
+        out[i - first] = (u16)(bits & mask);
+    }
+}
+
+#if XORSHIFT_AVX2
+
+inline __m256i xorshift_step_avx2(__m256i x) {
+    x = _mm256_xor_si256(x, _mm256_slli_epi32(x, 13));
+    x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 17));
+    x = _mm256_xor_si256(x, _mm256_slli_epi32(x, 5));
+    return x;
+}
+
+inline void xorshift_fill_range_avx2(
+    XorshiftLanes* lanes,
+    f32* out,
+    u32 count,
+    f32 min,
+    f32 max
+) {
+    __m256i state = _mm256_load_si256((const __m256i*)lanes->state);
+    __m256 scale = _mm256_set1_ps((max - min) * (1.0f / 16777216.0f));
+    __m256 offset = _mm256_set1_ps(min);
+
+    u32 simd_count = count & ~(u32)(XORSHIFT_LANES - 1);
+    for (u32 i = 0; i < simd_count; i += XORSHIFT_LANES) {
+        state = xorshift_step_avx2(state);
+        __m256 unit = _mm256_cvtepi32_ps(_mm256_srli_epi32(state, 8));
+        __m256 value = _mm256_add_ps(offset, _mm256_mul_ps(unit, scale));
+        _mm256_storeu_ps(out + i, value);
+    }
+
+    _mm256_store_si256((__m256i*)lanes->state, state);
+    xorshift_fill_range_scalar(
+        lanes,
+        out + simd_count,
+        simd_count,
+        count - simd_count,
+        min,
+        max
+    );
+}
+
+inline void xorshift_fill_mask_avx2(
+    XorshiftLanes* lanes,
+    u16* out,
+    u32 count,
+    u16 mask
+) {
+    __m256i state = _mm256_load_si256((const __m256i*)lanes->state);
+    __m256i mask_lanes = _mm256_set1_epi32(mask);
+
+    u32 simd_count = count & ~(u32)(XORSHIFT_LANES - 1);
+    for (u32 i = 0; i < simd_count; i += XORSHIFT_LANES) {
+        state = xorshift_step_avx2(state);
+        __m256i bits = _mm256_and_si256(state, mask_lanes);
+
+        // Masks fit in 15 bits, so the signed pack is exact
+        __m128i packed = _mm_packs_epi32(
+            _mm256_castsi256_si128(bits),
+            _mm256_extracti128_si256(bits, 1)
+        );
+        _mm_storeu_si128((__m128i*)(out + i), packed);
+    }
+
+    _mm256_store_si256((__m256i*)lanes->state, state);
+    xorshift_fill_mask_scalar(
+        lanes,
+        out + simd_count,
+        simd_count,
+        count - simd_count,
+        mask
+    );
+}
+
+#endif
+
+#if XORSHIFT_SSE2
+
+inline __m128i xorshift_step_sse2(__m128i x) {
+    x = _mm_xor_si128(x, _mm_slli_epi32(x, 13));
+    x = _mm_xor_si128(x, _mm_srli_epi32(x, 17));
+    x = _mm_xor_si128(x, _mm_slli_epi32(x, 5));
+    return x;
+}
+
+// Two independent 4-lane vectors per iteration, lanes 0-3 and 4-7
+inline void xorshift_fill_range_sse2(
+    XorshiftLanes* lanes,
+    f32* out,
+    u32 count,
+    f32 min,
+    f32 max
+) {
+    __m128i state_lo = _mm_load_si128((const __m128i*)lanes->state);
+    __m128i state_hi = _mm_load_si128((const __m128i*)lanes->state + 1);
+    __m128 scale = _mm_set1_ps((max - min) * (1.0f / 16777216.0f));
+    __m128 offset = _mm_set1_ps(min);
+
+    u32 simd_count = count & ~(u32)(XORSHIFT_LANES - 1);
+    for (u32 i = 0; i < simd_count; i += XORSHIFT_LANES) {
+        state_lo = xorshift_step_sse2(state_lo);
+        state_hi = xorshift_step_sse2(state_hi);
+        __m128 unit_lo = _mm_cvtepi32_ps(_mm_srli_epi32(state_lo, 8));
+        __m128 unit_hi = _mm_cvtepi32_ps(_mm_srli_epi32(state_hi, 8));
+        _mm_storeu_ps(out + i, _mm_add_ps(offset, _mm_mul_ps(unit_lo, scale)));
+        _mm_storeu_ps(
+            out + i + 4,
+            _mm_add_ps(offset, _mm_mul_ps(unit_hi, scale))
+        );
+    }
+
+    _mm_store_si128((__m128i*)lanes->state, state_lo);
+    _mm_store_si128((__m128i*)lanes->state + 1, state_hi);
+    xorshift_fill_range_scalar(
+        lanes,
+        out + simd_count,
+        simd_count,
+        count - simd_count,
+        min,
+        max
+    );
+}
+
+inline void xorshift_fill_mask_sse2(
+    XorshiftLanes* lanes,
+    u16* out,
+    u32 count,
+    u16 mask
+) {
+    __m128i state_lo = _mm_load_si128((const __m128i*)lanes->state);
+    __m128i state_hi = _mm_load_si128((const __m128i*)lanes->state + 1);
+    __m128i mask_lanes = _mm_set1_epi32(mask);
+
+    u32 simd_count = count & ~(u32)(XORSHIFT_LANES - 1);
+    for (u32 i = 0; i < simd_count; i += XORSHIFT_LANES) {
+        state_lo = xorshift_step_sse2(state_lo);
+        state_hi = xorshift_step_sse2(state_hi);
+
+        // Masks fit in 15 bits, so the signed pack is exact
+        __m128i packed = _mm_packs_epi32(
+            _mm_and_si128(state_lo, mask_lanes),
+            _mm_and_si128(state_hi, mask_lanes)
+        );
+        _mm_storeu_si128((__m128i*)(out + i), packed);
+    }
+
+    _mm_store_si128((__m128i*)lanes->state, state_lo);
+    _mm_store_si128((__m128i*)lanes->state + 1, state_hi);
+    xorshift_fill_mask_scalar(
+        lanes,
+        out + simd_count,
+        simd_count,
+        count - simd_count,
+        mask
+    );
+}
+
+#endif
+
+#if XORSHIFT_NEON
+
+inline uint32x4_t xorshift_step_neon(uint32x4_t x) {
+    x = veorq_u32(x, vshlq_n_u32(x, 13));
+    x = veorq_u32(x, vshrq_n_u32(x, 17));
+    x = veorq_u32(x, vshlq_n_u32(x, 5));
+    return x;
+}
+
+inline void xorshift_fill_range_neon(
+    XorshiftLanes* lanes,
+    f32* out,
+    u32 count,
+    f32 min,
+    f32 max
+) {
+    uint32x4_t state_lo = vld1q_u32(lanes->state);
+    uint32x4_t state_hi = vld1q_u32(lanes->state + 4);
+    float32x4_t scale = vdupq_n_f32((max - min) * (1.0f / 16777216.0f));
+    float32x4_t offset = vdupq_n_f32(min);
+
+    u32 simd_count = count & ~(u32)(XORSHIFT_LANES - 1);
+    for (u32 i = 0; i < simd_count; i += XORSHIFT_LANES) {
+        state_lo = xorshift_step_neon(state_lo);
+        state_hi = xorshift_step_neon(state_hi);
+        float32x4_t unit_lo = vcvtq_f32_u32(vshrq_n_u32(state_lo, 8));
+        float32x4_t unit_hi = vcvtq_f32_u32(vshrq_n_u32(state_hi, 8));
+        vst1q_f32(out + i, vaddq_f32(offset, vmulq_f32(unit_lo, scale)));
+        vst1q_f32(out + i + 4, vaddq_f32(offset, vmulq_f32(unit_hi, scale)));
+    }
+
+    vst1q_u32(lanes->state, state_lo);
+    vst1q_u32(lanes->state + 4, state_hi);
+    xorshift_fill_range_scalar(
+        lanes,
+        out + simd_count,
+        simd_count,
+        count - simd_count,
+        min,
+        max
+    );
+}
+
+inline void xorshift_fill_mask_neon(
+    XorshiftLanes* lanes,
+    u16* out,
+    u32 count,
+    u16 mask
+) {
+    uint32x4_t state_lo = vld1q_u32(lanes->state);
+    uint32x4_t state_hi = vld1q_u32(lanes->state + 4);
+    uint32x4_t mask_lanes = vdupq_n_u32(mask);
+
+    u32 simd_count = count & ~(u32)(XORSHIFT_LANES - 1);
+    for (u32 i = 0; i < simd_count; i += XORSHIFT_LANES) {
+        state_lo = xorshift_step_neon(state_lo);
+        state_hi = xorshift_step_neon(state_hi);
+        uint16x8_t packed = vcombine_u16(
+            vmovn_u32(vandq_u32(state_lo, mask_lanes)),
+            vmovn_u32(vandq_u32(state_hi, mask_lanes))
+        );
+        vst1q_u16(out + i, packed);
+    }
+
+    vst1q_u32(lanes->state, state_lo);
+    vst1q_u32(lanes->state + 4, state_hi);
+    xorshift_fill_mask_scalar(
+        lanes,
+        out + simd_count,
+        simd_count,
+        count - simd_count,
+        mask
+    );
+}
+
+#endif
+
+// Fill `out` with uniform floats in [min, max), with the best kernel for the
+// target
+inline void xorshift_fill_range(
+    XorshiftLanes* lanes,
+    f32* out,
+    u32 count,
+    f32 min,
+    f32 max
+) {
+#if XORSHIFT_AVX2
+    xorshift_fill_range_avx2(lanes, out, count, min, max);
+#elif XORSHIFT_SSE2
+    xorshift_fill_range_sse2(lanes, out, count, min, max);
+#elif XORSHIFT_NEON
+    xorshift_fill_range_neon(lanes, out, count, min, max);
+#else
+    xorshift_fill_range_scalar(lanes, out, 0, count, min, max);
+#endif
+}
+
+// Fill `out` with random bits under `mask`, which must fit in 15 bits
+inline void xorshift_fill_mask(
+    XorshiftLanes* lanes,
+    u16* out,
+    u32 count,
+    u16 mask
+) {
+    ASSERT(mask <= 0x7FFF);
+#if XORSHIFT_AVX2
+    xorshift_fill_mask_avx2(lanes, out, count, mask);
+#elif XORSHIFT_SSE2
+    xorshift_fill_mask_sse2(lanes, out, count, mask);
+#elif XORSHIFT_NEON
+    xorshift_fill_mask_neon(lanes, out, count, mask);
+#else
+    xorshift_fill_mask_scalar(lanes, out, 0, count, mask);
+#endif
+}